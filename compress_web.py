@@ -0,0 +1,118 @@
+import gzip
+import hashlib
+import json
+import os
+import sys
+
+# Gzips the pages in data/web into data/www for the firmware to serve with
+# Content-Encoding: gzip. Stylesheets, scripts and images are renamed with a hash
+# of their content and moved under /assets/, and the pages are rewritten to point
+# at the new names, so the browser can cache them for good. Runs before each
+# PlatformIO build, or by hand:
+#   python compress_web.py [<web_directory> <output_directory>]
+
+WEB_DIR = os.path.join('data', 'web')
+OUT_DIR = os.path.join('data', 'www')
+ASSET_DIR = 'assets'
+MANIFEST = 'manifest.json'
+
+# Served from /www on LittleFS, see src/WebAssets.h
+FS_ROOT = '/www'
+FS_SOURCE_ROOT = '/web'
+
+CONTENT_TYPES = {
+    '.html': 'text/html',
+    '.css': 'text/css',
+    '.js': 'application/javascript',
+    '.json': 'application/json',
+    '.png': 'image/png',
+    '.jpg': 'image/jpeg',
+    '.svg': 'image/svg+xml',
+    '.ico': 'image/x-icon',
+}
+
+def digest(data):
+    return hashlib.sha256(data).hexdigest()[:16]
+
+def compress(data):
+    # mtime=0 keeps the output identical between builds
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+def write_if_changed(path, data):
+    if os.path.exists(path):
+        with open(path, 'rb') as f:
+            if f.read() == data:
+                return
+    os.makedirs(os.path.dirname(path), exist_ok=True)
+    with open(path, 'wb') as f:
+        f.write(data)
+
+def build(web_dir, out_dir):
+    names = sorted(f for f in os.listdir(web_dir) if os.path.splitext(f)[1].lower() in CONTENT_TYPES)
+    pages = [n for n in names if n.lower().endswith('.html')]
+    assets = [n for n in names if n not in pages]
+
+    entries = []
+    expected = set()
+    renames = {}
+    raw_total = 0
+    gz_total = 0
+
+    for name in assets:
+        with open(os.path.join(web_dir, name), 'rb') as f:
+            data = f.read()
+        base, ext = os.path.splitext(name)
+        hashed = f'{base}.{digest(data)}{ext}'
+        renames[name] = f'/{ASSET_DIR}/{hashed}'
+        entries.append((renames[name], f'{ASSET_DIR}/{hashed}', name, data, True))
+
+    for name in pages:
+        with open(os.path.join(web_dir, name), 'rb') as f:
+            text = f.read().decode('utf-8')
+        for original, url in renames.items():
+            text = text.replace(f'"{original}"', f'"{url}"').replace(f'"/{original}"', f'"{url}"')
+        entries.append((f'/{name}', name, name, text.encode('utf-8'), False))
+
+    manifest = []
+    for url, path, source, data, immutable in entries:
+        compressed = compress(data)
+        raw_total += len(data)
+        gz_total += len(compressed)
+        out_path = os.path.join(out_dir, path + '.gz')
+        expected.add(os.path.normpath(out_path))
+        write_if_changed(out_path, compressed)
+        manifest.append({
+            'url': url,
+            'file': f'{FS_ROOT}/{path}',
+            'source': f'{FS_SOURCE_ROOT}/{source}',
+            'type': CONTENT_TYPES[os.path.splitext(source)[1].lower()],
+            'etag': f'"{digest(data)}"',
+            'immutable': immutable,
+        })
+
+    manifest_path = os.path.join(out_dir, MANIFEST)
+    expected.add(os.path.normpath(manifest_path))
+    write_if_changed(manifest_path, (json.dumps({'assets': manifest}, indent=1) + '\n').encode('utf-8'))
+
+    # Old fingerprinted copies would only waste space on the file system
+    for root, _, files in os.walk(out_dir):
+        for f in files:
+            path = os.path.normpath(os.path.join(root, f))
+            if path not in expected:
+                os.remove(path)
+
+    print(f"Web assets: {len(entries)} files, {raw_total} -> {gz_total} bytes gzipped -> {out_dir}")
+
+try:
+    Import("env")
+    project_dir = env.subst("$PROJECT_DIR")
+    build(os.path.join(project_dir, WEB_DIR), os.path.join(project_dir, OUT_DIR))
+except NameError:
+    if __name__ == '__main__':
+        if len(sys.argv) == 3:
+            build(sys.argv[1], sys.argv[2])
+        elif len(sys.argv) == 1:
+            build(WEB_DIR, OUT_DIR)
+        else:
+            print("Usage: python compress_web.py [<web_directory> <output_directory>]")
+            sys.exit(1)
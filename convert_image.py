@@ -1,32 +1,138 @@
-from PIL import Image
 import os
+import struct
 import sys
 
+# Image file header, see src/Image565.h
+IMAGE_MAGIC = b'I565'
+IMAGE_VERSION = 1
+IMAGE_FORMAT_RGB565 = 0
+IMAGE_FORMAT_RLE565 = 1
+IMAGE_FLAG_TRANSPARENT = 0x01
+IMAGE_HEADER = struct.Struct('<4sBBHHHH2x')
+
+# Key used for transparent pixels, unless the image already uses it
+DEFAULT_TRANSPARENT_KEY = 0xF81F  # magenta
+
 def is_image_file(filename):
     return filename.lower().endswith(('.png', '.jpg', '.jpeg', '.bmp'))
 
-def convert_image_to_rgb(infile, outfile):
+def rgb565(r, g, b):
+    return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+
+def rle_row(row):
+    """Run length encodes one row of pixels. A control byte with the top bit set repeats
+    the following pixel (control & 0x7F) + 1 times, otherwise (control + 1) literal pixels
+    follow. Packets never cross rows so the firmware can decode a row at a time."""
+    out = bytearray()
+    i = 0
+    while i < len(row):
+        run = 1
+        while i + run < len(row) and run < 128 and row[i + run] == row[i]:
+            run += 1
+        if run >= 2:
+            out += struct.pack('<BH', 0x80 | (run - 1), row[i])
+            i += run
+            continue
+        start = i
+        while i < len(row) and i - start < 128:
+            if i + 1 < len(row) and row[i + 1] == row[i]:
+                break
+            i += 1
+        out += struct.pack('<B%dH' % (i - start), i - start - 1, *row[start:i])
+    return bytes(out)
+
+def encode_rgb565(width, height, rgb, alpha=None, rle=False):
+    """Packs 24-bit RGB bytes into the .565 format. Pixels with alpha below 128 become
+    the transparency key when an alpha channel is given."""
+    pixels = [rgb565(rgb[i], rgb[i + 1], rgb[i + 2]) for i in range(0, width * height * 3, 3)]
+
+    flags = 0
+    key = 0
+    if alpha is not None and any(a < 128 for a in alpha):
+        used = set(p for p, a in zip(pixels, alpha) if a >= 128)
+        key = DEFAULT_TRANSPARENT_KEY
+        while key in used:
+            key = (key + 1) & 0xFFFF
+        pixels = [key if a < 128 else p for p, a in zip(pixels, alpha)]
+        flags |= IMAGE_FLAG_TRANSPARENT
+
+    raw = struct.pack('<%dH' % len(pixels), *pixels)
+    if rle:
+        data = b''.join(rle_row(pixels[y * width:(y + 1) * width]) for y in range(height))
+        print(f"  RLE: {len(raw)} -> {len(data)} bytes ({100.0 * len(data) / len(raw):.1f}% of raw)")
+        header = IMAGE_HEADER.pack(IMAGE_MAGIC, IMAGE_VERSION, IMAGE_FORMAT_RLE565, width, height, flags, key)
+        return header + data
+    header = IMAGE_HEADER.pack(IMAGE_MAGIC, IMAGE_VERSION, IMAGE_FORMAT_RGB565, width, height, flags, key)
+    return header + raw
+
+def convert_image(infile, outfile, output_format, transparent, rle):
     try:
+        from PIL import Image
         img = Image.open(infile)
-        # If the image has an alpha channel, composite it over black
-        if img.mode in ('RGBA', 'LA') or (img.mode == 'P' and 'transparency' in img.info):
+        has_alpha = img.mode in ('RGBA', 'LA') or (img.mode == 'P' and 'transparency' in img.info)
+        alpha = None
+        if has_alpha and transparent and output_format == '565':
+            img = img.convert('RGBA')
+            alpha = img.getchannel('A').tobytes()
+            img = img.convert('RGB')
+        elif has_alpha:
+            # Composite the alpha channel over black
             background = Image.new('RGB', img.size, (0, 0, 0))  # Black background
             img = Image.alpha_composite(background.convert('RGBA'), img.convert('RGBA')).convert('RGB')
         else:
             img = img.convert('RGB')  # No alpha, convert directly
+
+        if output_format == 'rgb':
+            data = img.tobytes()
+        else:
+            data = encode_rgb565(img.width, img.height, img.tobytes(), alpha, rle)
         with open(outfile, 'wb') as f:
-            f.write(img.tobytes())
-        print(f"Success: {infile} -> {outfile} ({img.width}x{img.height}, {img.width * img.height * 3} bytes)")
+            f.write(data)
+        print(f"Success: {infile} -> {outfile} ({img.width}x{img.height}, {len(data)} bytes)")
     except Exception as e:
         print(f"Error processing {infile}: {e}")
 
+def convert_raw_rgb(infile, width, height, outfile, rle):
+    """Re-encodes a raw 24-bit .rgb file from an earlier version of this script."""
+    with open(infile, 'rb') as f:
+        rgb = f.read()
+    if len(rgb) != width * height * 3:
+        print(f"Error processing {infile}: expected {width * height * 3} bytes, found {len(rgb)}")
+        return
+    data = encode_rgb565(width, height, rgb, rle=rle)
+    with open(outfile, 'wb') as f:
+        f.write(data)
+    print(f"Success: {infile} -> {outfile} ({width}x{height}, {len(data)} bytes)")
+
 def main():
-    if len(sys.argv) != 3:
-        print("Usage: python convert_image.py <input_directory> <output_directory>")
+    args = sys.argv[1:]
+    output_format = '565'
+    transparent = False
+    rle = False
+    if '--rle' in args:
+        args.remove('--rle')
+        rle = True
+    if '--rgb' in args:
+        args.remove('--rgb')
+        output_format = 'rgb'
+    if '--transparent' in args:
+        args.remove('--transparent')
+        transparent = True
+
+    if len(args) == 5 and args[0] == '--from-rgb':
+        convert_raw_rgb(args[1], int(args[2]), int(args[3]), args[4], rle)
+        return
+
+    if len(args) != 2:
+        print("Usage: python convert_image.py [--rgb] [--rle] [--transparent] <input_directory> <output_directory>")
+        print("       python convert_image.py [--rle] --from-rgb <file.rgb> <width> <height> <output.565>")
+        print("  --rgb          write raw 24-bit .rgb files instead of .565 images")
+        print("  --rle          run length encode the pixels, for large images drawn once")
+        print("  --transparent  keep the alpha channel as a transparency key")
         sys.exit(1)
 
-    input_dir = sys.argv[1]
-    output_dir = sys.argv[2]
+    input_dir = args[0]
+    output_dir = args[1]
 
     if not os.path.isdir(input_dir):
         print(f"Error: Input directory '{input_dir}' does not exist.")
@@ -44,8 +150,8 @@ def main():
     for infile in image_files:
         inpath = os.path.join(input_dir, infile)
         base, _ = os.path.splitext(infile)
-        outfile = os.path.join(output_dir, f"{base}.rgb")
-        convert_image_to_rgb(inpath, outfile)
+        outfile = os.path.join(output_dir, f"{base}.{output_format}")
+        convert_image(inpath, outfile, output_format, transparent, rle)
 
 if __name__ == '__main__':
-    main()
\ No newline at end of file
+    main()
@@ -0,0 +1,94 @@
+import os
+import re
+import struct
+import sys
+
+# Packs the .565 icons in icons/ (written by convert_image.py) into a single atlas file
+# that the firmware reads into PSRAM at boot, and generates src/IconIds.h to name them.
+# Runs before each PlatformIO build, or by hand:
+#   python pack_icons.py [<icon_directory> <atlas_file> <header_file>]
+
+ICON_DIR = 'icons'
+ATLAS_FILE = os.path.join('data', 'images', 'icons.atlas')
+HEADER_FILE = os.path.join('src', 'IconIds.h')
+
+# See src/Image565.h and src/IconAtlas.h
+IMAGE_MAGIC = b'I565'
+IMAGE_HEADER = struct.Struct('<4sBBHHHH2x')
+ATLAS_MAGIC = b'ICA5'
+ATLAS_VERSION = 1
+ATLAS_HEADER = struct.Struct('<4sBBH')
+ATLAS_ENTRY = struct.Struct('<HHHHI')
+
+def icon_id(name):
+    return 'ICON_' + re.sub(r'[^A-Z0-9]+', '_', name.upper()).strip('_')
+
+def read_icon(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    magic, version, pixel_format, width, height, flags, key = IMAGE_HEADER.unpack_from(data)
+    if magic != IMAGE_MAGIC or version != 1 or pixel_format != 0:
+        raise ValueError(f"{path} is not an RGB565 .565 image")
+    pixels = data[IMAGE_HEADER.size:]
+    if len(pixels) != width * height * 2:
+        raise ValueError(f"{path} is truncated")
+    return width, height, flags, key, pixels
+
+def pack(icon_dir, atlas_file, header_file):
+    names = sorted(os.path.splitext(f)[0] for f in os.listdir(icon_dir) if f.endswith('.565'))
+    if len(names) > 255:
+        raise ValueError("Too many icons for one atlas")
+    icons = [read_icon(os.path.join(icon_dir, name + '.565')) for name in names]
+
+    offset = ATLAS_HEADER.size + ATLAS_ENTRY.size * len(icons)
+    index = b''
+    pixels = b''
+    for width, height, flags, key, data in icons:
+        index += ATLAS_ENTRY.pack(width, height, flags, key, offset + len(pixels))
+        pixels += data
+    atlas = ATLAS_HEADER.pack(ATLAS_MAGIC, ATLAS_VERSION, len(icons), 0) + index + pixels
+
+    os.makedirs(os.path.dirname(atlas_file), exist_ok=True)
+    with open(atlas_file, 'wb') as f:
+        f.write(atlas)
+
+    lines = [
+        '// Generated by pack_icons.py from the icons directory, do not edit.',
+        '#pragma once',
+        '#include <stdint.h>',
+        '',
+        '#define ICON_ATLAS_PATH "/images/icons.atlas"',
+        '',
+        'enum IconId : uint8_t',
+        '{',
+    ]
+    lines += [f'    {icon_id(name)} = {i},' for i, name in enumerate(names)]
+    lines += ['', '    ICON_COUNT', '};', '']
+    header = '\n'.join(lines)
+
+    # Leave the header alone when nothing changed so it doesn't force a rebuild
+    existing = None
+    if os.path.exists(header_file):
+        with open(header_file) as f:
+            existing = f.read()
+    if existing != header:
+        with open(header_file, 'w') as f:
+            f.write(header)
+
+    print(f"Icon atlas: {len(icons)} icons, {len(atlas)} bytes -> {atlas_file}")
+
+try:
+    Import("env")
+    project_dir = env.subst("$PROJECT_DIR")
+    pack(os.path.join(project_dir, ICON_DIR),
+         os.path.join(project_dir, ATLAS_FILE),
+         os.path.join(project_dir, HEADER_FILE))
+except NameError:
+    if __name__ == '__main__':
+        if len(sys.argv) == 4:
+            pack(sys.argv[1], sys.argv[2], sys.argv[3])
+        elif len(sys.argv) == 1:
+            pack(ICON_DIR, ATLAS_FILE, HEADER_FILE)
+        else:
+            print("Usage: python pack_icons.py [<icon_directory> <atlas_file> <header_file>]")
+            sys.exit(1)
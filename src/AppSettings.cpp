@@ -2,16 +2,125 @@
 #include <TLogPlus.h>
 #include <ArduinoJson.h>
 
-#define SETTING_IS_CONFIGURED "hasSetup"
+// In SettingId order
+const AppSettings::SettingInfo AppSettings::SETTINGS[SETTING_COUNT] = {
+    { "avgSpeedWindow", SETTING_TYPE_INT },
+    { "baud", SETTING_TYPE_INT },
+    { "dataAgeThres", SETTING_TYPE_INT },
+    { "gpsDataMode", SETTING_TYPE_INT },
+    { "gpsEchoEnabled", SETTING_TYPE_BOOL },
+    { "gpsFixRate", SETTING_TYPE_INT },
+    { "gpsLogEnabled", SETTING_TYPE_BOOL },
+    { "gpsUpdateRate", SETTING_TYPE_INT },
+    { "refreshOther", SETTING_TYPE_INT },
+    { "refresh", SETTING_TYPE_INT },
+    { "backlight", SETTING_TYPE_INT },
+    { "udpEnabled", SETTING_TYPE_BOOL },
+    { "udpHost", SETTING_TYPE_STRING },
+    { "udpPort", SETTING_TYPE_INT },
+    { "udpBatch", SETTING_TYPE_BOOL },
+    { "udpBatchBytes", SETTING_TYPE_INT },
+    { "udpBatchDelay", SETTING_TYPE_INT },
+    { "udpOverflow", SETTING_TYPE_INT },
+    { "displayRotation", SETTING_TYPE_INT },
+    { "hostname", SETTING_TYPE_STRING },
+    { "wifiPSK", SETTING_TYPE_STRING },
+    { "wifiSSID", SETTING_TYPE_STRING },
+    { "hasSetup", SETTING_TYPE_BOOL },
+};
+
+namespace {
+/// @brief Holds a settings mutex for the life of a scope.
+class SettingsLock {
+public:
+    explicit SettingsLock(SemaphoreHandle_t mutex) : _mutex(mutex) { xSemaphoreTake(_mutex, portMAX_DELAY); }
+    ~SettingsLock() { xSemaphoreGive(_mutex); }
+private:
+    SemaphoreHandle_t _mutex;
+};
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+}
 
 AppSettings::AppSettings() {
-    // Default constructor
+    _mutex = xSemaphoreCreateMutexStatic(&_mutexState);
+    _flashMutex = xSemaphoreCreateMutexStatic(&_flashMutexState);
+}
+
+void AppSettings::loop() {
+    if (_dirtyCount.load() > 0 && millis() - _lastChange.load() >= SETTINGS_WRITE_DELAY_MS) {
+        flush();
+    }
+}
+
+/// @brief Copies out the changed settings under the mutex, then writes them to NVS
+/// without it, so nothing reading or changing settings waits on flash.
+void AppSettings::flush() {
+    SettingsLock flashLock(_flashMutex);
+    SettingValue pending[SETTING_COUNT];
+    uint8_t count = 0;
+    {
+        SettingsLock lock(_mutex);
+        if (_dirtyCount.load() == 0) {
+            return;
+        }
+        for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+            CachedSetting& setting = _cache[i];
+            if (!setting.dirty) {
+                continue;
+            }
+            SettingValue& value = pending[count++];
+            value.id = (SettingId)i;
+            value.bits = setting.bits.load(std::memory_order_relaxed);
+            value.stringValue = setting.stringValue;
+            setting.dirty = false;
+        }
+        _dirtyCount = 0;
+    }
+
+    // Anything changed from here on is dirty again and goes out with the next flush
+    for (uint8_t i = 0; i < count; i++) {
+        writeStored(pending[i]);
+        _flashWrites++;
+    }
 }
 
+/// @brief Reads every setting from NVS into RAM.
 bool AppSettings::load() {
-    _prefs.begin("esp32_gps", false);
+    {
+        SettingsLock flashLock(_flashMutex);
+        _prefs.begin("esp32_gps", false);
+
+        SettingValue stored[SETTING_COUNT];
+        bool found[SETTING_COUNT];
+        for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+            found[i] = readStored((SettingId)i, stored[i]);
+        }
+        _flashReads += SETTING_COUNT;
+
+        SettingsLock lock(_mutex);
+        for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+            CachedSetting& setting = _cache[i];
+            if (!found[i] || setting.dirty) {
+                continue;
+            }
+            setting.stringValue = stored[i].stringValue;
+            setting.bits.store(stored[i].bits, std::memory_order_relaxed);
+            setting.stored.store(true, std::memory_order_release);
+        }
+    }
 
-    return _prefs.getBool(SETTING_IS_CONFIGURED, false);
+    return getBool(SETTING_IS_CONFIGURED, false);
 }
 
 bool AppSettings::load(String json)
@@ -22,14 +131,30 @@ bool AppSettings::load(String json)
     if (!error)
     {
         for (JsonPair kv : newSettings.as<JsonObject>()) {
-            if (kv.value().is<bool>()) {
-                _prefs.putBool(kv.key().c_str(), kv.value().as<bool>());
-            } else if (kv.value().is<int>()) {
-                _prefs.putInt(kv.key().c_str(), kv.value().as<int>());
-            } else if (kv.value().is<float>()) {
-                _prefs.putFloat(kv.key().c_str(), kv.value().as<float>());
-            } else if (kv.value().is<String>()) {
-                _prefs.putString(kv.key().c_str(), kv.value().as<String>());
+            SettingId id;
+            if (!findKey(kv.key().c_str(), id)) {
+                TLogPlus::Log.warningln("AppSettings: Ignoring unknown setting %s", kv.key().c_str());
+                continue;
+            }
+            // Each setting keeps its type, so a value of another type is left out
+            JsonVariant value = kv.value();
+            bool applied = false;
+            switch (SETTINGS[id].type) {
+                case SETTING_TYPE_BOOL:
+                    if ((applied = value.is<bool>())) setBool(id, value.as<bool>());
+                    break;
+                case SETTING_TYPE_INT:
+                    if ((applied = value.is<int>())) setInt(id, value.as<int>());
+                    break;
+                case SETTING_TYPE_FLOAT:
+                    if ((applied = value.is<float>())) setFloat(id, value.as<float>());
+                    break;
+                case SETTING_TYPE_STRING:
+                    if ((applied = value.is<const char*>())) set(id, value.as<const char*>());
+                    break;
+            }
+            if (!applied) {
+                TLogPlus::Log.warningln("AppSettings: Ignoring %s, the value is the wrong type", kv.key().c_str());
             }
         }
     }
@@ -41,7 +166,19 @@ bool AppSettings::load(String json)
 }
 
 void AppSettings::loadDefaults() {
-    _prefs.clear();
+    {
+        SettingsLock flashLock(_flashMutex);
+        _prefs.clear();
+
+        SettingsLock lock(_mutex);
+        for (CachedSetting& setting : _cache) {
+            setting.stored.store(false, std::memory_order_relaxed);
+            setting.bits.store(0, std::memory_order_relaxed);
+            setting.stringValue = "";
+            setting.dirty = false;
+        }
+        _dirtyCount = 0;
+    }
     setBool(SETTING_GPS_ECHO, GPS_ECHO_DEFAULT);
     setBool(SETTING_GPS_LOG_ENABLED, GPS_LOG_DEFAULT);
     setInt(SETTING_GPS_DATA_MODE, GPS_DATA_MODE_DEFAULT);
@@ -56,72 +193,225 @@ void AppSettings::loadDefaults() {
     setBool(SETTING_UDP_ENABLED, UDP_ENABLED_DEFAULT);
     set(SETTING_UDP_HOST, UDP_HOST_DEFAULT);
     setInt(SETTING_UDP_PORT, UDP_PORT_DEFAULT);
+    setBool(SETTING_UDP_BATCH, UDP_BATCH_DEFAULT);
+    setInt(SETTING_UDP_BATCH_BYTES, UDP_BATCH_BYTES_DEFAULT);
+    setInt(SETTING_UDP_BATCH_DELAY, UDP_BATCH_DELAY_DEFAULT);
+    setInt(SETTING_UDP_OVERFLOW, UDP_OVERFLOW_DEFAULT);
     setBool(SETTING_IS_CONFIGURED, true);
     setInt(SETTING_DISPLAY_ROTATION, DISPLAY_ROTATION_DEFAULT);
+    flush();
 }
 
-void AppSettings::set(const char* key, const char* value) {
-    _prefs.putString(key, value);
+void AppSettings::set(SettingId id, const char* value) {
+    if (!hasType(id, SETTING_TYPE_STRING)) {
+        return;
+    }
+    SettingsLock lock(_mutex);
+    _writeRequests++;
+    CachedSetting& setting = _cache[id];
+    if (setting.stored.load(std::memory_order_relaxed) && setting.stringValue == value) {
+        _unchangedWrites++;
+        return;
+    }
+    setting.stringValue = value;
+    setting.stored.store(true, std::memory_order_release);
+    markChanged(setting);
 }
 
-void AppSettings::set(const char* key, String value) 
+void AppSettings::set(SettingId id, String value)
 {
-    _prefs.putString(key, value);
+    set(id, value.c_str());
+}
+
+void AppSettings::setBool(SettingId id, bool value) {
+    setScalar(id, SETTING_TYPE_BOOL, value ? 1 : 0);
+}
+
+void AppSettings::setInt(SettingId id, int value) {
+    setScalar(id, SETTING_TYPE_INT, (uint32_t)value);
+}
+
+void AppSettings::setFloat(SettingId id, float value) {
+    setScalar(id, SETTING_TYPE_FLOAT, floatBits(value));
+}
+
+// As with Preferences, a setting read as a different type reads as the default
+String AppSettings::get(SettingId id, const char* defaultValue) {
+    if (id >= SETTING_COUNT || SETTINGS[id].type != SETTING_TYPE_STRING) {
+        return String(defaultValue);
+    }
+    SettingsLock lock(_mutex);
+    const CachedSetting& setting = _cache[id];
+    return setting.stored.load(std::memory_order_relaxed) ? setting.stringValue : String(defaultValue);
 }
 
-void AppSettings::setBool(const char* key, bool value) {
-    _prefs.putBool(key, value);
+bool AppSettings::getBool(SettingId id, bool defaultValue) {
+    uint32_t bits;
+    return readScalar(id, SETTING_TYPE_BOOL, bits) ? bits != 0 : defaultValue;
 }
 
-void AppSettings::setInt(const char* key, int value) {
-    _prefs.putInt(key, value);
+int AppSettings::getInt(SettingId id, int defaultValue) {
+    uint32_t bits;
+    return readScalar(id, SETTING_TYPE_INT, bits) ? (int32_t)bits : defaultValue;
 }
 
-void AppSettings::setFloat(const char* key, float value) {
-    _prefs.putFloat(key, value);
+float AppSettings::getFloat(SettingId id, float defaultValue) {
+    uint32_t bits;
+    return readScalar(id, SETTING_TYPE_FLOAT, bits) ? bitsFloat(bits) : defaultValue;
 }
 
-String AppSettings::get(const char* key, const char* defaultValue) {
-    return _prefs.getString(key, String(defaultValue));
+const char* AppSettings::keyName(SettingId id) {
+    return id < SETTING_COUNT ? SETTINGS[id].key : "unknown";
 }
 
-bool AppSettings::getBool(const char* key, bool defaultValue) {
-    return _prefs.getBool(key, defaultValue);
+bool AppSettings::findKey(const char* key, SettingId& id) {
+    for (uint8_t i = 0; i < SETTING_COUNT; i++) {
+        if (strcmp(SETTINGS[i].key, key) == 0) {
+            id = (SettingId)i;
+            return true;
+        }
+    }
+    return false;
 }
 
-int AppSettings::getInt(const char* key, int defaultValue) {
-    return _prefs.getInt(key, defaultValue);
+bool AppSettings::hasType(SettingId id, SettingType type) const {
+    if (id < SETTING_COUNT && SETTINGS[id].type == type) {
+        return true;
+    }
+    TLogPlus::Log.warningln("AppSettings: %s can't be set to a value of another type", keyName(id));
+    return false;
 }
 
-float AppSettings::getFloat(const char* key, float defaultValue) {
-    return _prefs.getFloat(key, defaultValue);
+/// @brief Reads a bool, int or float without the mutex: the value is a single atomic
+/// word, published before the flag that says it is there.
+bool AppSettings::readScalar(SettingId id, SettingType type, uint32_t& bits) const {
+    if (id >= SETTING_COUNT || SETTINGS[id].type != type) {
+        return false;
+    }
+    const CachedSetting& setting = _cache[id];
+    if (!setting.stored.load(std::memory_order_acquire)) {
+        return false;
+    }
+    bits = setting.bits.load(std::memory_order_relaxed);
+    return true;
+}
+
+void AppSettings::setScalar(SettingId id, SettingType type, uint32_t bits) {
+    if (!hasType(id, type)) {
+        return;
+    }
+    SettingsLock lock(_mutex);
+    _writeRequests++;
+    CachedSetting& setting = _cache[id];
+    if (setting.stored.load(std::memory_order_relaxed) && setting.bits.load(std::memory_order_relaxed) == bits) {
+        _unchangedWrites++;
+        return;
+    }
+    setting.bits.store(bits, std::memory_order_relaxed);
+    setting.stored.store(true, std::memory_order_release);
+    markChanged(setting);
+}
+
+/// @brief Reads one setting from NVS. A setting stored as another type than the table
+/// gives it is left out, so it reads as the default. Call with _flashMutex held.
+bool AppSettings::readStored(SettingId id, SettingValue& value) {
+    const char* key = SETTINGS[id].key;
+    PreferenceType stored = _prefs.getType(key);
+    value.id = id;
+    value.bits = 0;
+    switch (SETTINGS[id].type) {
+        case SETTING_TYPE_BOOL:
+            if (stored != PT_U8) return false;
+            value.bits = _prefs.getBool(key) ? 1 : 0;
+            return true;
+        case SETTING_TYPE_INT:
+            if (stored != PT_I32) return false;
+            value.bits = (uint32_t)_prefs.getInt(key);
+            return true;
+        case SETTING_TYPE_FLOAT:
+            // putFloat stores the four bytes of the float as a blob
+            if (stored != PT_BLOB || _prefs.getBytesLength(key) != sizeof(float)) return false;
+            value.bits = floatBits(_prefs.getFloat(key));
+            return true;
+        case SETTING_TYPE_STRING:
+            if (stored != PT_STR) return false;
+            value.stringValue = _prefs.getString(key);
+            return true;
+    }
+    return false;
+}
+
+/// @brief Writes one setting to NVS. Call with _flashMutex held.
+void AppSettings::writeStored(const SettingValue& value) {
+    const char* key = SETTINGS[value.id].key;
+    switch (SETTINGS[value.id].type) {
+        case SETTING_TYPE_BOOL:
+            _prefs.putBool(key, value.bits != 0);
+            break;
+        case SETTING_TYPE_INT:
+            _prefs.putInt(key, (int32_t)value.bits);
+            break;
+        case SETTING_TYPE_FLOAT:
+            _prefs.putFloat(key, bitsFloat(value.bits));
+            break;
+        case SETTING_TYPE_STRING:
+            _prefs.putString(key, value.stringValue);
+            break;
+    }
+}
+
+/// @brief Call with the mutex held.
+void AppSettings::markChanged(CachedSetting& setting) {
+    if (!setting.dirty) {
+        setting.dirty = true;
+        _dirtyCount++;
+    }
+    _lastChange = millis();
 }
 
 void AppSettings::printToLog() {
     TLogPlus::Log.infoln("AppSettings:");
     TLogPlus::Log.println(getRawJson());
+    printStats();
+}
+
+void AppSettings::printStats() {
+    uint32_t stored = 0;
+    for (const CachedSetting& setting : _cache) {
+        if (setting.stored.load()) stored++;
+    }
+    SettingsLock lock(_mutex);
+    TLogPlus::Log.printf("Settings cache: %u of %u stored, %u flash reads, %u waiting to be written\n",
+                         stored, SETTING_COUNT, _flashReads, _dirtyCount.load());
+    TLogPlus::Log.printf("Settings writes: %u requested, %u unchanged, %u flash writes (%u saved)\n",
+                         _writeRequests, _unchangedWrites, _flashWrites.load(),
+                         _writeRequests > _flashWrites ? _writeRequests - _flashWrites : 0);
 }
 
 String AppSettings::getRawJson() {
     JsonDocument doc;
-    doc[SETTING_AVERAGE_SPEED_WINDOW] = getInt(SETTING_AVERAGE_SPEED_WINDOW);
-    doc[SETTING_BAUD_RATE] = getInt(SETTING_BAUD_RATE);
-    doc[SETTING_DATA_AGE_THRESHOLD] = getInt(SETTING_DATA_AGE_THRESHOLD);
-    doc[SETTING_GPS_DATA_MODE] = getInt(SETTING_GPS_DATA_MODE);
-    doc[SETTING_GPS_ECHO] = getBool(SETTING_GPS_ECHO);
-    doc[SETTING_GPS_FIX_RATE] = getInt(SETTING_GPS_FIX_RATE);
-    doc[SETTING_GPS_LOG_ENABLED] = getBool(SETTING_GPS_LOG_ENABLED);
-    doc[SETTING_GPS_UPDATE_RATE] = getInt(SETTING_GPS_UPDATE_RATE);
-    doc[SETTING_REFRESH_INTERVAL_OTHER] = getInt(SETTING_REFRESH_INTERVAL_OTHER);
-    doc[SETTING_SCREEN_REFRESH_INTERVAL] = getInt(SETTING_SCREEN_REFRESH_INTERVAL);
-    doc[SETTING_BACKLIGHT] = getInt(SETTING_BACKLIGHT);
-    doc[SETTING_WIFI_HOSTNAME] = get(SETTING_WIFI_HOSTNAME);
-    doc[SETTING_WIFI_SSID] = get(SETTING_WIFI_SSID);
-    doc[SETTING_WIFI_PSK] = get(SETTING_WIFI_PSK);
-    doc[SETTING_UDP_ENABLED] = getBool(SETTING_UDP_ENABLED);
-    doc[SETTING_UDP_HOST] = get(SETTING_UDP_HOST);
-    doc[SETTING_UDP_PORT] = getInt(SETTING_UDP_PORT);
-    doc[SETTING_DISPLAY_ROTATION] = getInt(SETTING_DISPLAY_ROTATION);
+    doc[keyName(SETTING_AVERAGE_SPEED_WINDOW)] = getInt(SETTING_AVERAGE_SPEED_WINDOW);
+    doc[keyName(SETTING_BAUD_RATE)] = getInt(SETTING_BAUD_RATE);
+    doc[keyName(SETTING_DATA_AGE_THRESHOLD)] = getInt(SETTING_DATA_AGE_THRESHOLD);
+    doc[keyName(SETTING_GPS_DATA_MODE)] = getInt(SETTING_GPS_DATA_MODE);
+    doc[keyName(SETTING_GPS_ECHO)] = getBool(SETTING_GPS_ECHO);
+    doc[keyName(SETTING_GPS_FIX_RATE)] = getInt(SETTING_GPS_FIX_RATE);
+    doc[keyName(SETTING_GPS_LOG_ENABLED)] = getBool(SETTING_GPS_LOG_ENABLED);
+    doc[keyName(SETTING_GPS_UPDATE_RATE)] = getInt(SETTING_GPS_UPDATE_RATE);
+    doc[keyName(SETTING_REFRESH_INTERVAL_OTHER)] = getInt(SETTING_REFRESH_INTERVAL_OTHER);
+    doc[keyName(SETTING_SCREEN_REFRESH_INTERVAL)] = getInt(SETTING_SCREEN_REFRESH_INTERVAL);
+    doc[keyName(SETTING_BACKLIGHT)] = getInt(SETTING_BACKLIGHT);
+    doc[keyName(SETTING_WIFI_HOSTNAME)] = get(SETTING_WIFI_HOSTNAME);
+    doc[keyName(SETTING_WIFI_SSID)] = get(SETTING_WIFI_SSID);
+    doc[keyName(SETTING_WIFI_PSK)] = get(SETTING_WIFI_PSK);
+    doc[keyName(SETTING_UDP_ENABLED)] = getBool(SETTING_UDP_ENABLED);
+    doc[keyName(SETTING_UDP_HOST)] = get(SETTING_UDP_HOST);
+    doc[keyName(SETTING_UDP_PORT)] = getInt(SETTING_UDP_PORT);
+    doc[keyName(SETTING_UDP_BATCH)] = getBool(SETTING_UDP_BATCH, UDP_BATCH_DEFAULT);
+    doc[keyName(SETTING_UDP_BATCH_BYTES)] = getInt(SETTING_UDP_BATCH_BYTES, UDP_BATCH_BYTES_DEFAULT);
+    doc[keyName(SETTING_UDP_BATCH_DELAY)] = getInt(SETTING_UDP_BATCH_DELAY, UDP_BATCH_DELAY_DEFAULT);
+    doc[keyName(SETTING_UDP_OVERFLOW)] = getInt(SETTING_UDP_OVERFLOW, UDP_OVERFLOW_DEFAULT);
+    doc[keyName(SETTING_DISPLAY_ROTATION)] = getInt(SETTING_DISPLAY_ROTATION);
 
     String json;
     serializeJsonPretty(doc, json);
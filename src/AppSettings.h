@@ -2,9 +2,14 @@
 #define APP_SETTINGS_H
 
 #include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <atomic>
+
+#define SETTINGS_WRITE_DELAY_MS 2000   // quiet time before changed settings are written to flash
 
 #define AVG_SPEED_WINDOW_DEFAULT 10
-#define BAUD_RATE_DEFAULT 9600
+#define BAUD_RATE_DEFAULT 0        // automatic
 #define DATA_AGE_DEFAULT 5000
 #define DATA_AGE_THRESHOLD_DEFAULT 5000 // milliseconds
 #define GPS_DATA_MODE_DEFAULT 6  // RMC_GGA
@@ -19,52 +24,132 @@
 #define UDP_ENABLED_DEFAULT false
 #define UDP_HOST_DEFAULT ""
 #define UDP_PORT_DEFAULT 10110
+#define UDP_BATCH_DEFAULT false
+#define UDP_BATCH_BYTES_DEFAULT 1400
+#define UDP_BATCH_DELAY_DEFAULT 1000
+#define UDP_OVERFLOW_DEFAULT 0  // UDP_DROP_OLDEST
 #define DISPLAY_ROTATION_DEFAULT 1
 
-#define SETTING_AVERAGE_SPEED_WINDOW "avgSpeedWindow"
-#define SETTING_BAUD_RATE "baud"
-#define SETTING_DATA_AGE_THRESHOLD "dataAgeThres"
-#define SETTING_GPS_DATA_MODE "gpsDataMode"
-#define SETTING_GPS_ECHO "gpsEchoEnabled"
-#define SETTING_GPS_FIX_RATE "gpsFixRate"
-#define SETTING_GPS_LOG_ENABLED "gpsLogEnabled"
-#define SETTING_GPS_UPDATE_RATE "gpsUpdateRate"
-#define SETTING_REFRESH_INTERVAL_OTHER "refreshOther"
-#define SETTING_SCREEN_REFRESH_INTERVAL "refresh"
-#define SETTING_BACKLIGHT "backlight"
-#define SETTING_UDP_ENABLED "udpEnabled"
-#define SETTING_UDP_HOST "udpHost"
-#define SETTING_UDP_PORT "udpPort"
-#define SETTING_DISPLAY_ROTATION "displayRotation"
-#define SETTING_WIFI_HOSTNAME "hostname"
-#define SETTING_WIFI_PSK "wifiPSK"
-#define SETTING_WIFI_SSID "wifiSSID"
+/// @brief Every setting that is stored, as an index into AppSettings' table. The NVS key
+/// and type of each one are in AppSettings.cpp, in this order.
+enum SettingId : uint8_t {
+    SETTING_AVERAGE_SPEED_WINDOW = 0,
+    SETTING_BAUD_RATE,
+    SETTING_DATA_AGE_THRESHOLD,
+    SETTING_GPS_DATA_MODE,
+    SETTING_GPS_ECHO,
+    SETTING_GPS_FIX_RATE,
+    SETTING_GPS_LOG_ENABLED,
+    SETTING_GPS_UPDATE_RATE,
+    SETTING_REFRESH_INTERVAL_OTHER,
+    SETTING_SCREEN_REFRESH_INTERVAL,
+    SETTING_BACKLIGHT,
+    SETTING_UDP_ENABLED,
+    SETTING_UDP_HOST,
+    SETTING_UDP_PORT,
+    SETTING_UDP_BATCH,
+    SETTING_UDP_BATCH_BYTES,
+    SETTING_UDP_BATCH_DELAY,
+    SETTING_UDP_OVERFLOW,
+    SETTING_DISPLAY_ROTATION,
+    SETTING_WIFI_HOSTNAME,
+    SETTING_WIFI_PSK,
+    SETTING_WIFI_SSID,
+    SETTING_IS_CONFIGURED,
+
+    SETTING_COUNT
+};
+
 #define SPEED_AVG_WINDOW_DEFAULT 10
 #define WIFI_HOSTNAME_DEFAULT "GPS_S3"
 
 
+/// @brief Settings stored in NVS, all read into RAM by load(). Reads never touch flash,
+/// and bool, int and float reads don't take a lock. Changes are written back together
+/// once nothing has changed for SETTINGS_WRITE_DELAY_MS, or on flush().
+/// Safe to read and change from the main loop and the web server task; only the main
+/// loop should call loop() or flush(), since they write to flash.
 class AppSettings {
 public:
     AppSettings();
+    /// @brief Writes changed settings once they have settled, call from the main loop.
+    void loop();
+    /// @brief Writes every changed setting to flash now, e.g. before restarting.
+    void flush();
     void loadDefaults();
     bool load();
     bool load(String json);
 
-    void set(const char* key, const char* value);
-    void set(const char* key, String value);
-    void setBool(const char* key, bool value);
-    void setInt(const char* key, int value);
-    void setFloat(const char* key, float value);
+    void set(SettingId id, const char* value);
+    void set(SettingId id, String value);
+    void setBool(SettingId id, bool value);
+    void setInt(SettingId id, int value);
+    void setFloat(SettingId id, float value);
     
-    String get(const char* key, const char* defaultValue = "");
-    bool getBool(const char* key, bool defaultValue = false);
-    int getInt(const char* key, int defaultValue = 0);
-    float getFloat(const char* key, float defaultValue = 0.0f);
+    String get(SettingId id, const char* defaultValue = "");
+    bool getBool(SettingId id, bool defaultValue = false);
+    int getInt(SettingId id, int defaultValue = 0);
+    float getFloat(SettingId id, float defaultValue = 0.0f);
+
+    /// @brief The NVS and JSON key of a setting.
+    static const char* keyName(SettingId id);
+    static bool findKey(const char* key, SettingId& id);
     
     void printToLog();
+    void printStats();
     String getRawJson();
 private:
+    enum SettingType : uint8_t {
+        SETTING_TYPE_BOOL = 0,
+        SETTING_TYPE_INT,
+        SETTING_TYPE_FLOAT,
+        SETTING_TYPE_STRING
+    };
+
+    struct SettingInfo {
+        const char* key;
+        SettingType type;
+    };
+    static const SettingInfo SETTINGS[SETTING_COUNT];
+
+    struct CachedSetting {
+        std::atomic<bool> stored{false};   // has a value, in NVS or waiting to be written
+        std::atomic<uint32_t> bits{0};     // a bool, int or float value
+        bool dirty = false;                // guarded by _mutex
+        String stringValue;                // guarded by _mutex
+    };
+
+    /// @brief A setting's value copied out of the cache, to read or write NVS without
+    /// holding the mutex.
+    struct SettingValue {
+        SettingId id;
+        uint32_t bits;
+        String stringValue;
+    };
+
+    bool hasType(SettingId id, SettingType type) const;
+    bool readScalar(SettingId id, SettingType type, uint32_t& bits) const;
+    void setScalar(SettingId id, SettingType type, uint32_t bits);
+    bool readStored(SettingId id, SettingValue& value);
+    void writeStored(const SettingValue& value);
+    void markChanged(CachedSetting& setting);
+
     Preferences _prefs;
+    CachedSetting _cache[SETTING_COUNT];
+    // Guards the string values and dirty flags, never held while NVS is read or written
+    SemaphoreHandle_t _mutex;
+    StaticSemaphore_t _mutexState;
+    // Held for the whole of load(), flush() and clearing NVS, so one flush can't write an
+    // older snapshot over a newer one
+    SemaphoreHandle_t _flashMutex;
+    StaticSemaphore_t _flashMutexState;
+    std::atomic<uint32_t> _dirtyCount{0};
+    std::atomic<uint32_t> _lastChange{0};
+
+    uint32_t _flashReads = 0;
+    uint32_t _writeRequests = 0;
+    uint32_t _unchangedWrites = 0;
+    std::atomic<uint32_t> _flashWrites{0};
 };
 
 #endif // APP_SETTINGS_H
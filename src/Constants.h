@@ -1,9 +1,16 @@
 #pragma once
 
 #define WIFI_RECONNECT_TIMEOUT 5000
+#define RESTART_DELAY_MS 1000   // after a web request to restart, for the reply to reach the browser
 #define ENABLE_TELNET true
 #define GPS_RX_PIN 18
 #define GPS_TX_PIN 21
+// The ingest task shares core 1 with the Arduino loop, which it preempts for the few
+// microseconds it takes to drain the UART. On core 0 it would queue behind WiFi/lwIP,
+// the UDP sender and the screen flush. printgps reports its wakeup latency.
+#define GPS_INGEST_CORE 1
+#define UDP_TASK_CORE 0
+#define SCREEN_FLUSH_CORE 0
 
 #define BTN_RIGHT_PIN 14
 #define BTN_LEFT_PIN  0
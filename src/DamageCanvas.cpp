@@ -0,0 +1,467 @@
+#include "DamageCanvas.h"
+#include <TLogPlus.h>
+
+DamageCanvas::DamageCanvas(int16_t w, int16_t h, Arduino_TFT* output, Arduino_DataBus* bus)
+    : Arduino_Canvas(w, h, output), _tft(output), _bus(bus) {
+}
+
+bool DamageCanvas::begin(int32_t speed) {
+    if (!Arduino_Canvas::begin(speed)) {
+        return false;
+    }
+    // Without room for a copy of the panel every damaged row is sent
+    if (_shadow == nullptr && psramFound()) {
+        _shadow = (uint16_t*)ps_malloc((size_t)WIDTH * HEIGHT * sizeof(uint16_t));
+    }
+    _shadowValid = false;
+    invalidateAll();
+    return true;
+}
+
+void DamageCanvas::writePixelPreclipped(int16_t x, int16_t y, uint16_t color) {
+    if (_recording) recordLogical(x, y, 1, 1);
+    Arduino_Canvas::writePixelPreclipped(x, y, color);
+}
+
+void DamageCanvas::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+    if (_recording) recordLogical(x, y, 1, h);
+    Arduino_Canvas::writeFastVLine(x, y, h, color);
+}
+
+void DamageCanvas::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+    if (_recording) recordLogical(x, y, w, 1);
+    Arduino_Canvas::writeFastHLine(x, y, w, color);
+}
+
+void DamageCanvas::writeFillRectPreclipped(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    if (_recording) recordLogical(x, y, w, h);
+    Arduino_Canvas::writeFillRectPreclipped(x, y, w, h, color);
+}
+
+void DamageCanvas::fillScreen(uint16_t color) {
+    invalidateAll();
+    _recording = false;
+    Arduino_Canvas::fillScreen(color);
+    _recording = true;
+}
+
+void DamageCanvas::draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h) {
+    // Record the bitmap once rather than pixel by pixel
+    recordLogical(x, y, w, h);
+    _recording = false;
+    Arduino_Canvas::draw16bitRGBBitmap(x, y, bitmap, w, h);
+    _recording = true;
+}
+
+size_t DamageCanvas::write(uint8_t c) {
+    if (gfxFont == nullptr || textsize_x != 1 || textsize_y != 1 || wrap || c == '\n' || c == '\r') {
+        return Arduino_Canvas::write(c);
+    }
+    const CachedFont* font = _glyphs.get(gfxFont);
+    if (font == nullptr) {
+        return Arduino_Canvas::write(c);
+    }
+    const CachedGlyph* glyph = font->glyph(c);
+    if (glyph != nullptr) {
+        drawGlyph(cursor_x, cursor_y, *font, *glyph, textcolor);
+        cursor_x += glyph->advance;
+    }
+    return 1;
+}
+
+void DamageCanvas::measureText(const char* text, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) {
+    const CachedFont* font = gfxFont != nullptr && textsize_x == 1 && textsize_y == 1 ? _glyphs.get(gfxFont) : nullptr;
+    if (font == nullptr) {
+        getTextBounds(text, 0, 0, x1, y1, w, h);
+        return;
+    }
+    font->measure(text, x1, y1, w, h);
+}
+
+void DamageCanvas::drawGlyph(int16_t x, int16_t y, const CachedFont& font, const CachedGlyph& glyph, uint16_t color) {
+    if (glyph.runCount == 0) {
+        return;
+    }
+    const GlyphRun* runs = font.runs(glyph);
+    int16_t left = x + glyph.xOffset;
+    int16_t top = y + glyph.yOffset;
+    if (left < 0 || top < 0 || left + glyph.width > _width || top + glyph.height > _height) {
+        // Partly off the canvas, let each run be clipped
+        for (uint16_t i = 0; i < glyph.runCount; i++) {
+            drawFastHLine(x + runs[i].x, y + runs[i].y, runs[i].length, color);
+        }
+        return;
+    }
+
+    // One damage rectangle for the whole glyph, then fill its runs straight into the framebuffer
+    recordLogical(left, top, glyph.width, glyph.height);
+    uint16_t* framebuffer = getFramebuffer();
+    for (uint16_t i = 0; i < glyph.runCount; i++) {
+        int16_t nx = x + runs[i].x, ny = y + runs[i].y, nw = runs[i].length, nh = 1;
+        toNative(nx, ny, nw, nh);
+        for (int16_t row = 0; row < nh; row++) {
+            uint16_t* pixel = framebuffer + (int32_t)(ny + row) * WIDTH + nx;
+            for (int16_t col = 0; col < nw; col++) {
+                *pixel++ = color;
+            }
+        }
+    }
+}
+
+void DamageCanvas::drawImage(int16_t x, int16_t y, Image565& image) {
+    int16_t w = image.width();
+    int16_t h = image.height();
+    const uint16_t* pixels = image.rotated(_rotation);
+    if (pixels == nullptr) {
+        return;
+    }
+    if (x < 0 || y < 0 || x + w > _width || y + h > _height) {
+        // Rare enough that clipping pixel by pixel is fine
+        startWrite();
+        for (int16_t j = 0; j < h; j++) {
+            for (int16_t i = 0; i < w; i++) {
+                uint16_t pixel = image.pixels()[(int32_t)j * w + i];
+                if (!image.hasTransparency() || pixel != image.transparentColor()) {
+                    writePixel(x + i, y + j, pixel);
+                }
+            }
+        }
+        endWrite();
+        return;
+    }
+
+    toNative(x, y, w, h);
+    recordNative(x, y, w, h);
+    uint16_t* framebuffer = getFramebuffer();
+    for (int16_t row = 0; row < h; row++) {
+        uint16_t* target = framebuffer + (int32_t)(y + row) * WIDTH + x;
+        const uint16_t* source = pixels + (int32_t)row * w;
+        if (!image.hasTransparency()) {
+            memcpy(target, source, w * sizeof(uint16_t));
+            continue;
+        }
+        uint16_t key = image.transparentColor();
+        for (int16_t col = 0; col < w; col++) {
+            if (source[col] != key) {
+                target[col] = source[col];
+            }
+        }
+    }
+}
+
+void DamageCanvas::drawRow(int16_t x, int16_t y, const uint16_t* pixels, int16_t w, bool transparent, uint16_t key) {
+    if (y < 0 || y >= _height) {
+        return;
+    }
+    int16_t first = x < 0 ? -x : 0;
+    int16_t last = min(w, (int16_t)(_width - x));
+    if (first >= last) {
+        return;
+    }
+    recordLogical(x + first, y, last - first, 1);
+
+    uint16_t* framebuffer = getFramebuffer();
+    if (_rotation == 0 && !transparent) {
+        memcpy(framebuffer + (int32_t)y * WIDTH + x + first, pixels + first, (last - first) * sizeof(uint16_t));
+        return;
+    }
+    for (int16_t i = first; i < last; i++) {
+        if (transparent && pixels[i] == key) {
+            continue;
+        }
+        int16_t nx = x + i, ny = y, nw = 1, nh = 1;
+        toNative(nx, ny, nw, nh);
+        framebuffer[(int32_t)ny * WIDTH + nx] = pixels[i];
+    }
+}
+
+uint16_t DamageCanvas::getLogicalPixel(int16_t x, int16_t y) {
+    int16_t w = 1, h = 1;
+    toNative(x, y, w, h);
+    return getFramebuffer()[(int32_t)y * WIDTH + x];
+}
+
+void DamageCanvas::clearPreviousDamage(uint16_t color) {
+    uint16_t* framebuffer = getFramebuffer();
+    for (uint8_t i = 0; i < _previousCount; i++) {
+        const DamageRect& rect = _previous[i];
+        for (int16_t row = rect.y; row < rect.y + rect.h; row++) {
+            uint16_t* pixel = framebuffer + (int32_t)row * WIDTH + rect.x;
+            for (int16_t col = 0; col < rect.w; col++) {
+                *pixel++ = color;
+            }
+        }
+    }
+}
+
+void DamageCanvas::invalidateAll() {
+    _damage[0] = { 0, 0, WIDTH, HEIGHT };
+    _damageCount = 1;
+}
+
+void DamageCanvas::flushDamage() {
+    uint32_t start = micros();
+    // The front buffer can't change until the panel has the previous frame
+    waitForFlush();
+    _flushWait.record(micros() - start);
+    _lastFlushPixels = 0;
+    _runCount = 0;
+
+    // Whatever was cleared from last frame has to go out as well as what was drawn. Merged
+    // first, so pixels in both are only sent once.
+    DamageRect regions[DAMAGE_MAX_RECTS];
+    uint8_t regionCount = 0;
+    for (uint8_t i = 0; i < _previousCount; i++) {
+        addRect(regions, regionCount, _previous[i]);
+    }
+    for (uint8_t i = 0; i < _damageCount; i++) {
+        addRect(regions, regionCount, _damage[i]);
+    }
+    uint32_t area = 0;
+    for (uint8_t i = 0; i < regionCount; i++) {
+        area += (uint32_t)regions[i].w * regions[i].h;
+    }
+    if (area >= getFullFramePixels()) {
+        // As much as the whole frame, so send it in one window
+        regions[0] = { 0, 0, WIDTH, HEIGHT };
+        regionCount = 1;
+    }
+    for (uint8_t i = 0; i < regionCount; i++) {
+        flushRect(regions[i]);
+    }
+    _shadowValid = _shadow != nullptr;
+
+    memcpy(_previous, _damage, sizeof(DamageRect) * _damageCount);
+    _previousCount = _damageCount;
+    _damageCount = 0;
+
+    if (_shadow == nullptr) {
+        _flushTime.record(micros() - start);
+    } else if (_flushTask != nullptr) {
+        if (_runCount > 0) {
+            _flushPending = true;
+            xTaskNotifyGive(_flushTask);
+        }
+    } else {
+        pushQueuedRuns();
+    }
+}
+
+bool DamageCanvas::startFlushTask(int core) {
+    if (_flushTask != nullptr) {
+        return true;
+    }
+    if (_shadow == nullptr) {
+        TLogPlus::Log.warningln("Screen: No memory for a front buffer, flushing on the drawing task");
+        return false;
+    }
+
+    _flushDone = xSemaphoreCreateBinaryStatic(&_flushDoneState);
+    BaseType_t result = xTaskCreatePinnedToCore(flushTask, "screen_flush", DAMAGE_FLUSH_STACK_SIZE,
+                                                this, DAMAGE_FLUSH_PRIORITY, &_flushTask, core);
+    if (result != pdPASS) {
+        TLogPlus::Log.errorln("Screen: Failed to start flush task.");
+        _flushTask = nullptr;
+        return false;
+    }
+    TLogPlus::Log.infoln("Screen: Flush task started on core %d", core);
+    return true;
+}
+
+void DamageCanvas::waitForFlush() {
+    if (!_flushPending) {
+        return;
+    }
+    xSemaphoreTake(_flushDone, portMAX_DELAY);
+    _flushPending = false;
+}
+
+void DamageCanvas::flushTask(void* param) {
+    DamageCanvas* canvas = static_cast<DamageCanvas*>(param);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        canvas->pushQueuedRuns();
+        xSemaphoreGive(canvas->_flushDone);
+    }
+}
+
+/// @brief Finds the runs of rows inside rect that differ from the front buffer, copies them
+/// across and queues them to be sent. Without a front buffer they are sent straight away.
+void DamageCanvas::flushRect(const DamageRect& rect) {
+    uint16_t* framebuffer = getFramebuffer();
+    if (_shadow == nullptr) {
+        pushRows(framebuffer, rect.x, rect.y, rect.w, rect.h);
+        _lastFlushPixels += (uint32_t)rect.w * rect.h;
+        return;
+    }
+    if (!_shadowValid) {
+        queueRun(rect.x, rect.y, rect.w, rect.h);
+        return;
+    }
+
+    int16_t runStart = -1, runLeft = 0, runRight = 0;
+    for (int16_t row = rect.y; row <= rect.y + rect.h; row++) {
+        int16_t left = -1, right = -1;
+        if (row < rect.y + rect.h) {
+            const uint16_t* drawn = framebuffer + (int32_t)row * WIDTH + rect.x;
+            const uint16_t* shown = _shadow + (int32_t)row * WIDTH + rect.x;
+            for (int16_t col = 0; col < rect.w; col++) {
+                if (drawn[col] != shown[col]) { left = col; break; }
+            }
+            if (left >= 0) {
+                for (int16_t col = rect.w - 1; col >= left; col--) {
+                    if (drawn[col] != shown[col]) { right = col; break; }
+                }
+            }
+        }
+
+        if (left >= 0) {
+            if (runStart < 0) {
+                runStart = row;
+                runLeft = left;
+                runRight = right;
+            } else {
+                runLeft = min(runLeft, left);
+                runRight = max(runRight, right);
+            }
+        } else if (runStart >= 0) {
+            // An unchanged row (or the end of the rectangle) closes the run
+            queueRun(rect.x + runLeft, runStart, runRight - runLeft + 1, row - runStart);
+            runStart = -1;
+        }
+    }
+}
+
+/// @brief Copies a region of the framebuffer into the front buffer and queues it to be sent.
+void DamageCanvas::queueRun(int16_t x, int16_t y, int16_t w, int16_t h) {
+    uint16_t* framebuffer = getFramebuffer();
+    for (int16_t row = y; row < y + h; row++) {
+        int32_t offset = (int32_t)row * WIDTH + x;
+        memcpy(_shadow + offset, framebuffer + offset, w * sizeof(uint16_t));
+    }
+    _lastFlushPixels += (uint32_t)w * h;
+
+    DamageRect run = { x, y, w, h };
+    if (_runCount == DAMAGE_MAX_RUNS) {
+        // Outside the queued runs the front buffer matches the panel, so a larger
+        // region only resends pixels the panel already shows
+        _runs[_runCount - 1] = combine(_runs[_runCount - 1], run);
+        return;
+    }
+    _runs[_runCount++] = run;
+}
+
+void DamageCanvas::pushQueuedRuns() {
+    uint32_t start = micros();
+    for (uint8_t i = 0; i < _runCount; i++) {
+        pushRows(_shadow, _runs[i].x, _runs[i].y, _runs[i].w, _runs[i].h);
+    }
+    _flushTime.record(micros() - start);
+}
+
+void DamageCanvas::pushRows(const uint16_t* source, int16_t x, int16_t y, int16_t w, int16_t h) {
+    _tft->startWrite();
+    _tft->writeAddrWindow(x, y, w, h);
+    for (int16_t row = y; row < y + h; row++) {
+        _bus->writePixels((uint16_t*)source + (int32_t)row * WIDTH + x, w);
+    }
+    _tft->endWrite();
+}
+
+/// @brief Clips a rectangle in rotated (drawing) coordinates and records it in
+/// framebuffer coordinates.
+void DamageCanvas::recordLogical(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > _width) w = _width - x;
+    if (y + h > _height) h = _height - y;
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+
+    toNative(x, y, w, h);
+    recordNative(x, y, w, h);
+}
+
+/// @brief Converts a rectangle in rotated (drawing) coordinates to framebuffer coordinates.
+void DamageCanvas::toNative(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const {
+    int16_t nx = x, ny = y, nw = w, nh = h;
+    switch (_rotation) {
+        case 1:
+            nx = WIDTH - y - h; ny = x; nw = h; nh = w;
+            break;
+        case 2:
+            nx = WIDTH - x - w; ny = HEIGHT - y - h;
+            break;
+        case 3:
+            nx = y; ny = HEIGHT - x - w; nw = h; nh = w;
+            break;
+        default:
+            break;
+    }
+    x = nx; y = ny; w = nw; h = nh;
+}
+
+void DamageCanvas::recordNative(int16_t x, int16_t y, int16_t w, int16_t h) {
+    addRect(_damage, _damageCount, { x, y, w, h });
+}
+
+/// @brief Adds rect to a set of up to DAMAGE_MAX_RECTS rectangles, merging it with any it
+/// touches, so the rectangles in the set never overlap.
+void DamageCanvas::addRect(DamageRect* rects, uint8_t& count, DamageRect rect) {
+    // Text is drawn a pixel at a time, so check the rectangle added last first
+    for (int8_t i = count - 1; i >= 0; i--) {
+        const DamageRect& existing = rects[i];
+        if (rect.x >= existing.x && rect.y >= existing.y &&
+            rect.x + rect.w <= existing.x + existing.w && rect.y + rect.h <= existing.y + existing.h) {
+            return;
+        }
+    }
+
+    // Grow into any rectangle it touches, which may in turn touch others
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (uint8_t i = 0; i < count; i++) {
+            if (nearby(rects[i], rect)) {
+                rect = combine(rects[i], rect);
+                rects[i] = rects[--count];
+                merged = true;
+                break;
+            }
+        }
+    }
+
+    if (count == DAMAGE_MAX_RECTS) {
+        // Out of slots, fold it into whichever rectangle grows the least
+        uint8_t best = 0;
+        int32_t bestGrowth = INT32_MAX;
+        for (uint8_t i = 0; i < count; i++) {
+            DamageRect joined = combine(rects[i], rect);
+            int32_t growth = (int32_t)joined.w * joined.h - (int32_t)rects[i].w * rects[i].h;
+            if (growth < bestGrowth) {
+                bestGrowth = growth;
+                best = i;
+            }
+        }
+        rect = combine(rects[best], rect);
+        rects[best] = rects[--count];
+        // Grown, it may now touch others
+        addRect(rects, count, rect);
+        return;
+    }
+    rects[count++] = rect;
+}
+
+bool DamageCanvas::nearby(const DamageRect& a, const DamageRect& b) {
+    return a.x - DAMAGE_MERGE_DISTANCE <= b.x + b.w && b.x - DAMAGE_MERGE_DISTANCE <= a.x + a.w &&
+           a.y - DAMAGE_MERGE_DISTANCE <= b.y + b.h && b.y - DAMAGE_MERGE_DISTANCE <= a.y + a.h;
+}
+
+DamageCanvas::DamageRect DamageCanvas::combine(const DamageRect& a, const DamageRect& b) {
+    int16_t left = min(a.x, b.x);
+    int16_t top = min(a.y, b.y);
+    int16_t right = max(a.x + a.w, b.x + b.w);
+    int16_t bottom = max(a.y + a.h, b.y + b.h);
+    return { left, top, (int16_t)(right - left), (int16_t)(bottom - top) };
+}
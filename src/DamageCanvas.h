@@ -0,0 +1,114 @@
+#pragma once
+#include <Arduino_GFX_Library.h>
+#include "LatencyHistogram.h"
+#include "Image565.h"
+#include "GlyphCache.h"
+
+#define DAMAGE_MAX_RECTS 16
+#define DAMAGE_MERGE_DISTANCE 4   // rectangles closer than this are combined
+#define DAMAGE_MAX_RUNS 48        // row runs queued for the flush task per frame
+#define DAMAGE_FLUSH_STACK_SIZE 2048
+#define DAMAGE_FLUSH_PRIORITY 2
+
+/// @brief Canvas that remembers which parts of the framebuffer each draw call touched,
+/// so flushDamage() only sends those regions to the panel instead of the full frame.
+/// Rectangles are kept in framebuffer (panel) coordinates, after rotation.
+///
+/// With PSRAM for a second frame the canvas is double buffered: drawing goes to the
+/// framebuffer, flushDamage() copies the rows that changed into the front buffer and a
+/// task on the other core sends them to the panel while the next frame is drawn.
+class DamageCanvas : public Arduino_Canvas {
+public:
+    DamageCanvas(int16_t w, int16_t h, Arduino_TFT* output, Arduino_DataBus* bus);
+
+    bool begin(int32_t speed = GFX_NOT_DEFINED) override;
+
+    void writePixelPreclipped(int16_t x, int16_t y, uint16_t color) override;
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+    void writeFillRectPreclipped(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+    void fillScreen(uint16_t color) override;
+    using Arduino_Canvas::draw16bitRGBBitmap;
+    void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h) override;
+    /// @brief Draws text in a GFXfont from the glyph cache, one record and a few fills per
+    /// character instead of a pixel at a time. Anything else goes through Arduino_GFX.
+    using Arduino_Canvas::write;
+    size_t write(uint8_t c) override;
+    /// @brief getTextBounds() for one line in the current font, from the cached metrics.
+    void measureText(const char* text, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h);
+    const GlyphCache& getGlyphCache() const { return _glyphs; }
+
+    /// @brief Copies an image into the framebuffer a row at a time, skipping its
+    /// transparent pixels if it has any.
+    void drawImage(int16_t x, int16_t y, Image565& image);
+    /// @brief Writes one row of an image that is being decoded as it is drawn.
+    void drawRow(int16_t x, int16_t y, const uint16_t* pixels, int16_t w, bool transparent, uint16_t key);
+
+    /// @brief Reads back a pixel in rotated (drawing) coordinates.
+    uint16_t getLogicalPixel(int16_t x, int16_t y);
+
+    /// @brief Fills what was drawn last frame with color, ready to draw the next one.
+    void clearPreviousDamage(uint16_t color);
+    /// @brief Marks the whole frame as changed, e.g. after a rotation or screen switch.
+    void invalidateAll();
+    /// @brief Sends the rows that changed within this and the last frame's damage. Once the
+    /// flush task is running this only waits for the previous frame, then hands this one off.
+    void flushDamage();
+    /// @brief Moves sending frames to the panel onto a task pinned to core. Needs the
+    /// front buffer, so without PSRAM flushDamage() keeps sending frames itself.
+    bool startFlushTask(int core);
+    /// @brief Blocks until the panel shows the last frame handed to the flush task. Call it
+    /// before anything else talks to the panel.
+    void waitForFlush();
+
+    const LatencyHistogram& getFlushTime() const { return _flushTime; }
+    /// @brief Time flushDamage() spent waiting for the previous frame to finish sending.
+    const LatencyHistogram& getFlushWait() const { return _flushWait; }
+    bool isFlushAsync() const { return _flushTask != nullptr; }
+    uint32_t getLastFlushPixels() const { return _lastFlushPixels; }
+    uint32_t getFullFramePixels() const { return (uint32_t)WIDTH * HEIGHT; }
+
+private:
+    struct DamageRect {
+        int16_t x, y, w, h;
+    };
+
+    void drawGlyph(int16_t x, int16_t y, const CachedFont& font, const CachedGlyph& glyph, uint16_t color);
+    void recordLogical(int16_t x, int16_t y, int16_t w, int16_t h);
+    void recordNative(int16_t x, int16_t y, int16_t w, int16_t h);
+    void toNative(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+    void flushRect(const DamageRect& rect);
+    void queueRun(int16_t x, int16_t y, int16_t w, int16_t h);
+    void pushRows(const uint16_t* source, int16_t x, int16_t y, int16_t w, int16_t h);
+    void pushQueuedRuns();
+    static void flushTask(void* param);
+    static void addRect(DamageRect* rects, uint8_t& count, DamageRect rect);
+    static bool nearby(const DamageRect& a, const DamageRect& b);
+    static DamageRect combine(const DamageRect& a, const DamageRect& b);
+
+    Arduino_TFT* _tft;
+    Arduino_DataBus* _bus;
+    // Last frame handed to the panel, compared against to skip unchanged rows. Doubles
+    // as the front buffer the flush task sends from.
+    uint16_t* _shadow = nullptr;
+    bool _shadowValid = false;
+    bool _recording = true;
+
+    TaskHandle_t _flushTask = nullptr;
+    SemaphoreHandle_t _flushDone = nullptr;
+    StaticSemaphore_t _flushDoneState;
+    bool _flushPending = false;
+    // Regions of the front buffer still to be sent, written only while no flush is pending
+    DamageRect _runs[DAMAGE_MAX_RUNS];
+    uint8_t _runCount = 0;
+
+    DamageRect _damage[DAMAGE_MAX_RECTS];
+    uint8_t _damageCount = 0;
+    DamageRect _previous[DAMAGE_MAX_RECTS];
+    uint8_t _previousCount = 0;
+
+    GlyphCache _glyphs;
+    LatencyHistogram _flushTime;
+    LatencyHistogram _flushWait;
+    uint32_t _lastFlushPixels = 0;
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+
+#define FIXED_TRIG_SHIFT 14
+#define FIXED_TRIG_ONE (1 << FIXED_TRIG_SHIFT)   // 1.0 in the values returned below
+
+/// @brief sin() of each whole degree from 0 to 90, scaled by FIXED_TRIG_ONE.
+static const int16_t FIXED_SINE_TABLE[91] = {
+        0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+     2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+     5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+     8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384,
+};
+
+/// @brief Sine of an angle in whole degrees, scaled by FIXED_TRIG_ONE.
+inline int32_t fixedSin(int degrees) {
+    degrees %= 360;
+    if (degrees < 0) degrees += 360;
+    if (degrees <= 90) return FIXED_SINE_TABLE[degrees];
+    if (degrees <= 180) return FIXED_SINE_TABLE[180 - degrees];
+    if (degrees <= 270) return -FIXED_SINE_TABLE[degrees - 180];
+    return -FIXED_SINE_TABLE[360 - degrees];
+}
+
+/// @brief Cosine of an angle in whole degrees, scaled by FIXED_TRIG_ONE.
+inline int32_t fixedCos(int degrees) {
+    return fixedSin(degrees + 90);
+}
+
+/// @brief Scales length by a fixed point sine or cosine, rounding to the nearest pixel.
+inline int32_t fixedScale(int32_t length, int32_t fixedValue) {
+    return (length * fixedValue + (FIXED_TRIG_ONE / 2)) >> FIXED_TRIG_SHIFT;
+}
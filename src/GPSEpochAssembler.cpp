@@ -0,0 +1,126 @@
+#include "GPSEpochAssembler.h"
+
+GPSEpochAssembler::GPSEpochAssembler()
+    : _epoch(), _published(), _epochHasTime(false), _epochTime(0), _expected(0), _sequence(0), _incomplete(0),
+      _held(false), _satellites(), _satellitePart(0), _satelliteParts(0), _satellitesCarried(false),
+      _satellitesTrail(false) {
+}
+
+bool GPSEpochAssembler::add(const GPSFix& sentence, uint8_t part, uint8_t parts) {
+    if (sentence.sentences & GPS_SENTENCE_BIT(NMEA_GSV)) {
+        return addSatellites(sentence, part, parts);
+    }
+
+    bool published = false;
+
+    // Anything but GSV after a held epoch belongs to the next one
+    if (_held) {
+        publish();
+        published = true;
+    }
+
+    // A different timestamp means the receiver moved on before the epoch was complete
+    if ((sentence.fields & GPS_FIELD_TIME) && _epochHasTime && sentence.time != _epochTime) {
+        publish();
+        published = true;
+    }
+
+    if ((sentence.fields & GPS_FIELD_TIME) && !_epochHasTime) {
+        _epochTime = sentence.time;
+        _epochHasTime = true;
+    }
+    _epoch.merge(sentence);
+
+    return completeEpoch() || published;
+}
+
+/// @brief Collects a GSV group and adds it to its epoch once the last message arrives.
+bool GPSEpochAssembler::addSatellites(const GPSFix& sentence, uint8_t part, uint8_t parts) {
+    bool published = false;
+
+    if (part == 1) {
+        if (!_held && (_epoch.sentences & GPS_SENTENCE_BIT(NMEA_GSV))) {
+            // A second report in one epoch means the receiver has moved on (GSV only mode)
+            publish();
+            published = true;
+        }
+        // Straight after a publish, the group trails the record that was just sent out
+        // unless that record already had one of its own. It's too late for that record,
+        // but from now on complete epochs wait for their group.
+        _satellitesCarried = !_held && _epoch.sentences == 0 && _sequence > 0 &&
+                             !(_published.sentences & GPS_SENTENCE_BIT(NMEA_GSV));
+        if (_satellitesCarried) {
+            _satellitesTrail = true;
+        }
+        _satellites = GPSFix();
+        _satelliteParts = parts;
+    } else if (_satellitePart == 0 || part != _satellitePart + 1 || parts != _satelliteParts) {
+        // Missed a message, the group can't be completed so its epoch needn't wait for it
+        _satellitePart = 0;
+        if (_held) {
+            publish();
+            published = true;
+        }
+        return published;
+    }
+    _satellitePart = part;
+    _satellites.merge(sentence);
+
+    if (part < parts) {
+        return published;
+    }
+    _satellitePart = 0;
+
+    if (_satellitesCarried) {
+        // Carry the values into the epoch in progress without claiming the sentence for it
+        uint16_t sentences = _epoch.sentences;
+        _epoch.merge(_satellites);
+        _epoch.sentences = sentences;
+        return published;
+    }
+    _epoch.merge(_satellites);
+    _held = false;
+    return completeEpoch() || published;
+}
+
+/// @brief Publishes the epoch in progress if it is complete, or holds it while its GSV
+/// group is open or expected to follow.
+/// @return true when this published.
+bool GPSEpochAssembler::completeEpoch() {
+    if (!isComplete()) {
+        return false;
+    }
+    bool hasSatellites = _epoch.sentences & GPS_SENTENCE_BIT(NMEA_GSV);
+    bool groupOpen = _satellitePart != 0 && !_satellitesCarried;
+    if (groupOpen || (_satellitesTrail && !hasSatellites)) {
+        _held = true;
+        return false;
+    }
+    publish();
+    return true;
+}
+
+bool GPSEpochAssembler::flush() {
+    if (!hasPendingSentences()) {
+        return false;
+    }
+    publish();
+    return true;
+}
+
+void GPSEpochAssembler::publish() {
+    if ((_epoch.sentences & _expected) != _expected) {
+        _incomplete++;
+    }
+    _published = _epoch;
+    _sequence++;
+    _held = false;
+    // A group still open described the record just published
+    if (_satellitePart != 0) {
+        _satellitesCarried = true;
+    }
+
+    // Start the next epoch from the values we have so far
+    _epoch.sentences = 0;
+    _epochHasTime = false;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <stdint.h>
+#include "GPSFix.h"
+
+/// @brief Groups the sentences a receiver emits for one fix (keyed on their UTC time)
+/// into a single GPSFix record. A record is published once every expected sentence
+/// has arrived, or when a sentence for a newer fix shows up first. The published
+/// record's sentences field is the completeness bitmask for that epoch.
+///
+/// GSV has no timestamp and comes as a group of messages (1 of N ... N of N), so it
+/// belongs to the epoch in progress when message 1 arrives. An epoch whose group is
+/// still open when its other sentences complete it is held until the group finishes.
+/// Once a group has been seen to trail its epoch (message 1 straight after the publish),
+/// every complete epoch without one is held for it in the same way. A held epoch is
+/// published when its group completes or is broken, when any other sentence arrives, or
+/// on flush() after the epoch timeout, so each epoch is still published exactly once.
+/// The trailing group that taught the assembler to wait goes into the next epoch's
+/// values without counting as one of its sentences.
+class GPSEpochAssembler {
+public:
+    GPSEpochAssembler();
+
+    /// @brief Sets the GPS_SENTENCE_BIT() mask that makes an epoch complete.
+    void setExpectedSentences(uint16_t mask) {
+        _expected = mask;
+        _satellitesTrail = false;
+    }
+    uint16_t getExpectedSentences() const { return _expected; }
+
+    /// @brief Adds the fields decoded from one sentence. part and parts are the GSV
+    /// message number and count, see NMEAParser::sentencePart.
+    /// @return true when this published a new record.
+    bool add(const GPSFix& sentence, uint8_t part = 1, uint8_t parts = 1);
+
+    /// @brief Publishes the epoch in progress, if it has any sentences.
+    bool flush();
+    bool hasPendingSentences() const { return _epoch.sentences != 0; }
+
+    /// @brief The last published record. Values are carried over from earlier epochs
+    /// for sentences that did not arrive in this one.
+    const GPSFix& published() const { return _published; }
+    uint32_t getSequence() const { return _sequence; }
+    uint32_t getIncompleteCount() const { return _incomplete; }
+
+private:
+    void publish();
+    bool addSatellites(const GPSFix& sentence, uint8_t part, uint8_t parts);
+    bool isComplete() const { return _expected != 0 && (_epoch.sentences & _expected) == _expected; }
+    bool completeEpoch();
+
+    GPSFix _epoch;
+    GPSFix _published;
+    bool _epochHasTime;
+    uint32_t _epochTime;
+    uint16_t _expected;
+    uint32_t _sequence;
+    uint32_t _incomplete;
+    bool _held;                     // complete, waiting for its GSV group
+
+    // GSV group being collected
+    GPSFix _satellites;
+    uint8_t _satellitePart;         // last message added, 0 when no group is open
+    uint8_t _satelliteParts;
+    bool _satellitesCarried;        // trails an epoch already published, values only
+    bool _satellitesTrail;          // groups come after the rest of their epoch
+};
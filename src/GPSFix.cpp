@@ -0,0 +1,39 @@
+#include "GPSFix.h"
+
+void GPSFix::merge(const GPSFix& other)
+{
+    if (other.fields & GPS_FIELD_TIME) time = other.time;
+    if (other.fields & GPS_FIELD_DATE) date = other.date;
+    if (other.fields & GPS_FIELD_STATUS) active = other.active;
+    if (other.fields & GPS_FIELD_LOCATION) {
+        latitude = other.latitude;
+        longitude = other.longitude;
+    }
+    if (other.fields & GPS_FIELD_SPEED) speed = other.speed;
+    if (other.fields & GPS_FIELD_COURSE) course = other.course;
+    if (other.fields & GPS_FIELD_ALTITUDE) altitude = other.altitude;
+    if (other.fields & GPS_FIELD_QUALITY) quality = other.quality;
+    if (other.fields & GPS_FIELD_SATELLITES) satellites = other.satellites;
+    if (other.fields & GPS_FIELD_HDOP) hdop = other.hdop;
+    if (other.fields & GPS_FIELD_FIX_TYPE) fixType = other.fixType;
+    if (other.fields & GPS_FIELD_IN_VIEW) satellitesInView = other.satellitesInView;
+    if (other.fields & GPS_FIELD_ANTENNA) antenna = other.antenna;
+
+    fields |= other.fields;
+    sentences |= other.sentences;
+}
+
+int64_t GPSFix::epochMillis() const
+{
+    if (!has(GPS_FIELD_TIME | GPS_FIELD_DATE) || month() == 0 || day() == 0) {
+        return -1;
+    }
+    // Days since the epoch for a proleptic Gregorian date, with March as the first month
+    int32_t y = year() - (month() <= 2 ? 1 : 0);
+    int32_t era = y / 400;
+    uint32_t yearOfEra = y - era * 400;
+    uint32_t dayOfYear = (153 * (month() + (month() > 2 ? -3 : 9)) + 2) / 5 + day() - 1;
+    uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    int64_t days = (int64_t)era * 146097 + dayOfEra - 719468;
+    return days * 86400000LL + time;
+}
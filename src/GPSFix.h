@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+
+enum NMEASentenceType : uint8_t
+{
+    NMEA_UNKNOWN = 0,
+    NMEA_RMC,
+    NMEA_GGA,
+    NMEA_GSA,
+    NMEA_GSV,
+    NMEA_VTG,
+    NMEA_GLL,
+    NMEA_PGTOP,
+
+    NMEA_SENTENCE_MAX
+};
+
+// Bits for GPSFix::fields, set when the field carries a value
+#define GPS_FIELD_TIME        (1 << 0)
+#define GPS_FIELD_DATE        (1 << 1)
+#define GPS_FIELD_STATUS      (1 << 2)
+#define GPS_FIELD_LOCATION    (1 << 3)
+#define GPS_FIELD_SPEED       (1 << 4)
+#define GPS_FIELD_COURSE      (1 << 5)
+#define GPS_FIELD_ALTITUDE    (1 << 6)
+#define GPS_FIELD_QUALITY     (1 << 7)
+#define GPS_FIELD_SATELLITES  (1 << 8)
+#define GPS_FIELD_HDOP        (1 << 9)
+#define GPS_FIELD_FIX_TYPE    (1 << 10)
+#define GPS_FIELD_IN_VIEW     (1 << 11)
+#define GPS_FIELD_ANTENNA     (1 << 12)
+
+#define GPS_SENTENCE_BIT(type) (1 << (type))
+
+/// @brief Fixed-layout GPS state. Angles are in microdegrees and the remaining
+/// measurements are fixed point so the struct can be copied around freely.
+struct GPSFix
+{
+    uint16_t fields;          // GPS_FIELD_* bits with a value
+    uint16_t sentences;       // GPS_SENTENCE_BIT() of each sentence merged in
+    uint32_t time;            // milliseconds since midnight UTC
+    uint16_t date;            // (year - 2000) << 9 | month << 5 | day
+    int32_t latitude;         // microdegrees, north positive
+    int32_t longitude;        // microdegrees, east positive
+    int32_t altitude;         // centimeters above mean sea level
+    uint32_t speed;           // hundredths of a knot
+    uint16_t course;          // hundredths of a degree from true north
+    uint16_t hdop;            // hundredths
+    uint8_t quality;          // GGA fix quality (0 = invalid, 1 = GPS, 2 = DGPS)
+    uint8_t fixType;          // GSA fix type (1 = none, 2 = 2D, 3 = 3D)
+    uint8_t satellites;       // satellites used in the solution
+    uint8_t satellitesInView; // satellites reported by GSV
+    uint8_t antenna;          // PGTOP antenna status
+    bool active;              // receiver reports a valid position
+
+    bool has(uint16_t field) const { return (fields & field) == field; }
+
+    uint8_t hour() const { return time / 3600000UL; }
+    uint8_t minute() const { return (time / 60000UL) % 60; }
+    uint8_t second() const { return (time / 1000UL) % 60; }
+    uint16_t millisecond() const { return time % 1000UL; }
+
+    uint16_t year() const { return 2000 + (date >> 9); }
+    uint8_t month() const { return (date >> 5) & 0x0F; }
+    uint8_t day() const { return date & 0x1F; }
+
+    /// @brief Milliseconds since 1970-01-01 UTC, or -1 without both a date and a time.
+    int64_t epochMillis() const;
+
+    /// @brief Copies every field that other has a value for on top of this fix.
+    void merge(const GPSFix& other);
+};
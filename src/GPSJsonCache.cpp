@@ -0,0 +1,128 @@
+#include "GPSJsonCache.h"
+#include <ArduinoJson.h>
+#include <TLogPlus.h>
+#include <new>
+
+bool GPSJsonCache::begin(const GPSSnapshot& snapshot) {
+    if (_body == nullptr) {
+        void* memory = psramFound() ? ps_malloc(sizeof(SeqLock<GPSJsonBody>)) : malloc(sizeof(SeqLock<GPSJsonBody>));
+        if (memory == nullptr) {
+            TLogPlus::Log.errorln("GPS JSON: Unable to allocate the response buffer.");
+            return false;
+        }
+        _body = new (memory) SeqLock<GPSJsonBody>();
+        _bootId = esp_random();
+    }
+    update(snapshot);
+    return true;
+}
+
+void GPSJsonCache::update(const GPSSnapshot& snapshot) {
+    if (_body == nullptr) {
+        return;
+    }
+    uint32_t start = micros();
+
+    char buffer[GPS_FORMAT_BUFFER_SIZE];
+    JsonDocument doc;
+    GPSManager::formatTime(snapshot.fix, buffer, sizeof(buffer));
+    doc["time"] = buffer;
+    GPSManager::formatDate(snapshot.fix, buffer, sizeof(buffer));
+    doc["date"] = buffer;
+    GPSManager::formatFixQuality(snapshot.fix, buffer, sizeof(buffer));
+    doc["fix"] = buffer;
+    GPSManager::formatLocation(snapshot.fix, buffer, sizeof(buffer));
+    doc["location"] = buffer;
+    GPSManager::formatSpeed(snapshot.fix, snapshot.speedAverage, buffer, sizeof(buffer));
+    doc["speed"] = buffer;
+    GPSManager::formatAngle(snapshot.fix, buffer, sizeof(buffer));
+    doc["angle"] = buffer;
+    GPSManager::formatAltitude(snapshot.fix, buffer, sizeof(buffer));
+    doc["altitude"] = buffer;
+    GPSManager::formatSatellites(snapshot.fix, buffer, sizeof(buffer));
+    doc["satellites"] = buffer;
+    GPSManager::formatAntenna(snapshot.fix, buffer, sizeof(buffer));
+    doc["antenna"] = buffer;
+
+    _building.length = serializeJson(doc, _building.json, sizeof(_building.json));
+    _building.version = _body->version() + 1;
+    _body->write(_building);
+
+    _builds++;
+    _buildTime += micros() - start;
+}
+
+GPSJsonBody GPSJsonCache::latest() const {
+    if (_body == nullptr) {
+        return {};
+    }
+    return _body->read();
+}
+
+void GPSJsonCache::serve(AsyncWebServerRequest* request) {
+    uint32_t now = millis();
+    uint32_t windowStart = _windowStart.load();
+    if (now - windowStart >= GPS_JSON_RATE_WINDOW_MS) {
+        uint32_t rate = _windowCount.load() * 1000 / (now - windowStart);
+        _requestRate = rate;
+        _peakRate = max(_peakRate.load(), rate);
+        _windowStart = now;
+        _windowCount = 0;
+    }
+    _windowCount++;
+    _served++;
+
+    if (_body == nullptr) {
+        request->send(503, "application/json", R"({"success":false, "message":"GPS data not ready"})");
+        return;
+    }
+
+    GPSJsonBody body = _body->read();
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%08x-%u\"", _bootId, body.version);
+
+    AsyncWebServerResponse* response;
+    if (request->hasHeader("If-None-Match") && etagMatches(request->header("If-None-Match").c_str(), etag)) {
+        _notModified++;
+        response = request->beginResponse(304);
+    } else {
+        response = request->beginResponse(200, "application/json", body.json);
+    }
+    response->addHeader("ETag", etag);
+    // Let the browser keep the body but check back every time
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+}
+
+bool GPSJsonCache::etagMatches(const char* header, const char* etag) {
+    size_t etagLength = strlen(etag);
+    const char* cursor = header;
+    while (*cursor != '\0') {
+        while (*cursor == ' ' || *cursor == '\t' || *cursor == ',') {
+            cursor++;
+        }
+        const char* start = cursor;
+        while (*cursor != '\0' && *cursor != ',') {
+            cursor++;
+        }
+        const char* end = cursor;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+            end--;
+        }
+        // A weak tag matches its strong form for a conditional GET
+        if (end - start > 2 && start[0] == 'W' && start[1] == '/') {
+            start += 2;
+        }
+        size_t length = end - start;
+        if ((length == 1 && *start == '*') || (length == etagLength && strncmp(start, etag, length) == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void GPSJsonCache::printToLog() const {
+    TLogPlus::Log.printf("GPS JSON: %u bodies built, %u us average\n", _builds, _builds ? _buildTime / _builds : 0);
+    TLogPlus::Log.printf("Requests: %u served, %u not modified, %u/s now, %u/s peak\n",
+                         _served.load(), _notModified.load(), _requestRate.load(), _peakRate.load());
+}
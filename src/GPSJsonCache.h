@@ -0,0 +1,50 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include "GPSManager.h"
+#include "SeqLock.h"
+
+#define GPS_JSON_MAX_SIZE 640        // nine formatted fields, see GPS_FORMAT_BUFFER_SIZE
+#define GPS_JSON_RATE_WINDOW_MS 1000
+
+/// @brief A serialized /api/gpsdata response and the version it was built for.
+struct GPSJsonBody {
+    uint32_t version;
+    uint16_t length;
+    char json[GPS_JSON_MAX_SIZE];
+};
+
+/// @brief Keeps the /api/gpsdata body serialized once per fix, so each request only
+/// copies it out instead of formatting and serializing the fix again. The version is
+/// sent as the ETag, and a request that already has it gets a 304 with no body.
+class GPSJsonCache {
+public:
+    /// @brief Allocates the body in PSRAM when there is some and builds the first one.
+    bool begin(const GPSSnapshot& snapshot);
+    /// @brief Rebuilds the body for a new fix. Call from one task only (the GPS listener).
+    void update(const GPSSnapshot& snapshot);
+    /// @brief A copy of the most recent body, safe from any task.
+    GPSJsonBody latest() const;
+    /// @brief Answers a request from the AsyncTCP task.
+    void serve(AsyncWebServerRequest* request);
+    void printToLog() const;
+
+    /// @brief Whether an If-None-Match header names etag: any of its comma separated
+    /// tags, compared without a W/ prefix, or *.
+    static bool etagMatches(const char* header, const char* etag);
+
+private:
+    SeqLock<GPSJsonBody>* _body = nullptr;
+    GPSJsonBody _building;          // only touched by update()
+    uint32_t _bootId = 0;           // keeps ETags from an earlier boot from matching
+    uint32_t _builds = 0;
+    uint32_t _buildTime = 0;        // us, total
+    // Counted by serve() on the AsyncTCP task, read by printToLog() on the main loop
+    std::atomic<uint32_t> _served{0};
+    std::atomic<uint32_t> _notModified{0};
+    std::atomic<uint32_t> _windowStart{0};
+    std::atomic<uint32_t> _windowCount{0};
+    std::atomic<uint32_t> _requestRate{0};  // requests in the last full second
+    std::atomic<uint32_t> _peakRate{0};
+};
@@ -2,23 +2,39 @@
 #include "Constants.h"
 #include <TLogPlus.h> 
 
+// Rates the receiver accepts in PMTK251, lowest first
+static const uint32_t SUPPORTED_BAUD_RATES[] = { 9600, 19200, 38400, 57600, 115200 };
+
+static bool isSupportedBaud(uint32_t baudRate) {
+    for (uint32_t rate : SUPPORTED_BAUD_RATES) {
+        if (rate == baudRate) return true;
+    }
+    return false;
+}
+
 GPSManager::GPSManager(HardwareSerial* serial, uint32_t rxPin, uint32_t txPin, uint32_t baudRate, bool echoToLog, uint32_t dataAge, GPSDataMode dataMode, GPSRate fixRate, GPSRate updateRate)
-    : _serial(serial), _gps(serial), _rxPin(rxPin), _txPin(txPin), _baudRate(baudRate), _echoToLog(echoToLog), _dataAgeThreshold(dataAge), _dataMode(dataMode), _fixRate(fixRate), _updateRate(updateRate) {
+    : _serial(serial), _gps(serial), _rxPin(rxPin), _txPin(txPin), _configuredBaud(baudRate), _baudRate(9600), _echoToLog(echoToLog), _dataAgeThreshold(dataAge), _dataMode(dataMode), _fixRate(fixRate), _updateRate(updateRate) {
       // check baud rate is valid
-      if (!(baudRate == 9600 || baudRate == 57600 || baudRate == 115200))
+      if (!(baudRate == GPS_BAUD_AUTO || isSupportedBaud(baudRate)))
       {
         TLogPlus::Log.printf("GPS: unsupported baud rate: %u", baudRate);
+        _configuredBaud = GPS_BAUD_AUTO;
       }
       _hasFix = false;
+      _assembler.setExpectedSentences(sentencesForDataMode(dataMode));
 }
 
 void GPSManager::begin() {
-    // start at 9600 baud as the default
+    // Leave room for a burst of sentences if loop() is held up
+    _serial->setRxBufferSize(GPS_RX_BUFFER_SIZE);
+    // The receiver powers up at 9600 baud, but keeps whatever rate it was last
+    // given across a warm reboot, so listen for it before sending anything
     _serial->begin(9600, SERIAL_8N1, _rxPin, _txPin, false);
-    _gps.begin(9600);
     _hasBegun = true;
-    changeBaud(_baudRate);
-    delay(100);
+    if (detectBaud() == 0) {
+        TLogPlus::Log.warningln("GPS: No NMEA data detected, assuming 9600 baud.");
+    }
+    fitBaudToData(true);
     setDataMode(_dataMode);
     setFixRate(_fixRate);
     setRefreshRate(_updateRate);
@@ -28,41 +44,457 @@ void GPSManager::begin() {
 }
 
 void GPSManager::loop() {
-    // Read from the serial connection and echo to the logs if enabled
-    if (_serialBatchRead)
+    uint32_t loopStart = micros();
+
+    if (_replay != nullptr)
+    {
+        // The receiver is ignored while a capture is replayed
+        _ingestRing.clear();
+        for (int i = 0; i < GPS_REPLAY_CHUNK && _replay->available() > 0; i++)
+        {
+            processChar(_replay->read());
+            _replayBytes++;
+        }
+        if (_replay->isFinished())
+        {
+            stopReplay();
+        }
+    }
+    else if (_ingestTaskHandle != nullptr)
     {
-        while(_gps.available() > 0)
+        // Consume the complete sentences queued by the ingest task
+        char sentence[NMEA_MAX_SENTENCE + 1];
+        size_t length;
+        while ((length = _ingestRing.pop(sentence, sizeof(sentence))) > 0)
         {
-            char c = _gps.read();
-            if (_echoToLog) 
+            for (size_t i = 0; i < length; i++)
             {
-                TLogPlus::Log.debug("%c", c);
+                processChar(sentence[i]);
             }
         }
-    } else {
-        char c = _gps.read();
-        if (_echoToLog)
+        if (_ingestBlocked.exchange(false))
+        {
+            xTaskNotifyGive(_ingestTaskHandle);
+        }
+    }
+    else if (_serialBatchRead)
+    {
+        // Read from the serial connection and echo to the logs if enabled
+        while(_serial->available() > 0)
         {
-            TLogPlus::Log.debug("%c", c);
+            processChar(_serial->read());
         }
+    } else if (_serial->available() > 0) {
+        processChar(_serial->read());
     }
 
-    // Check to see if anything new arrived
-    if (_gps.newNMEAreceived()) {
-      char* lastSentence = _gps.lastNMEA();
-      if (!_gps.parse(lastSentence)) {
-          // Ignore bad data
-          return;
-      }
+    // Don't sit on a partial epoch if the receiver stopped sending
+    if (_assembler.hasPendingSentences() && millis() - _lastDataReceivedTimer > GPS_EPOCH_TIMEOUT_MS)
+    {
+        _assembler.flush();
+        publishFix();
+    }
 
-      // Send via UDP to remote listener (if enabled)
-      if (_udpManager != nullptr) {
-            _udpManager->send(lastSentence);
-      }
+    _loopLatency.record(micros() - loopStart);
+}
+
+/// @brief Feeds a recorded capture through the parser in place of the receiver.
+void GPSManager::startReplay(NMEAReplayStream* replay) {
+    if (_replay != nullptr) {
+        stopReplay();
+    }
+    _replay = replay;
+    _replayBytes = 0;
+    _replayStartMillis = millis();
+    _replayStartSentences = _parser.getSentenceCount();
+    _replayStartSequence = _assembler.getSequence();
+    _loopLatency.reset();
+    TLogPlus::Log.printf("GPS: Replaying %s at %s\n", replay->getPath(),
+                         replay->getSpeed() == 0 ? "full speed" : (String(replay->getSpeed(), 1) + "x").c_str());
+}
+
+void GPSManager::stopReplay() {
+    if (_replay == nullptr) {
+        return;
+    }
+    _replayEndMillis = millis();
+    _replayEndSentences = _parser.getSentenceCount();
+    _replayEndSequence = _assembler.getSequence();
+    _replay->close();
+    _replay = nullptr;
+    TLogPlus::Log.infoln("GPS: Replay finished.");
+    printReplayStats();
+}
+
+void GPSManager::printReplayStats() {
+    uint32_t end = _replay != nullptr ? millis() : _replayEndMillis;
+    uint32_t sentences = (_replay != nullptr ? _parser.getSentenceCount() : _replayEndSentences) - _replayStartSentences;
+    uint32_t fixes = (_replay != nullptr ? _assembler.getSequence() : _replayEndSequence) - _replayStartSequence;
+    uint32_t elapsed = end - _replayStartMillis;
+    float seconds = elapsed > 0 ? elapsed / 1000.0f : 1.0f;
+
+    TLogPlus::Log.printf("Replay: %u bytes, %u sentences, %u fixes in %u ms\n", _replayBytes, sentences, fixes, elapsed);
+    TLogPlus::Log.printf("Replay: %.0f bytes/s, %.1f sentences/s, %.1f fixes/s\n",
+                         _replayBytes / seconds, sentences / seconds, fixes / seconds);
+    TLogPlus::Log.printf("GPS loop (us): min %u, p50 %u, p90 %u, p99 %u, max %u over %u passes\n",
+                         _loopLatency.getMin(), _loopLatency.getPercentile(50), _loopLatency.getPercentile(90),
+                         _loopLatency.getPercentile(99), _loopLatency.getMax(), _loopLatency.getCount());
+}
+
+void GPSManager::processChar(char c) {
+    if (_echoToLog)
+    {
+        TLogPlus::Log.debug("%c", c);
+    }
+
+    // The parser only reports sentences that pass the checksum, bad data is ignored
+    if (!_parser.encode(c)) {
+        return;
+    }
+
+    // Send via UDP to remote listener (if enabled)
+    if (_udpManager != nullptr) {
+        _udpManager->send(_parser.lastSentence());
+    }
+
+    // Keep track of the last time we got an update
+    _lastDataReceivedTimer = millis();
+    if (_assembler.add(_parser.sentence(), _parser.sentencePart(), _parser.sentenceParts())) {
+        publishFix();
+    }
+}
 
-      // <eep track of the last time we got an update
-      _lastDataReceivedTimer = millis();
-      updateLatestData();
+/// @brief Takes the record the epoch assembler just published and lets listeners know.
+void GPSManager::publishFix() {
+    _fix = _assembler.published();
+    updateLatestData();
+
+    // Everything for this epoch has been queued, send it as one datagram
+    if (_udpManager != nullptr) {
+        _udpManager->flush();
+    }
+
+    GPSSnapshot snapshot;
+    snapshot.fix = _fix;
+    snapshot.sequence = _assembler.getSequence();
+    snapshot.updatedAt = _lastDataReceivedTimer;
+    snapshot.speedAverage = getSpeedAverage();
+    _snapshot.write(snapshot);
+
+    for (GPSFixCallback listener : _fixListeners) {
+        if (listener != nullptr) {
+            listener(_fix);
+        }
+    }
+}
+
+bool GPSManager::addFixListener(GPSFixCallback callback) {
+    for (GPSFixCallback& listener : _fixListeners) {
+        if (listener == nullptr) {
+            listener = callback;
+            return true;
+        }
+    }
+    TLogPlus::Log.warningln("GPS: Too many fix listeners.");
+    return false;
+}
+
+/// @brief The sentences the receiver emits for every fix in each data mode.
+uint16_t GPSManager::sentencesForDataMode(GPSDataMode mode) {
+    switch (mode) {
+        case RMC_ONLY:
+            return GPS_SENTENCE_BIT(NMEA_RMC);
+        case GLL_ONLY:
+            return GPS_SENTENCE_BIT(NMEA_GLL);
+        case VTG_ONLY:
+            return GPS_SENTENCE_BIT(NMEA_VTG);
+        case GGA_ONLY:
+            return GPS_SENTENCE_BIT(NMEA_GGA);
+        case GSA_ONLY:
+            return GPS_SENTENCE_BIT(NMEA_GSA);
+        case GSV_ONLY:
+            return GPS_SENTENCE_BIT(NMEA_GSV);
+        case RMC_GGA:
+            return GPS_SENTENCE_BIT(NMEA_RMC) | GPS_SENTENCE_BIT(NMEA_GGA);
+        case RMC_GGA_GSA:
+            return GPS_SENTENCE_BIT(NMEA_RMC) | GPS_SENTENCE_BIT(NMEA_GGA) | GPS_SENTENCE_BIT(NMEA_GSA);
+        case ALL_DATA:
+            // GSV is only sent every fifth fix, so it can't be required
+            return GPS_SENTENCE_BIT(NMEA_GLL) | GPS_SENTENCE_BIT(NMEA_RMC) | GPS_SENTENCE_BIT(NMEA_VTG) |
+                   GPS_SENTENCE_BIT(NMEA_GGA) | GPS_SENTENCE_BIT(NMEA_GSA);
+        default:
+            return 0;
+    }
+}
+
+/// @brief Average bytes the receiver sends per fix in each data mode.
+uint32_t GPSManager::bytesPerFix(GPSDataMode mode) {
+    // Typical sentence lengths: RMC 72, GLL 52, VTG 42, GGA 76, GSA 68 and up to
+    // three GSV sentences of 70
+    switch (mode) {
+        case RMC_ONLY:
+            return 72;
+        case GLL_ONLY:
+            return 52;
+        case VTG_ONLY:
+            return 42;
+        case GGA_ONLY:
+            return 76;
+        case GSA_ONLY:
+            return 68;
+        case GSV_ONLY:
+            return 210;
+        case RMC_GGA:
+            return 148;
+        case RMC_GGA_GSA:
+            return 216;
+        case ALL_DATA:
+            // GSV only goes out every fifth fix
+            return 310 + 210 / 5;
+        default:
+            return 0;
+    }
+}
+
+/// @brief Lowest supported baud rate that carries the data mode at the update rate
+/// with GPS_BAUD_HEADROOM_PERCENT to spare.
+uint32_t GPSManager::requiredBaud(GPSDataMode mode, GPSRate updateRate) {
+    // Rates below 1 Hz are expressed in millihertz
+    uint32_t rate = (uint32_t)updateRate;
+    uint32_t milliHertz = rate < UPDATE_100_MILLIHERTZ ? rate * 1000UL : rate;
+    // 8N1 puts 10 bits on the wire for every byte
+    uint32_t bitsPerSecond = bytesPerFix(mode) * 10UL * milliHertz / 1000UL;
+    uint32_t needed = bitsPerSecond * GPS_BAUD_HEADROOM_PERCENT / 100;
+    for (uint32_t rate : SUPPORTED_BAUD_RATES) {
+        if (rate >= needed) {
+            return rate;
+        }
+    }
+    return SUPPORTED_BAUD_RATES[sizeof(SUPPORTED_BAUD_RATES) / sizeof(SUPPORTED_BAUD_RATES[0]) - 1];
+}
+
+/// @brief The configured rate, raised when it can't keep up with the data mode.
+uint32_t GPSManager::targetBaud() const {
+    uint32_t required = requiredBaud(_dataMode, _updateRate);
+    if (_configuredBaud == GPS_BAUD_AUTO || _configuredBaud < required) {
+        return required;
+    }
+    return _configuredBaud;
+}
+
+/// @brief Moves the link to the rate the current output needs. Called before the
+/// receiver's output grows (raising only) and again once it has changed.
+void GPSManager::fitBaudToData(bool allowLower) {
+    if (!_hasBegun) {
+        return;
+    }
+    uint32_t target = targetBaud();
+    if (target > _baudRate || (allowLower && target < _baudRate)) {
+        if (_configuredBaud != GPS_BAUD_AUTO && target != _configuredBaud) {
+            TLogPlus::Log.warningln("GPS: %u baud is too slow for the data mode and update rate, using %u.",
+                                    _configuredBaud, target);
+        }
+        changeBaud(target);
+    }
+}
+
+/// @brief Listens at each supported rate until a sentence with a valid checksum
+/// arrives and leaves the UART at that rate. A receiver at the wrong rate still shows
+/// up as garbled bytes, so if nothing at all arrives at the first rate there is no
+/// receiver to find and the other rates aren't tried. Never takes much longer than
+/// GPS_BAUD_DETECT_MAX_MS.
+/// @return the detected rate, or 0 if the receiver wasn't heard at any rate.
+uint32_t GPSManager::detectBaud() {
+    pauseIngest();
+
+    // The rate in use is the most likely, then the rest from the power-on default up
+    uint32_t rates[1 + sizeof(SUPPORTED_BAUD_RATES) / sizeof(SUPPORTED_BAUD_RATES[0])];
+    size_t count = 0;
+    rates[count++] = _baudRate;
+    for (uint32_t rate : SUPPORTED_BAUD_RATES) {
+        if (rate != _baudRate) {
+            rates[count++] = rate;
+        }
+    }
+
+    uint32_t detected = 0;
+    uint32_t start = millis();
+    for (size_t i = 0; i < count && detected == 0; i++) {
+        uint32_t elapsed = millis() - start;
+        if (elapsed >= GPS_BAUD_DETECT_MAX_MS) {
+            break;
+        }
+        uint32_t bytesHeard = 0;
+        if (probeBaud(rates[i], min((uint32_t)GPS_BAUD_PROBE_MS, GPS_BAUD_DETECT_MAX_MS - elapsed), bytesHeard)) {
+            detected = rates[i];
+        } else if (bytesHeard == 0) {
+            break;
+        }
+    }
+
+    if (detected != 0) {
+        TLogPlus::Log.infoln("GPS: Receiver detected at %u baud", detected);
+        _baudRate = detected;
+    } else {
+        _serial->updateBaudRate(_baudRate);
+    }
+    resumeIngest();
+    return detected;
+}
+
+/// @brief Listens at baudRate for up to listenMs for a sentence with a valid checksum.
+/// bytesHeard is set to how many bytes arrived, valid or not.
+bool GPSManager::probeBaud(uint32_t baudRate, uint32_t listenMs, uint32_t& bytesHeard) {
+    _serial->updateBaudRate(baudRate);
+    // Anything already buffered arrived at the previous rate
+    while (_serial->available() > 0) {
+        _serial->read();
+    }
+
+    // Ask for the firmware version so there is a reply even at slow update rates
+    _gps.sendCommand(PMTK_Q_RELEASE);
+
+    NMEAParser probe;
+    bytesHeard = 0;
+    uint32_t start = millis();
+    while (millis() - start < listenMs) {
+        while (_serial->available() > 0) {
+            probe.encode(_serial->read());
+            bytesHeard++;
+            if (probe.getValidCount() > 0) {
+                return true;
+            }
+        }
+        delay(5);
+    }
+    return false;
+}
+
+/// @brief Sends a command built at runtime, adding the leading '$' and the checksum.
+void GPSManager::sendChecksummed(const char* body) {
+    uint8_t checksum = 0;
+    for (const char* c = body; *c != '\0'; c++) {
+        checksum ^= *c;
+    }
+    char command[NMEA_MAX_SENTENCE];
+    snprintf(command, sizeof(command), "$%s*%02X", body, checksum);
+    sendCommand(command);
+}
+
+/// @brief Starts a task pinned to core that drains the UART as soon as the driver
+/// reports data and queues complete sentences for loop(), so a slow pass through the
+/// main loop no longer lets the UART FIFO overflow.
+bool GPSManager::startIngestTask(int core) {
+    if (_ingestTaskHandle != nullptr) {
+        return true;
+    }
+
+    _ingestPauseAck = xSemaphoreCreateBinaryStatic(&_ingestPauseAckState);
+    BaseType_t result = xTaskCreatePinnedToCore(ingestTask, "gps_ingest", GPS_INGEST_STACK_SIZE,
+                                                this, GPS_INGEST_PRIORITY, &_ingestTaskHandle, core);
+    if (result != pdPASS) {
+        TLogPlus::Log.errorln("GPS: Failed to start ingest task.");
+        _ingestTaskHandle = nullptr;
+        return false;
+    }
+
+    // Wake the task from the UART event queue (RX FIFO full or RX timeout)
+    _serial->onReceive([this]() {
+        if (_ingestTaskHandle != nullptr) {
+            uint32_t expected = 0;
+            _ingestWokenAt.compare_exchange_strong(expected, micros() | 1);
+            xTaskNotifyGive(_ingestTaskHandle);
+        }
+    });
+    TLogPlus::Log.infoln("GPS: Ingest task started on core %d", core);
+    return true;
+}
+
+void GPSManager::pauseIngest() {
+    if (_ingestTaskHandle == nullptr) {
+        return;
+    }
+    _ingestPauseRequested = true;
+    xTaskNotifyGive(_ingestTaskHandle);
+    xSemaphoreTake(_ingestPauseAck, portMAX_DELAY);
+}
+
+void GPSManager::resumeIngest() {
+    if (_ingestTaskHandle == nullptr) {
+        return;
+    }
+    _ingestPauseRequested = false;
+    xTaskNotifyGive(_ingestTaskHandle);
+    // Wait for the task to pick the UART back up, so a pause straight after is seen as new
+    xSemaphoreTake(_ingestPauseAck, portMAX_DELAY);
+}
+
+void GPSManager::ingestTask(void* param) {
+    GPSManager* manager = static_cast<GPSManager*>(param);
+    for (;;) {
+        // The timeout covers any notification that arrives before onReceive is attached
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(GPS_INGEST_IDLE_WAIT_MS));
+
+        uint32_t wokenAt = manager->_ingestWokenAt.exchange(0);
+        if (wokenAt != 0) {
+            manager->_ingestWakeLatency.record(micros() - wokenAt);
+        }
+
+        if (manager->_ingestPauseRequested) {
+            // Hand the UART over and stay off it until resumeIngest()
+            xSemaphoreGive(manager->_ingestPauseAck);
+            while (manager->_ingestPauseRequested) {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            }
+            // Whatever was half read belongs to the data from before the pause
+            manager->_ingestLength = 0;
+            manager->_ingestChunkStart = manager->_ingestChunkEnd = 0;
+            manager->_ingestBlocked = false;
+            xSemaphoreGive(manager->_ingestPauseAck);
+            continue;
+        }
+        manager->ingestAvailable();
+    }
+}
+
+/// @brief Frames what the UART has into sentences for loop(). When the ring is full the
+/// rest is left unread, in the chunk and the UART buffer, until loop() makes room: a
+/// burst is held back rather than dropped.
+void GPSManager::ingestAvailable() {
+    while (!_ingestPauseRequested) {
+        if (_ingestChunkStart == _ingestChunkEnd) {
+            int available = _serial->available();
+            if (available <= 0) {
+                return;
+            }
+            _ingestChunkStart = 0;
+            _ingestChunkEnd = _serial->read(_ingestChunk, min((size_t)available, sizeof(_ingestChunk)));
+        }
+        while (_ingestChunkStart < _ingestChunkEnd) {
+            char c = _ingestChunk[_ingestChunkStart];
+            if (c == '\n' && _ingestLength < sizeof(_ingestLine) && _ingestRing.full()) {
+                // Checked again after flagging, in case loop() emptied it in between. If that
+                // is still missed the task's idle wait picks it up.
+                _ingestBlocked = true;
+                if (_ingestRing.full()) {
+                    return;
+                }
+                _ingestBlocked = false;
+            }
+            _ingestChunkStart++;
+            if (c == '$') {
+                _ingestLength = 0;
+            }
+            if (_ingestLength >= sizeof(_ingestLine)) {
+                // Runaway line, wait for the next '$'
+                continue;
+            }
+            _ingestLine[_ingestLength++] = c;
+            if (c == '\n') {
+                _ingestRing.push(_ingestLine, _ingestLength);
+                _ingestLength = 0;
+            }
+        }
     }
 }
 
@@ -89,90 +521,142 @@ float GPSManager::getSpeedAverage() const {
 }
 
 void GPSManager::updateLatestData() {
-    _hasFix = (_gps.fix == 1);
-    // Format time
-    String timeStr = "";
-    if (_gps.hour < 10) timeStr += '0';
-    timeStr += String(_gps.hour) + ':';
-    if (_gps.minute < 10) timeStr += '0';
-    timeStr += String(_gps.minute) + ':';
-    if (_gps.seconds < 10) timeStr += '0';
-    timeStr += String(_gps.seconds);
-    _timeStr = timeStr;
-
-    // Format date
-    _dateStr = String(_gps.month) + "/" + String(_gps.day) + "/20" + String(_gps.year);
-
-    // Fix and quality
-    switch(_gps.fixquality)
+    _hasFix = _fix.active;
+    if (_hasFix) {
+      updateSpeedAverage(getSpeed());
+    }
+}
+
+// Clamps the snprintf result to what actually fit in the buffer
+static size_t fittedLength(int written, size_t size) {
+    if (written < 0 || size == 0) return 0;
+    return (size_t)written < size ? written : size - 1;
+}
+
+static size_t formatEmpty(char* buffer, size_t size) {
+    if (size > 0) buffer[0] = '\0';
+    return 0;
+}
+
+size_t GPSManager::formatTime(const GPSFix& fix, char* buffer, size_t size) {
+    return fittedLength(snprintf(buffer, size, "%02u:%02u:%02u", fix.hour(), fix.minute(), fix.second()), size);
+}
+
+size_t GPSManager::formatDate(const GPSFix& fix, char* buffer, size_t size) {
+    return fittedLength(snprintf(buffer, size, "%u/%u/%u", fix.month(), fix.day(), fix.year()), size);
+}
+
+size_t GPSManager::formatFixQuality(const GPSFix& fix, char* buffer, size_t size) {
+    const char* quality;
+    switch(fix.quality)
     {
       case 0:   // Invalid
-        _fixStr = "No fix";
+        quality = "No fix";
         break;
       case 1: // GPS Fix
-        _fixStr = "GPS fix";
+        quality = "GPS fix";
         break;
       case 2: // DGPS Fix
-        _fixStr = "Differential GPS fix";
+        quality = "Differential GPS fix";
         break;
       default:
-        _fixStr = "Unknown Value: " + String(_gps.fixquality);
-        break;
+        return fittedLength(snprintf(buffer, size, "Unknown Value: %u", fix.quality), size);
     }
-    switch(_gps.fixquality_3d)
+
+    const char* dimension = "";
+    switch(fix.fixType)
     {
       case 1: // No Fix
         break;      
       case 2: // 2D Fix
-        _fixStr += " (2D)";
+        dimension = " (2D)";
         break;
       case 3: // 3D Fix
-        _fixStr += " (3D)";
+        dimension = " (3D)";
         break;
     }
+    return fittedLength(snprintf(buffer, size, "%s%s", quality, dimension), size);
+}
 
-    // _fixStr = "Fix: " + String((int)_gps.fix) + " quality: " + String((int)_gps.fixquality);
+size_t GPSManager::formatLocation(const GPSFix& fix, char* buffer, size_t size) {
+    if (!fix.active) {
+      return fittedLength(snprintf(buffer, size, "No Fix"), size);
+    }
+    size_t length = formatDMS(toDMS(true, fix.latitude, true), buffer, size);
+    if (length + 1 < size) {
+      buffer[length++] = '\n';
+      length += formatDMS(toDMS(true, fix.longitude, false), buffer + length, size - length);
+    }
+    return length;
+}
 
-    // Location and other GPS data if fix is valid
-    _satellitesStr = "Satellites: " + String((int)_gps.satellites);
-    _antennaStr    = "Antenna: " + String((int)_gps.antenna);
+size_t GPSManager::formatSpeed(const GPSFix& fix, float average, char* buffer, size_t size) {
+    if (!fix.active) return formatEmpty(buffer, size);
+    return fittedLength(snprintf(buffer, size, "Speed (knots): %.2f (Avg: %.2f)", fix.speed / 100.0f, average), size);
+}
 
-    if (_hasFix) {
+size_t GPSManager::formatAngle(const GPSFix& fix, char* buffer, size_t size) {
+    if (!fix.active) return formatEmpty(buffer, size);
+    return fittedLength(snprintf(buffer, size, "Angle: %.2f", fix.course / 100.0f), size);
+}
+
+size_t GPSManager::formatAltitude(const GPSFix& fix, char* buffer, size_t size) {
+    if (!fix.active) return formatEmpty(buffer, size);
+    return fittedLength(snprintf(buffer, size, "Altitude: %.2f", fix.altitude / 100.0f), size);
+}
+
+size_t GPSManager::formatSatellites(const GPSFix& fix, char* buffer, size_t size) {
+    return fittedLength(snprintf(buffer, size, "Satellites: %u", fix.satellites), size);
+}
+
+size_t GPSManager::formatAntenna(const GPSFix& fix, char* buffer, size_t size) {
+    return fittedLength(snprintf(buffer, size, "Antenna: %u", fix.antenna), size);
+}
 
-      String locationStr = formatDMS(getDMS(_gps.fix, _gps.latitude, _gps.lat));
-      locationStr += "\n";
-      locationStr += formatDMS(getDMS(_gps.fix, _gps.longitude, _gps.lon));
-      _locationStr = locationStr;
-      
-      updateSpeedAverage(_gps.speed);
-      _speedStr      = "Speed (knots): " + String(_gps.speed) + " (Avg: " + String(getSpeedAverage()) + ")";
-
-      _angleStr      = "Angle: " + String(_gps.angle);
-      _altitudeStr   = "Altitude: " + String(_gps.altitude);
-      
+void GPSManager::toJson(const GPSSnapshot& snapshot, JsonObject root) {
+    const GPSFix& fix = snapshot.fix;
+    root["sequence"] = snapshot.sequence;
+    int64_t epoch = fix.epochMillis();
+    if (epoch >= 0) root["time"] = epoch; else root["time"] = nullptr;
+    root["age"] = snapshot.updatedAt ? millis() - snapshot.updatedAt : 0;
+    root["active"] = fix.active;
+
+    bool located = fix.active && fix.has(GPS_FIELD_LOCATION);
+    if (located) root["lat"] = fix.latitude / 1e6; else root["lat"] = nullptr;
+    if (located) root["lon"] = fix.longitude / 1e6; else root["lon"] = nullptr;
+    if (fix.active && fix.has(GPS_FIELD_SPEED)) {
+        root["speed"] = fix.speed / 100.0;
+        root["speedAvg"] = snapshot.speedAverage;
     } else {
-      _locationStr = "No Fix";
-      _speedStr = _angleStr = _altitudeStr = "";
+        root["speed"] = nullptr;
+        root["speedAvg"] = nullptr;
     }
+    if (fix.active && fix.has(GPS_FIELD_COURSE)) root["course"] = fix.course / 100.0; else root["course"] = nullptr;
+    if (fix.active && fix.has(GPS_FIELD_ALTITUDE)) root["altitude"] = fix.altitude / 100.0; else root["altitude"] = nullptr;
+    if (fix.has(GPS_FIELD_HDOP)) root["hdop"] = fix.hdop / 100.0; else root["hdop"] = nullptr;
+    root["satellites"] = fix.satellites;
+    root["satellitesInView"] = fix.satellitesInView;
+    root["quality"] = fix.quality;
+    root["fixType"] = fix.fixType;
 }
 
 DMS GPSManager::getLatitude() {
-  return getDMS(_gps.fix, _gps.latitude, _gps.lat);
+  return toDMS(_hasFix, _fix.latitude, true);
 }
 
 DMS GPSManager::getLongitude() {
-  return getDMS(_gps.fix, _gps.longitude, _gps.lon);
+  return toDMS(_hasFix, _fix.longitude, false);
 }
 
 int GPSManager::getDirectionFromTrueNorth() {
-  return int(_gps.angle);
+  return _fix.course / 100;
 }
 
 float GPSManager::getSpeed() {
-  return _gps.speed;
+  return _fix.speed / 100.0f;
 }
 
-DMS GPSManager::getDMS(bool fix, float raw, char dir) {
+DMS GPSManager::toDMS(bool fix, int32_t microdegrees, bool isLatitude) {
   DMS result;
   if (!fix) 
   {
@@ -180,20 +664,24 @@ DMS GPSManager::getDMS(bool fix, float raw, char dir) {
   }
   else
   {
-    result.direction = dir;
-    result.rawValue = raw;
-    result.degrees = int(raw) / 100;
-    float minutesFloat = raw - (result.degrees * 100);
-    result.minutes = int(minutesFloat);
-    result.seconds = (minutesFloat - result.minutes) * 60;
+    if (isLatitude) {
+      result.direction = microdegrees < 0 ? 'S' : 'N';
+    } else {
+      result.direction = microdegrees < 0 ? 'W' : 'E';
+    }
+    uint32_t value = microdegrees < 0 ? -microdegrees : microdegrees;
+    result.rawValue = microdegrees / 1000000.0f;
+    result.degrees = value / 1000000UL;
+    uint32_t minutesE6 = (value % 1000000UL) * 60;
+    result.minutes = minutesE6 / 1000000UL;
+    result.seconds = (minutesE6 % 1000000UL) * 60 / 1000000.0f;
     result.hasValue = true;
   }
   return result;
 }
 
-String GPSManager::formatDMS(DMS data) {
-  String dms = String(data.degrees) + "\xB0" + String(data.minutes) + "'" + String(data.seconds, 2) + "\" " + data.direction;
-  return dms;
+size_t GPSManager::formatDMS(DMS data, char* buffer, size_t size) {
+  return fittedLength(snprintf(buffer, size, "%d\xB0%d'%.2f\" %c", data.degrees, data.minutes, data.seconds, data.direction), size);
 }
 
 void GPSManager::sendCommand(const char* sentence)
@@ -208,27 +696,33 @@ void GPSManager::sendCommand(const char* sentence)
 
 void GPSManager::changeBaud(uint32_t baudRate)
 {
-  switch(baudRate) {
-    case 9600:
-      _gps.sendCommand(PMTK_SET_BAUD_9600);
-      break;
-    case 57600:
-      _gps.sendCommand(PMTK_SET_BAUD_57600);
-      break;
-    case 115200:
-      _gps.sendCommand(PMTK_SET_BAUD_115200);
-      break;
-    default:
-      TLogPlus::Log.warningln("GPS: Invalid baud rate. Will use the default rate of 9600.");
-      break;
+  if (baudRate == GPS_BAUD_AUTO) {
+    baudRate = requiredBaud(_dataMode, _updateRate);
+  }
+  if (!isSupportedBaud(baudRate)) {
+    TLogPlus::Log.warningln("GPS: Invalid baud rate %u, staying at %u.", baudRate, _baudRate);
+    return;
+  }
+  if (baudRate == _baudRate) {
+    return;
   }
 
-  delay(100);
-  _gps.begin(baudRate);
+  char command[16];
+  snprintf(command, sizeof(command), "PMTK251,%u", baudRate);
+  sendChecksummed(command);
+  // The command has to leave at the old rate before the UART switches
+  _serial->flush();
+  _serial->updateBaudRate(baudRate);
+  _baudRate = baudRate;
+  delay(GPS_BAUD_SETTLE_MS);
+  TLogPlus::Log.infoln("GPS: Baud rate changed to %u", baudRate);
 }
 
 void GPSManager::setRefreshRate(GPSRate rate)
 {
+  _updateRate = rate;
+  // Speed the link up before the receiver starts sending more
+  fitBaudToData(false);
   switch(rate) {
     case UPDATE_1_HERTZ:
       sendCommand(PMTK_SET_NMEA_UPDATE_1HZ);
@@ -252,6 +746,7 @@ void GPSManager::setRefreshRate(GPSRate rate)
       TLogPlus::Log.warning("Unsupported refresh rate.");
       break;
   }
+  fitBaudToData(true);
 }
 
 void GPSManager::setFixRate(GPSRate rate)
@@ -277,6 +772,9 @@ void GPSManager::setFixRate(GPSRate rate)
 
 void GPSManager::setDataMode(GPSDataMode mode)
 {
+  _dataMode = mode;
+  _assembler.setExpectedSentences(sentencesForDataMode(mode));
+  fitBaudToData(false);
   switch(mode)
   {
     case RMC_ONLY:
@@ -313,27 +811,51 @@ void GPSManager::setDataMode(GPSDataMode mode)
       TLogPlus::Log.warningln("Unsupported data mode requested.");
       break;
   }
+  fitBaudToData(true);
 }
 
 void GPSManager::setSerialBatchRead(bool readAllTogether) {
   _serialBatchRead = readAllTogether;
 }
 
-Adafruit_GPS& GPSManager::getGPS() { return _gps; }
-
 uint32_t GPSManager::getLastDataReceivedTime() const { return _lastDataReceivedTimer; }
 
 void GPSManager::printToLog() 
 {
-    TLogPlus::Log.infoln("GPS Baud: " + String(_baudRate));
+    TLogPlus::Log.printf("GPS Baud: %u (configured %s, %u needed)\n", _baudRate,
+                         _configuredBaud == GPS_BAUD_AUTO ? "auto" : String(_configuredBaud).c_str(),
+                         requiredBaud(_dataMode, _updateRate));
     TLogPlus::Log.infoln("GPS Data:");
-    TLogPlus::Log.infoln("Time: " + _timeStr);
-    TLogPlus::Log.infoln("Date: " + _dateStr);
-    TLogPlus::Log.infoln("Fix: " + _fixStr);
-    TLogPlus::Log.infoln("Location: " + _locationStr);
-    TLogPlus::Log.infoln("Speed: " + _speedStr);
-    TLogPlus::Log.infoln("Angle: " + _angleStr);
-    TLogPlus::Log.infoln("Altitude: " + _altitudeStr);
-    TLogPlus::Log.infoln("Satellites: " + _satellitesStr);
-    TLogPlus::Log.infoln("Antenna: " + _antennaStr);
+    char buffer[GPS_FORMAT_BUFFER_SIZE];
+    formatTime(_fix, buffer, sizeof(buffer));
+    TLogPlus::Log.printf("Time: %s\n", buffer);
+    formatDate(_fix, buffer, sizeof(buffer));
+    TLogPlus::Log.printf("Date: %s\n", buffer);
+    formatFixQuality(_fix, buffer, sizeof(buffer));
+    TLogPlus::Log.printf("Fix: %s\n", buffer);
+    formatLocation(_fix, buffer, sizeof(buffer));
+    TLogPlus::Log.printf("Location: %s\n", buffer);
+    // These helpers label their own values
+    formatSpeed(_fix, getSpeedAverage(), buffer, sizeof(buffer));
+    TLogPlus::Log.printf("%s\n", buffer);
+    formatAngle(_fix, buffer, sizeof(buffer));
+    TLogPlus::Log.printf("%s\n", buffer);
+    formatAltitude(_fix, buffer, sizeof(buffer));
+    TLogPlus::Log.printf("%s\n", buffer);
+    formatSatellites(_fix, buffer, sizeof(buffer));
+    TLogPlus::Log.printf("%s\n", buffer);
+    formatAntenna(_fix, buffer, sizeof(buffer));
+    TLogPlus::Log.printf("%s\n", buffer);
+    TLogPlus::Log.printf("Sentences: %u, checksum failures: %u, overflows: %u\n",
+                         _parser.getSentenceCount(), _parser.getChecksumFailures(), _parser.getOverflowCount());
+    TLogPlus::Log.printf("Epochs: %u published, %u incomplete\n",
+                         _assembler.getSequence(), _assembler.getIncompleteCount());
+    if (_ingestTaskHandle != nullptr) {
+        TLogPlus::Log.printf("Ingest queue: %u/%u (high water %u), dropped: %u\n",
+                             (unsigned)_ingestRing.size(), (unsigned)_ingestRing.capacity(),
+                             _ingestRing.getHighWaterMark(), _ingestRing.getDroppedCount());
+        TLogPlus::Log.printf("Ingest wake (us): p50 %u, p99 %u, max %u over %u wakeups\n",
+                             _ingestWakeLatency.getPercentile(50), _ingestWakeLatency.getPercentile(99),
+                             _ingestWakeLatency.getMax(), _ingestWakeLatency.getCount());
+    }
 }
\ No newline at end of file
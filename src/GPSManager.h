@@ -2,7 +2,32 @@
 #include <Adafruit_GPS.h>
 #include <HardwareSerial.h>
 #include <Arduino.h>
+#include <ArduinoJson.h>
+#include <atomic>
 #include "UDPManager.h"
+#include "GPSFix.h"
+#include "NMEAParser.h"
+#include "SentenceRing.h"
+#include "GPSEpochAssembler.h"
+#include "SeqLock.h"
+#include "LatencyHistogram.h"
+#include "NMEAReplayStream.h"
+
+#define GPS_RX_BUFFER_SIZE 1024
+#define GPS_INGEST_SLOTS 32
+#define GPS_INGEST_STACK_SIZE 3072
+#define GPS_INGEST_PRIORITY 5
+#define GPS_INGEST_IDLE_WAIT_MS 50
+#define GPS_INGEST_CHUNK 64
+#define GPS_EPOCH_TIMEOUT_MS 1500
+#define GPS_MAX_FIX_LISTENERS 4
+#define GPS_FORMAT_BUFFER_SIZE 48
+#define GPS_REPLAY_CHUNK 512    // most bytes of a replay consumed per loop()
+#define GPS_BAUD_AUTO 0             // pick the lowest rate that carries the data mode
+#define GPS_BAUD_PROBE_MS 1200      // listening time at each rate while detecting
+#define GPS_BAUD_DETECT_MAX_MS 4000 // most time detection may hold up the caller
+#define GPS_BAUD_SETTLE_MS 100      // time the receiver needs to switch rates
+#define GPS_BAUD_HEADROOM_PERCENT 150
 
 enum GPSRate
 {
@@ -28,6 +53,17 @@ enum GPSDataMode
     NO_DATA = -1
 };
 
+// Called after GPSManager publishes a new fix record
+typedef void (*GPSFixCallback)(const GPSFix& fix);
+
+/// @brief Consistent copy of the latest published fix, safe to take from any task.
+struct GPSSnapshot {
+    GPSFix fix;
+    uint32_t sequence;      // fix sequence number, see GPSManager::getFixSequence
+    uint32_t updatedAt;     // millis() when the fix was published
+    float speedAverage;     // knots
+};
+
 struct DMS {
     bool hasValue;
     float rawValue;
@@ -46,37 +82,83 @@ public:
     void updateSpeedAverage(float newSpeed);
     float getSpeedAverage() const;
     void updateLatestData();
-    Adafruit_GPS& getGPS();
+    const GPSFix& getFix() const { return _fix; }
+    uint32_t getFixSequence() const { return _assembler.getSequence(); }
+    bool addFixListener(GPSFixCallback callback);
+    GPSSnapshot getSnapshot() const { return _snapshot.read(); }
+    const NMEAParser& getParser() const { return _parser; }
     uint32_t getLastDataReceivedTime() const;
     void sendCommand(const char* sentence);
     void changeBaud(uint32_t newBaudRate);
+    uint32_t detectBaud();
+    uint32_t getBaudRate() const { return _baudRate; }
+    static uint32_t requiredBaud(GPSDataMode mode, GPSRate updateRate);
     void setRefreshRate(GPSRate rate);
     void setFixRate(GPSRate rate);
     void setDataMode(GPSDataMode mode);
     void setSerialBatchRead(bool readAllTogether = true);
+    bool startIngestTask(int core);
+    /// @brief Stops the ingest task reading the UART and waits until it has let go of it.
+    void pauseIngest();
+    void resumeIngest();
+    uint32_t getIngestDropped() const { return _ingestRing.getDroppedCount(); }
     void setUDPManager(UDPManager* udpManager);
     void printToLog();
 
-    String getTimeStr() const { return _timeStr; }
-    String getDateStr() const { return _dateStr; }
-    String getFixStr() const { return _fixStr; }
-    String getLocationStr() const { return _locationStr; }
-    String getSpeedStr() const { return _speedStr; }
-    String getAngleStr() const { return _angleStr; }
-    String getAltitudeStr() const { return _altitudeStr; }
-    String getSatellitesStr() const { return _satellitesStr; }
-    String getAntennaStr() const { return _antennaStr; }
+    void startReplay(NMEAReplayStream* replay);
+    void stopReplay();
+    bool isReplaying() const { return _replay != nullptr; }
+    void printReplayStats();
+    const LatencyHistogram& getLoopLatency() const { return _loopLatency; }
+
     bool hasFix() const { return _hasFix; }
     DMS getLatitude();
     DMS getLongitude();
     int getDirectionFromTrueNorth();
     float getSpeed();
 
+    // Formatting is only done on request, into a caller provided buffer
+    // (GPS_FORMAT_BUFFER_SIZE is always large enough). Each returns the length written.
+    static size_t formatTime(const GPSFix& fix, char* buffer, size_t size);
+    static size_t formatDate(const GPSFix& fix, char* buffer, size_t size);
+    static size_t formatFixQuality(const GPSFix& fix, char* buffer, size_t size);
+    static size_t formatLocation(const GPSFix& fix, char* buffer, size_t size);
+    static size_t formatSpeed(const GPSFix& fix, float average, char* buffer, size_t size);
+    static size_t formatAngle(const GPSFix& fix, char* buffer, size_t size);
+    static size_t formatAltitude(const GPSFix& fix, char* buffer, size_t size);
+    static size_t formatSatellites(const GPSFix& fix, char* buffer, size_t size);
+    static size_t formatAntenna(const GPSFix& fix, char* buffer, size_t size);
+    static size_t formatDMS(DMS data, char* buffer, size_t size);
+    static DMS toDMS(bool fix, int32_t microdegrees, bool isLatitude);
+    /// @brief Writes the snapshot as plain numbers (degrees, knots, meters) with null for
+    /// anything the receiver hasn't reported. time is UTC milliseconds since 1970 and age
+    /// is the milliseconds since the fix was published.
+    static void toJson(const GPSSnapshot& snapshot, JsonObject root);
+
 private:
     HardwareSerial* _serial;
     Adafruit_GPS _gps;
+    NMEAParser _parser;
+    GPSEpochAssembler _assembler;
+    GPSFix _fix = {};
+    GPSFixCallback _fixListeners[GPS_MAX_FIX_LISTENERS] = {nullptr};
+    // Replay of a recorded capture in place of the receiver
+    NMEAReplayStream* _replay = nullptr;
+    uint32_t _replayStartMillis = 0;
+    uint32_t _replayEndMillis = 0;
+    uint32_t _replayBytes = 0;
+    uint32_t _replayStartSentences = 0;
+    uint32_t _replayStartSequence = 0;
+    uint32_t _replayEndSentences = 0;
+    uint32_t _replayEndSequence = 0;
+    LatencyHistogram _loopLatency;
+
+    // Published copy of _fix for readers outside the main loop
+    SeqLock<GPSSnapshot> _snapshot;
     UDPManager* _udpManager = nullptr;
-    uint32_t _rxPin, _txPin, _baudRate;
+    uint32_t _rxPin, _txPin;
+    uint32_t _configuredBaud;   // from settings, GPS_BAUD_AUTO to choose
+    uint32_t _baudRate;         // rate the UART and receiver are using
     uint32_t _lastDataReceivedTimer = 0;
     float _speedBuffer[10] = {0};
     int _speedIndex = 0;
@@ -85,10 +167,37 @@ private:
     bool _hasBegun = false;
     bool _serialBatchRead = false;
 
-    DMS getDMS(bool fix, float raw, char dir);
-    String formatDMS(DMS data);
+    void processChar(char c);
+    void publishFix();
+    static uint16_t sentencesForDataMode(GPSDataMode mode);
+    static uint32_t bytesPerFix(GPSDataMode mode);
+    uint32_t targetBaud() const;
+    void fitBaudToData(bool allowLower);
+    bool probeBaud(uint32_t baudRate, uint32_t listenMs, uint32_t& bytesHeard);
+    void sendChecksummed(const char* body);
+    void ingestAvailable();
+    static void ingestTask(void* param);
+
+    // Sentences framed by the ingest task, consumed by loop()
+    SentenceRing<GPS_INGEST_SLOTS, NMEA_MAX_SENTENCE> _ingestRing;
+    TaskHandle_t _ingestTaskHandle = nullptr;
+    // Set by pauseIngest() while the UART is read directly. The task gives
+    // _ingestPauseAck once it is out of ingestAvailable(), and again on resuming
+    std::atomic<bool> _ingestPauseRequested{false};
+    SemaphoreHandle_t _ingestPauseAck = nullptr;
+    StaticSemaphore_t _ingestPauseAckState;
+    // micros() of the last UART wakeup the task hasn't handled yet, 0 when none
+    std::atomic<uint32_t> _ingestWokenAt{0};
+    LatencyHistogram _ingestWakeLatency;
+    char _ingestLine[NMEA_MAX_SENTENCE];
+    size_t _ingestLength = 0;
+    // Bytes read from the UART but not framed yet, kept while the ring is full
+    uint8_t _ingestChunk[GPS_INGEST_CHUNK];
+    size_t _ingestChunkStart = 0;
+    size_t _ingestChunkEnd = 0;
+    // Set by the task when it stops for a full ring, so loop() wakes it after popping
+    std::atomic<bool> _ingestBlocked{false};
 
-    String _timeStr, _dateStr, _fixStr, _locationStr, _speedStr, _angleStr, _altitudeStr, _satellitesStr, _antennaStr;
     bool _hasFix;
     bool _echoToLog;
     uint32_t _dataAgeThreshold;
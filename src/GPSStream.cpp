@@ -0,0 +1,133 @@
+#include "GPSStream.h"
+#include <ArduinoJson.h>
+#include <TLogPlus.h>
+
+GPSStream::GPSStream() : _socket(GPS_STREAM_PATH) {
+    _mutex = xSemaphoreCreateMutexStatic(&_mutexState);
+}
+
+void GPSStream::attach(AsyncWebServer& server) {
+    _socket.onEvent([this](AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type,
+                           void* arg, uint8_t* data, size_t length) {
+        onEvent(socket, client, type, arg, data, length);
+    });
+    server.addHandler(&_socket);
+}
+
+void GPSStream::publish(const GPSJsonBody& body) {
+    // Decide who is due while holding the lock, then send without it
+    uint32_t due[GPS_STREAM_MAX_CLIENTS];
+    uint8_t dueCount = 0;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < _clientCount; i++) {
+        Subscriber& subscriber = _subscribers[i];
+        if (++subscriber.skipped >= subscriber.every) {
+            subscriber.skipped = 0;
+            due[dueCount++] = subscriber.id;
+        }
+    }
+    xSemaphoreGive(_mutex);
+
+    // Clients are only named by id here: AsyncTCP frees a disconnected client on its own
+    // task, so the socket looks each one up under its lock rather than us holding a pointer
+    for (uint8_t i = 0; i < dueCount; i++) {
+        if (!_socket.availableForWrite(due[i])) {
+            // Still hasn't taken the earlier fixes, let it reconnect rather than queue more
+            TLogPlus::Log.warningln("GPS stream: Dropping slow client %u", due[i]);
+            _dropped++;
+            _socket.close(due[i]);
+            continue;
+        }
+        if (_socket.text(due[i], body.json, body.length)) {
+            _messagesSent++;
+            _bytesSent += body.length;
+        }
+    }
+}
+
+void GPSStream::loop() {
+    if (millis() - _cleanupTimer >= GPS_STREAM_CLEANUP_MS) {
+        _cleanupTimer = millis();
+        _socket.cleanupClients(GPS_STREAM_MAX_CLIENTS);
+    }
+}
+
+void GPSStream::onEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type,
+                        void* arg, uint8_t* data, size_t length) {
+    switch (type) {
+        case WS_EVT_CONNECT:
+            addSubscriber(client);
+            break;
+        case WS_EVT_DISCONNECT:
+            removeSubscriber(client->id());
+            break;
+        case WS_EVT_DATA: {
+            // Only short, single frame text messages are expected
+            AwsFrameInfo* info = (AwsFrameInfo*)arg;
+            if (!info->final || info->index != 0 || info->len != length || info->opcode != WS_TEXT) {
+                break;
+            }
+            JsonDocument doc;
+            if (deserializeJson(doc, data, length) == DeserializationError::Ok && doc["every"].is<int>()) {
+                int every = constrain(doc["every"].as<int>(), 1, GPS_STREAM_MAX_EVERY);
+                setEvery(client->id(), every);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void GPSStream::addSubscriber(AsyncWebSocketClient* client) {
+    bool added = false;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (_clientCount < GPS_STREAM_MAX_CLIENTS) {
+        _subscribers[_clientCount++] = { client->id(), 1, 0 };
+        added = true;
+    }
+    xSemaphoreGive(_mutex);
+
+    if (added) {
+        _connects++;
+        TLogPlus::Log.infoln("GPS stream: Client %u connected from %s", client->id(),
+                             client->remoteIP().toString().c_str());
+    } else {
+        _rejected++;
+        client->close();
+    }
+}
+
+void GPSStream::removeSubscriber(uint32_t id) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < _clientCount; i++) {
+        if (_subscribers[i].id == id) {
+            _subscribers[i] = _subscribers[--_clientCount];
+            break;
+        }
+    }
+    xSemaphoreGive(_mutex);
+}
+
+void GPSStream::setEvery(uint32_t id, uint8_t every) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < _clientCount; i++) {
+        if (_subscribers[i].id == id) {
+            _subscribers[i].every = every;
+            _subscribers[i].skipped = 0;
+            break;
+        }
+    }
+    xSemaphoreGive(_mutex);
+}
+
+void GPSStream::printToLog() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    TLogPlus::Log.printf("GPS stream: %u clients, %u connects, %u rejected, %u dropped as slow\n",
+                         _clientCount, _connects, _rejected, _dropped);
+    for (uint8_t i = 0; i < _clientCount; i++) {
+        TLogPlus::Log.printf("  client %u: every %u fixes\n", _subscribers[i].id, _subscribers[i].every);
+    }
+    xSemaphoreGive(_mutex);
+    TLogPlus::Log.printf("Sent: %u messages, %u bytes\n", _messagesSent, _bytesSent);
+}
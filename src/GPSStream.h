@@ -0,0 +1,54 @@
+#pragma once
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "GPSJsonCache.h"
+
+#define GPS_STREAM_PATH "/ws/gps"
+#define GPS_STREAM_MAX_CLIENTS 4
+#define GPS_STREAM_MAX_EVERY 100         // highest decimation a client can ask for
+#define GPS_STREAM_CLEANUP_MS 1000
+
+/// @brief Pushes each new fix to WebSocket subscribers as the same JSON served by
+/// /api/gpsdata. A client can send {"every": n} to only get every nth fix. A client
+/// whose send queue fills up is disconnected, so it can't hold up the others.
+class GPSStream {
+public:
+    GPSStream();
+
+    void attach(AsyncWebServer& server);
+    /// @brief Sends body to each client due for an update. Call from the GPS listener.
+    void publish(const GPSJsonBody& body);
+    /// @brief Releases disconnected clients, call from the main loop.
+    void loop();
+    bool hasClients() const { return _clientCount > 0; }
+    void printToLog();
+
+private:
+    struct Subscriber {
+        uint32_t id;
+        uint8_t every;      // send one fix in this many
+        uint8_t skipped;    // fixes since the last one sent
+    };
+
+    void onEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type,
+                 void* arg, uint8_t* data, size_t length);
+    void addSubscriber(AsyncWebSocketClient* client);
+    void removeSubscriber(uint32_t id);
+    void setEvery(uint32_t id, uint8_t every);
+
+    AsyncWebSocket _socket;
+    // The subscriber table is changed on the AsyncTCP task and read by publish()
+    SemaphoreHandle_t _mutex;
+    StaticSemaphore_t _mutexState;
+    Subscriber _subscribers[GPS_STREAM_MAX_CLIENTS];
+    volatile uint8_t _clientCount = 0;
+    uint32_t _cleanupTimer = 0;
+
+    uint32_t _connects = 0;
+    uint32_t _rejected = 0;
+    uint32_t _messagesSent = 0;
+    uint32_t _bytesSent = 0;
+    uint32_t _dropped = 0;
+};
@@ -0,0 +1,167 @@
+#include "GlyphCache.h"
+#include <TLogPlus.h>
+
+static void* allocate(size_t bytes) {
+    return psramFound() ? ps_malloc(bytes) : malloc(bytes);
+}
+
+CachedFont::~CachedFont() {
+    release();
+}
+
+/// @brief Walks each glyph's packed bitmap the way Arduino_GFX::drawChar does, once to
+/// count the runs and once to store them.
+bool CachedFont::build(const GFXfont* font) {
+    release();
+    _first = pgm_read_byte(&font->first);
+    _last = pgm_read_byte(&font->last);
+    _lineHeight = pgm_read_byte(&font->yAdvance);
+    const uint8_t* bitmap = (const uint8_t*)pgm_read_ptr(&font->bitmap);
+    const GFXglyph* glyphs = (const GFXglyph*)pgm_read_ptr(&font->glyph);
+    uint16_t glyphCount = _last - _first + 1;
+
+    _glyphs = (CachedGlyph*)allocate(glyphCount * sizeof(CachedGlyph));
+    if (_glyphs == nullptr) {
+        return false;
+    }
+
+    for (uint8_t pass = 0; pass < 2; pass++) {
+        uint32_t runCount = 0;
+        for (uint16_t i = 0; i < glyphCount; i++) {
+            const GFXglyph* source = &glyphs[i];
+            uint16_t offset = pgm_read_word(&source->bitmapOffset);
+            uint8_t width = pgm_read_byte(&source->width);
+            uint8_t height = pgm_read_byte(&source->height);
+            int8_t xOffset = pgm_read_byte(&source->xOffset);
+            int8_t yOffset = pgm_read_byte(&source->yOffset);
+
+            CachedGlyph& glyph = _glyphs[i];
+            glyph.firstRun = runCount;
+            glyph.xOffset = xOffset;
+            glyph.yOffset = yOffset;
+            glyph.width = width;
+            glyph.height = height;
+            glyph.advance = pgm_read_byte(&source->xAdvance);
+
+            // Rows are packed back to back, without padding to a byte boundary
+            uint8_t bits = 0, bit = 0;
+            for (uint8_t y = 0; y < height; y++) {
+                int16_t runStart = -1;
+                for (uint8_t x = 0; x <= width; x++) {
+                    bool set = false;
+                    if (x < width) {
+                        if (!(bit++ & 7)) {
+                            bits = pgm_read_byte(&bitmap[offset++]);
+                        }
+                        set = bits & 0x80;
+                        bits <<= 1;
+                    }
+                    if (set && runStart < 0) {
+                        runStart = x;
+                    } else if (!set && runStart >= 0) {
+                        if (pass == 1) {
+                            _runs[runCount] = { (int8_t)(xOffset + runStart), (int8_t)(yOffset + y),
+                                                (uint8_t)(x - runStart) };
+                        }
+                        runCount++;
+                        runStart = -1;
+                    }
+                }
+            }
+            glyph.runCount = runCount - glyph.firstRun;
+        }
+
+        if (pass == 0) {
+            _runCount = runCount;
+            _runs = (GlyphRun*)allocate(max(runCount, (uint32_t)1) * sizeof(GlyphRun));
+            if (_runs == nullptr) {
+                release();
+                return false;
+            }
+        }
+    }
+
+    _font = font;
+    return true;
+}
+
+void CachedFont::release() {
+    free(_glyphs);
+    free(_runs);
+    _glyphs = nullptr;
+    _runs = nullptr;
+    _runCount = 0;
+    _font = nullptr;
+}
+
+const CachedGlyph* CachedFont::glyph(uint8_t c) const {
+    if (c < _first || c > _last) {
+        return nullptr;
+    }
+    return &_glyphs[c - _first];
+}
+
+void CachedFont::measure(const char* text, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) const {
+    int16_t cursor = 0;
+    int16_t minX = INT16_MAX, minY = INT16_MAX, maxX = INT16_MIN, maxY = INT16_MIN;
+    for (const char* c = text; *c; c++) {
+        const CachedGlyph* g = glyph((uint8_t)*c);
+        if (g == nullptr) {
+            continue;
+        }
+        if (g->width > 0 && g->height > 0) {
+            minX = min(minX, (int16_t)(cursor + g->xOffset));
+            minY = min(minY, (int16_t)g->yOffset);
+            maxX = max(maxX, (int16_t)(cursor + g->xOffset + g->width - 1));
+            maxY = max(maxY, (int16_t)(g->yOffset + g->height - 1));
+        }
+        cursor += g->advance;
+    }
+
+    if (maxX < minX) {
+        *x1 = 0; *y1 = 0; *w = 0; *h = 0;
+        return;
+    }
+    *x1 = minX;
+    *y1 = minY;
+    *w = maxX - minX + 1;
+    *h = maxY - minY + 1;
+}
+
+size_t CachedFont::memoryUsed() const {
+    if (_font == nullptr) {
+        return 0;
+    }
+    return (_last - _first + 1) * sizeof(CachedGlyph) + _runCount * sizeof(GlyphRun);
+}
+
+const CachedFont* GlyphCache::get(const GFXfont* font) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_fonts[i].font() == font) {
+            _hits++;
+            return &_fonts[i];
+        }
+    }
+    _misses++;
+    if (_count == GLYPH_CACHE_FONTS || _outOfMemory) {
+        return nullptr;
+    }
+
+    uint32_t start = micros();
+    if (!_fonts[_count].build(font)) {
+        TLogPlus::Log.warningln("Glyphs: Unable to expand a font, drawing it bit by bit");
+        _outOfMemory = true;
+        return nullptr;
+    }
+    TLogPlus::Log.infoln("Glyphs: Expanded font %u in %u us, %u bytes", _count, micros() - start,
+                         _fonts[_count].memoryUsed());
+    return &_fonts[_count++];
+}
+
+void GlyphCache::printToLog() const {
+    size_t bytes = 0;
+    for (uint8_t i = 0; i < _count; i++) {
+        bytes += _fonts[i].memoryUsed();
+    }
+    TLogPlus::Log.printf("Glyph cache: %u fonts, %u bytes, %u hits, %u misses\n", _count, (unsigned)bytes, _hits, _misses);
+}
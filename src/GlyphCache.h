@@ -0,0 +1,68 @@
+#pragma once
+#include <Arduino_GFX_Library.h>
+
+#define GLYPH_CACHE_FONTS 6   // distinct GFXfonts kept expanded at once
+
+/// @brief Horizontal run of set pixels in a glyph, relative to the cursor position.
+struct GlyphRun {
+    int8_t x;
+    int8_t y;
+    uint8_t length;
+} __attribute__((packed));
+
+/// @brief A glyph's metrics and where its runs start in the font's run table.
+struct CachedGlyph {
+    uint16_t firstRun;
+    uint16_t runCount;
+    int8_t xOffset;
+    int8_t yOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t advance;
+};
+
+/// @brief Every glyph of a GFXfont expanded into runs of pixels, so text can be drawn
+/// without walking the packed bitmap a bit at a time.
+class CachedFont {
+public:
+    ~CachedFont();
+
+    bool build(const GFXfont* font);
+    void release();
+
+    const GFXfont* font() const { return _font; }
+    uint8_t lineHeight() const { return _lineHeight; }
+    /// @brief The glyph for c, or nullptr when the font doesn't have it.
+    const CachedGlyph* glyph(uint8_t c) const;
+    const GlyphRun* runs(const CachedGlyph& glyph) const { return _runs + glyph.firstRun; }
+    /// @brief Same result as Arduino_GFX::getTextBounds for one line of text drawn at 0, 0,
+    /// worked out from the cached metrics.
+    void measure(const char* text, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) const;
+    size_t memoryUsed() const;
+
+private:
+    const GFXfont* _font = nullptr;
+    uint8_t _first = 0;
+    uint8_t _last = 0;
+    uint8_t _lineHeight = 0;
+    CachedGlyph* _glyphs = nullptr;
+    GlyphRun* _runs = nullptr;
+    uint32_t _runCount = 0;
+};
+
+/// @brief The fonts drawn so far, each expanded the first time it is used.
+class GlyphCache {
+public:
+    /// @brief The expanded copy of font, building it if needed. Returns nullptr if
+    /// the cache is full or out of memory, in which case draw the font as usual.
+    const CachedFont* get(const GFXfont* font);
+
+    void printToLog() const;
+
+private:
+    CachedFont _fonts[GLYPH_CACHE_FONTS];
+    uint8_t _count = 0;
+    uint32_t _hits = 0;
+    uint32_t _misses = 0;
+    bool _outOfMemory = false;
+};
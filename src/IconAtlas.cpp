@@ -0,0 +1,75 @@
+#include "IconAtlas.h"
+#include <TLogPlus.h>
+
+IconAtlas::~IconAtlas() {
+    free(_data);
+}
+
+bool IconAtlas::load(fs::FS& fs, const char* path) {
+    File file = fs.open(path, "r");
+    if (!file) {
+        TLogPlus::Log.warningln("Icons: Unable to open %s", path);
+        return false;
+    }
+
+    size_t size = file.size();
+    uint8_t* data = (uint8_t*)(psramFound() ? ps_malloc(size) : malloc(size));
+    if (data == nullptr || file.read(data, size) != size) {
+        TLogPlus::Log.warningln("Icons: Unable to read %s", path);
+        free(data);
+        return false;
+    }
+
+    const IconAtlasHeader* header = (const IconAtlasHeader*)data;
+    if (size < sizeof(IconAtlasHeader) || memcmp(header->magic, ICON_ATLAS_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != ICON_ATLAS_VERSION ||
+        size < sizeof(IconAtlasHeader) + header->count * sizeof(IconAtlasEntry)) {
+        TLogPlus::Log.warningln("Icons: %s is not a supported icon atlas", path);
+        free(data);
+        return false;
+    }
+    if (header->count != ICON_COUNT) {
+        // IconIds.h and the uploaded file system are out of step
+        TLogPlus::Log.warningln("Icons: Atlas has %u icons, expected %u", header->count, ICON_COUNT);
+    }
+
+    for (uint8_t i = 0; i < ICON_COUNT; i++) {
+        _icons[i].release();
+    }
+    free(_data);
+    _data = data;
+    _count = min((int)header->count, (int)ICON_COUNT);
+
+    const IconAtlasEntry* entries = (const IconAtlasEntry*)(data + sizeof(IconAtlasHeader));
+    for (uint8_t i = 0; i < _count; i++) {
+        const IconAtlasEntry& entry = entries[i];
+        if (entry.offset + (size_t)entry.width * entry.height * sizeof(uint16_t) > size) {
+            continue;
+        }
+        Image565Header icon = {};
+        memcpy(icon.magic, IMAGE_MAGIC, sizeof(icon.magic));
+        icon.version = IMAGE_VERSION;
+        icon.format = IMAGE_FORMAT_RGB565;
+        icon.width = entry.width;
+        icon.height = entry.height;
+        icon.flags = entry.flags;
+        icon.transparentColor = entry.transparentColor;
+        _icons[i].attach(icon, (uint16_t*)(data + entry.offset));
+    }
+
+    TLogPlus::Log.infoln("Icons: Loaded %u icons (%u bytes)", _count, size);
+    return true;
+}
+
+void IconAtlas::prepare(uint8_t rotation) {
+    for (uint8_t i = 0; i < _count; i++) {
+        _icons[i].rotated(rotation);
+    }
+}
+
+Image565* IconAtlas::get(IconId id) {
+    if (id >= _count || !_icons[id].isLoaded()) {
+        return nullptr;
+    }
+    return &_icons[id];
+}
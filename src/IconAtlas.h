@@ -0,0 +1,44 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include "Image565.h"
+#include "IconIds.h"
+
+#define ICON_ATLAS_MAGIC "ICA5"
+#define ICON_ATLAS_VERSION 1
+
+/// @brief Layout of the atlas written by pack_icons.py: this header, one
+/// IconAtlasEntry per icon, then the RGB565 pixels of every icon.
+struct IconAtlasHeader {
+    char magic[4];      // ICON_ATLAS_MAGIC
+    uint8_t version;    // ICON_ATLAS_VERSION
+    uint8_t count;
+    uint16_t reserved;
+} __attribute__((packed));
+
+struct IconAtlasEntry {
+    uint16_t width;
+    uint16_t height;
+    uint16_t flags;             // IMAGE_FLAG_* bits
+    uint16_t transparentColor;
+    uint32_t offset;            // from the start of the file to the first pixel
+} __attribute__((packed));
+
+/// @brief All of the icons, read into PSRAM with one sequential read at boot and
+/// looked up by IconId.
+class IconAtlas {
+public:
+    ~IconAtlas();
+
+    bool load(fs::FS& fs, const char* path = ICON_ATLAS_PATH);
+    bool isLoaded() const { return _data != nullptr; }
+    /// @brief Builds every icon's rotated copy up front so drawing never allocates.
+    void prepare(uint8_t rotation);
+    /// @brief The icon, or nullptr if the atlas didn't load or doesn't contain it.
+    Image565* get(IconId id);
+
+private:
+    uint8_t* _data = nullptr;
+    Image565 _icons[ICON_COUNT];
+    uint8_t _count = 0;
+};
@@ -0,0 +1,24 @@
+// Generated by pack_icons.py from the icons directory, do not edit.
+#pragma once
+#include <stdint.h>
+
+#define ICON_ATLAS_PATH "/images/icons.atlas"
+
+enum IconId : uint8_t
+{
+    ICON_BATTERY_32_00 = 0,
+    ICON_BATTERY_32_100 = 1,
+    ICON_BATTERY_32_20 = 2,
+    ICON_BATTERY_32_40 = 3,
+    ICON_BATTERY_32_60 = 4,
+    ICON_BATTERY_32_CHARGE = 5,
+    ICON_BATTERY_32_NONE = 6,
+    ICON_GPS_32_CONNECTED = 7,
+    ICON_GPS_32_DISCONNECTED = 8,
+    ICON_WIFI_32_DISCONNECTED = 9,
+    ICON_WIFI_32_HIGH = 10,
+    ICON_WIFI_32_LOW = 11,
+    ICON_WIFI_32_MEDIUM = 12,
+
+    ICON_COUNT
+};
@@ -0,0 +1,180 @@
+#include "Image565.h"
+#include <TLogPlus.h>
+
+Image565::~Image565() {
+    release();
+}
+
+bool Image565::load(fs::FS& fs, const char* path) {
+    release();
+
+    File file = fs.open(path, "r");
+    if (!file) {
+        TLogPlus::Log.warningln("Image: Unable to open %s", path);
+        return false;
+    }
+
+    if (file.read((uint8_t*)&_header, sizeof(_header)) != sizeof(_header) ||
+        memcmp(_header.magic, IMAGE_MAGIC, sizeof(_header.magic)) != 0 ||
+        _header.version != IMAGE_VERSION || _header.format != IMAGE_FORMAT_RGB565) {
+        TLogPlus::Log.warningln("Image: %s is not a supported .565 image", path);
+        _header = {};
+        return false;
+    }
+
+    size_t bytes = (size_t)_header.width * _header.height * sizeof(uint16_t);
+    _pixels = allocate((size_t)_header.width * _header.height);
+    _ownsPixels = true;
+    if (_pixels == nullptr || file.read((uint8_t*)_pixels, bytes) != bytes) {
+        TLogPlus::Log.warningln("Image: Unable to read %s", path);
+        release();
+        return false;
+    }
+    return true;
+}
+
+void Image565::attach(const Image565Header& header, uint16_t* pixels) {
+    release();
+    _header = header;
+    _pixels = pixels;
+    _ownsPixels = false;
+}
+
+void Image565::release() {
+    if (_ownsPixels) {
+        free(_pixels);
+    }
+    free(_rotated);
+    _ownsPixels = false;
+    _pixels = nullptr;
+    _rotated = nullptr;
+    _rotation = 0;
+    _header = {};
+}
+
+const uint16_t* Image565::rotated(uint8_t rotation) {
+    rotation &= 3;
+    if (_pixels == nullptr || rotation == 0) {
+        return _pixels;
+    }
+    if (_rotated != nullptr && _rotation == rotation) {
+        return _rotated;
+    }
+
+    int16_t w = _header.width;
+    int16_t h = _header.height;
+    if (_rotated == nullptr) {
+        _rotated = allocate((size_t)w * h);
+        if (_rotated == nullptr) {
+            return nullptr;
+        }
+    }
+
+    // Matches the way Arduino_Canvas maps rotated coordinates onto its framebuffer
+    for (int16_t j = 0; j < h; j++) {
+        for (int16_t i = 0; i < w; i++) {
+            uint16_t pixel = _pixels[(int32_t)j * w + i];
+            switch (rotation) {
+                case 1:
+                    _rotated[(int32_t)i * h + (h - 1 - j)] = pixel;
+                    break;
+                case 2:
+                    _rotated[(int32_t)(h - 1 - j) * w + (w - 1 - i)] = pixel;
+                    break;
+                case 3:
+                    _rotated[(int32_t)(w - 1 - i) * h + j] = pixel;
+                    break;
+            }
+        }
+    }
+    _rotation = rotation;
+    return _rotated;
+}
+
+uint16_t* Image565::allocate(size_t pixelCount) {
+    size_t bytes = pixelCount * sizeof(uint16_t);
+    return (uint16_t*)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+}
+
+bool Image565Reader::open(fs::FS& fs, const char* path) {
+    close();
+    _file = fs.open(path, "r");
+    if (!_file) {
+        TLogPlus::Log.warningln("Image: Unable to open %s", path);
+        return false;
+    }
+
+    if (!readBytes((uint8_t*)&_header, sizeof(_header)) ||
+        memcmp(_header.magic, IMAGE_MAGIC, sizeof(_header.magic)) != 0 || _header.version != IMAGE_VERSION ||
+        (_header.format != IMAGE_FORMAT_RGB565 && _header.format != IMAGE_FORMAT_RLE565) ||
+        _header.width > IMAGE_MAX_WIDTH) {
+        TLogPlus::Log.warningln("Image: %s is not a supported .565 image", path);
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Image565Reader::close() {
+    if (_file) {
+        _file.close();
+    }
+    _header = {};
+    _bufferLength = 0;
+    _bufferPosition = 0;
+    _bytesRead = 0;
+}
+
+bool Image565Reader::readRow(uint16_t* row) {
+    int16_t width = _header.width;
+    if (_header.format == IMAGE_FORMAT_RGB565) {
+        return readBytes((uint8_t*)row, width * sizeof(uint16_t));
+    }
+
+    int16_t filled = 0;
+    while (filled < width) {
+        uint8_t control;
+        if (!readBytes(&control, 1)) {
+            return false;
+        }
+        int16_t count = (control & 0x7F) + 1;
+        if (count > width - filled) {
+            // Packets never cross rows, so the file is damaged
+            return false;
+        }
+        if (control & 0x80) {
+            uint16_t pixel;
+            if (!readBytes((uint8_t*)&pixel, sizeof(pixel))) {
+                return false;
+            }
+            for (int16_t i = 0; i < count; i++) {
+                row[filled++] = pixel;
+            }
+        } else {
+            if (!readBytes((uint8_t*)(row + filled), count * sizeof(uint16_t))) {
+                return false;
+            }
+            filled += count;
+        }
+    }
+    return true;
+}
+
+bool Image565Reader::readBytes(uint8_t* data, size_t count) {
+    while (count > 0) {
+        if (_bufferPosition == _bufferLength) {
+            _bufferLength = _file.read(_buffer, sizeof(_buffer));
+            _bufferPosition = 0;
+            _bytesRead += _bufferLength;
+            if (_bufferLength == 0) {
+                return false;
+            }
+        }
+        size_t chunk = min(count, _bufferLength - _bufferPosition);
+        memcpy(data, _buffer + _bufferPosition, chunk);
+        _bufferPosition += chunk;
+        data += chunk;
+        count -= chunk;
+    }
+    return true;
+}
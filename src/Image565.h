@@ -0,0 +1,85 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+
+#define IMAGE_MAGIC "I565"
+#define IMAGE_VERSION 1
+#define IMAGE_FORMAT_RGB565 0
+#define IMAGE_FORMAT_RLE565 1     // run length encoded rows, see Image565Reader
+#define IMAGE_FLAG_TRANSPARENT 0x01
+#define IMAGE_MAX_WIDTH 320
+#define IMAGE_READ_BUFFER 256
+
+/// @brief Header at the start of a .565 image written by convert_image.py. All values
+/// are little endian and the pixels that follow are RGB565, row by row.
+struct Image565Header {
+    char magic[4];            // IMAGE_MAGIC
+    uint8_t version;          // IMAGE_VERSION
+    uint8_t format;           // IMAGE_FORMAT_*
+    uint16_t width;
+    uint16_t height;
+    uint16_t flags;           // IMAGE_FLAG_* bits
+    uint16_t transparentColor; // pixels to skip when IMAGE_FLAG_TRANSPARENT is set
+    uint16_t reserved;
+} __attribute__((packed));
+
+/// @brief RGB565 image loaded into memory, ready to be copied straight into a canvas.
+/// A copy turned to match the display rotation is made the first time it is needed.
+class Image565 {
+public:
+    ~Image565();
+
+    bool load(fs::FS& fs, const char* path);
+    /// @brief Uses pixels held elsewhere (e.g. an icon atlas) without copying them.
+    void attach(const Image565Header& header, uint16_t* pixels);
+    void release();
+
+    bool isLoaded() const { return _pixels != nullptr; }
+    int16_t width() const { return _header.width; }
+    int16_t height() const { return _header.height; }
+    bool hasTransparency() const { return _header.flags & IMAGE_FLAG_TRANSPARENT; }
+    uint16_t transparentColor() const { return _header.transparentColor; }
+    uint16_t* pixels() const { return _pixels; }
+
+    /// @brief Pixels laid out as the panel stores them for the given canvas rotation,
+    /// so each row can be copied into the framebuffer as is.
+    const uint16_t* rotated(uint8_t rotation);
+
+private:
+    static uint16_t* allocate(size_t pixelCount);
+
+    Image565Header _header = {};
+    uint16_t* _pixels = nullptr;
+    bool _ownsPixels = false;
+    uint16_t* _rotated = nullptr;
+    uint8_t _rotation = 0;
+};
+
+/// @brief Reads a .565 image from a file a row at a time, so large images can be
+/// drawn without holding all of their pixels. Handles both raw and run length
+/// encoded images. In an RLE565 row a control byte with the top bit set repeats the
+/// next pixel (control & 0x7F) + 1 times, otherwise (control + 1) pixels follow as is.
+class Image565Reader {
+public:
+    bool open(fs::FS& fs, const char* path);
+    void close();
+
+    int16_t width() const { return _header.width; }
+    int16_t height() const { return _header.height; }
+    bool hasTransparency() const { return _header.flags & IMAGE_FLAG_TRANSPARENT; }
+    uint16_t transparentColor() const { return _header.transparentColor; }
+    uint32_t getBytesRead() const { return _bytesRead; }
+
+    /// @brief Decodes the next row into row, which must hold width() pixels.
+    bool readRow(uint16_t* row);
+
+private:
+    bool readBytes(uint8_t* data, size_t count);
+
+    File _file;
+    Image565Header _header = {};
+    uint8_t _buffer[IMAGE_READ_BUFFER];
+    size_t _bufferLength = 0;
+    size_t _bufferPosition = 0;
+    uint32_t _bytesRead = 0;
+};
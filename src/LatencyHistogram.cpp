@@ -0,0 +1,41 @@
+#include "LatencyHistogram.h"
+#include <string.h>
+
+void LatencyHistogram::reset() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _min = UINT32_MAX;
+    _max = 0;
+    _total = 0;
+}
+
+void LatencyHistogram::record(uint32_t micros) {
+    uint8_t bucket = micros < 2 ? 0 : 31 - __builtin_clz(micros);
+    _buckets[bucket]++;
+    _count++;
+    _total += micros;
+    if (micros < _min) _min = micros;
+    if (micros > _max) _max = micros;
+}
+
+uint32_t LatencyHistogram::getPercentile(uint8_t percent) const {
+    if (_count == 0) {
+        return 0;
+    }
+
+    uint32_t rank = ((uint64_t)_count * percent + 99) / 100;
+    if (rank == 0) {
+        return getMin();
+    }
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = i >= 31 ? UINT32_MAX : (2UL << i) - 1;
+            if (upper > _max) upper = _max;
+            if (upper < getMin()) upper = getMin();
+            return upper;
+        }
+    }
+    return _max;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+
+#define LATENCY_HISTOGRAM_BUCKETS 32
+
+/// @brief Fixed size histogram of durations in microseconds. Bucket n counts samples in
+/// [2^n, 2^(n+1)), so recording is a couple of instructions and percentiles are
+/// accurate to within a factor of two (exact for the minimum and maximum).
+class LatencyHistogram {
+public:
+    LatencyHistogram() { reset(); }
+
+    void record(uint32_t micros);
+    void reset();
+
+    uint32_t getCount() const { return _count; }
+    uint32_t getMin() const { return _count ? _min : 0; }
+    uint32_t getMax() const { return _max; }
+    uint32_t getAverage() const { return _count ? (uint32_t)(_total / _count) : 0; }
+    /// @brief Upper bound of the bucket holding the given percentile (0-100).
+    uint32_t getPercentile(uint8_t percent) const;
+
+private:
+    uint32_t _buckets[LATENCY_HISTOGRAM_BUCKETS];
+    uint32_t _count;
+    uint32_t _min;
+    uint32_t _max;
+    uint64_t _total;
+};
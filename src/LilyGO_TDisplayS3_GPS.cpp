@@ -23,6 +23,10 @@
 #include "ScreenManager.h"
 #include "UDPManager.h"
 #include "ButtonManager.h"
+#include "LoopProfiler.h"
+#include "GPSJsonCache.h"
+#include "GPSStream.h"
+#include "WebAssets.h"
 
 HardwareSerial GPSSerial(1);
 GPSManager *gpsManager = nullptr;
@@ -31,6 +35,11 @@ AppSettings *settings = nullptr;
 UDPManager *udpManager = nullptr;
 ButtonManager *btnRight = nullptr;
 ButtonManager *btnLeft = nullptr;
+NMEAReplayStream replayStream;
+LoopProfiler loopProfiler;
+GPSJsonCache gpsJson;
+GPSStream gpsStream;
+WebAssetHandler webAssets;
 
 AsyncWebServer server(80);
 
@@ -54,6 +63,11 @@ bool networkServicesInitalized = false;
 bool isTelnetSetup = false;
 uint8_t loopCounter = 0;
 String lastWiFiScanResult;
+// Web server callbacks run on the AsyncTCP task, so they only ask for these and loop()
+// writes the settings to flash and restarts
+std::atomic<bool> settingsFlushRequested(false);
+std::atomic<bool> restartRequested(false);
+std::atomic<uint32_t> restartRequestTime(0);
 
 bool connectToWiFi(bool firstAttempt = false);
 void completeConfigurationPortal();
@@ -72,6 +86,8 @@ void setupWebServer();
 void configureNetworkDependents(bool connected);
 void onButtonRightPress(ButtonPressType type);
 void onButtonLeftPress(ButtonPressType type);
+void onGPSFix(const GPSFix& fix);
+void serviceRestartRequests();
 
 void setup()
 {
@@ -132,6 +148,7 @@ void setup()
                               (GPSRate)settings->getInt(SETTING_GPS_FIX_RATE),
                               (GPSRate)settings->getInt(SETTING_GPS_UPDATE_RATE));
   gpsManager->begin();
+  gpsManager->startIngestTask(GPS_INGEST_CORE);
 
   TLogPlus::Log.debugln("Setting up UDP manager");
   if (settings->getBool(SETTING_UDP_ENABLED))
@@ -141,10 +158,18 @@ void setup()
     TLogPlus::Log.printf("Enabling UDP GPS sentence delivery to %s:%u", host, port);
 
     udpManager = new UDPManager(host.c_str(), port);
+    udpManager->setBatching(settings->getBool(SETTING_UDP_BATCH, UDP_BATCH_DEFAULT),
+                            settings->getInt(SETTING_UDP_BATCH_BYTES, UDP_BATCH_BYTES_DEFAULT),
+                            settings->getInt(SETTING_UDP_BATCH_DELAY, UDP_BATCH_DELAY_DEFAULT));
+    udpManager->setOverflowPolicy((UDPOverflowPolicy)settings->getInt(SETTING_UDP_OVERFLOW, UDP_OVERFLOW_DEFAULT));
+    udpManager->startNetworkTask(UDP_TASK_CORE);
     gpsManager->setUDPManager(udpManager);
   }
 
   screenManager->setGPSManager(gpsManager);
+  gpsJson.begin(gpsManager->getSnapshot());
+  gpsManager->addFixListener(onGPSFix);
+  screenManager->setLoopProfiler(&loopProfiler);
 
   // Setup button managers
   btnRight = new ButtonManager(BTN_RIGHT_PIN, onButtonRightPress);
@@ -167,17 +192,30 @@ void setup()
 
 void loop()
 {
+  loopProfiler.begin();
+
+  // Ahead of ElegantOTA, whose restart after an update must come after the flush
+  serviceRestartRequests();
   ElegantOTA.loop();
+  loopProfiler.mark(LOOP_STAGE_OTA);
 
   processSerialInput();
+  loopProfiler.mark(LOOP_STAGE_SERIAL);
 
   gpsManager->loop();
+  loopProfiler.mark(LOOP_STAGE_GPS);
   screenManager->loop();
+  loopProfiler.mark(LOOP_STAGE_SCREEN);
   btnRight->loop();
   btnLeft->loop();
+  loopProfiler.mark(LOOP_STAGE_BUTTONS);
   TLogPlus::Log.loop();
+  loopProfiler.mark(LOOP_STAGE_LOG);
   
   if (isTelnetSetup) telnetSerialStream.loop();
+  loopProfiler.mark(LOOP_STAGE_TELNET);
+  gpsStream.loop();
+  loopProfiler.mark(LOOP_STAGE_WEB);
 
   // Check for WiFi connection and automatically launch portal if needed
   if (isWiFiConfigured && !launchedConfigPortal) {
@@ -246,6 +284,40 @@ void loop()
       runtimeDurationMillis = 0;
     }
   }
+
+  // Changed settings are written to flash once they stop changing
+  settings->loop();
+
+  loopProfiler.mark(LOOP_STAGE_HOUSEKEEPING);
+  loopProfiler.end();
+}
+
+// Flushes settings and restarts for the web server callbacks, from the main loop so the
+// flash writes don't run on, or hold up, the AsyncTCP task
+void serviceRestartRequests() {
+  if (settingsFlushRequested.exchange(false)) {
+    settings->flush();
+  }
+  if (restartRequested && millis() - restartRequestTime >= RESTART_DELAY_MS) {
+    TLogPlus::Log.infoln("Restarting device...");
+    settings->flush();
+    ESP.restart();
+  }
+}
+
+// Redraw the screen for each new fix rather than on a timer
+void onGPSFix(const GPSFix& fix) {
+  static bool wasActive = false;
+  uint8_t events = SCREEN_EVENT_GPS;
+  if (fix.active != wasActive) {
+    wasActive = fix.active;
+    events |= SCREEN_EVENT_GPS_STATUS;
+  }
+  screenManager->invalidate(events);
+  gpsJson.update(gpsManager->getSnapshot());
+  if (gpsStream.hasClients()) {
+    gpsStream.publish(gpsJson.latest());
+  }
 }
 
 // Button callback functions
@@ -255,6 +327,7 @@ void onButtonRightPress(ButtonPressType type) {
     TLogPlus::Log.debugln("screenManager was null - no button action will occur.");
     return;
   }
+  screenManager->invalidate(SCREEN_EVENT_INPUT);
 
   if (type == SHORT_PRESS) {
     screenManager->moveNextScreen(1);
@@ -284,6 +357,7 @@ void onButtonLeftPress(ButtonPressType type) {
     TLogPlus::Log.debugln("screenManager was null - no button action will occur.");
     return;
   }
+  screenManager->invalidate(SCREEN_EVENT_INPUT);
   if (type == SHORT_PRESS)
     screenManager->moveNextScreen(-1);
 }
@@ -428,8 +502,15 @@ void processDebugCommand(String debugCmd)
   }
   else if (cmd == "gpsbaud")
   {
+    // gpsbaud:0 picks the lowest rate that fits the data mode
     gpsManager->changeBaud(value.toInt());
   }
+  else if (cmd == "gpsdetect")
+  {
+    if (gpsManager->detectBaud() == 0) {
+      TLogPlus::Log.warningln("GPS: Receiver not detected at any baud rate.");
+    }
+  }
   else if (cmd == "gpsdata")
   {
     gpsManager->setDataMode((GPSDataMode)value.toInt());
@@ -475,6 +556,7 @@ void processDebugCommand(String debugCmd)
   else if (cmd == "restart")
   {
     TLogPlus::Log.infoln("Restarting device...");
+    settings->flush();
     ESP.restart();
   }
   else if (cmd == "printgps")
@@ -482,11 +564,84 @@ void processDebugCommand(String debugCmd)
     TLogPlus::Log.infoln("Printing GPS data to console.");
     gpsManager->printToLog();
   }
+  else if (cmd == "printapi")
+  {
+    gpsJson.printToLog();
+    gpsStream.printToLog();
+    webAssets.printToLog();
+  }
+  else if (cmd == "replay")
+  {
+    // replay:<path>[,<speed>] where speed 1 is real time and 0 is as fast as possible
+    int comma = value.indexOf(',');
+    String path = comma == -1 ? value : value.substring(0, comma);
+    float speed = comma == -1 ? 1.0f : value.substring(comma + 1).toFloat();
+    if (replayStream.open(LittleFS, path.c_str(), speed)) {
+      gpsManager->startReplay(&replayStream);
+    } else {
+      TLogPlus::Log.warningln("Unable to open NMEA capture: " + path);
+    }
+  }
+  else if (cmd == "replaystop")
+  {
+    gpsManager->stopReplay();
+  }
+  else if (cmd == "replaystats")
+  {
+    gpsManager->printReplayStats();
+  }
   else if (cmd == "printsettings")
   {
     TLogPlus::Log.infoln("Printing app settings to console.");
     settings->printToLog();
   }
+  else if (cmd == "settingsflush")
+  {
+    settings->flush();
+    settings->printStats();
+  }
+  else if (cmd == "printscreen")
+  {
+    screenManager->printToLog();
+  }
+  else if (cmd == "screenshot")
+  {
+    // screenshot[:<mode>|all] renders screens off the panel into /screenshots as PPM images
+    LittleFS.mkdir("/screenshots");
+    int first = screenManager->getScreenMode(), last = first;
+    if (value == "all") {
+      first = SCREEN_BOOT;
+      last = SCREEN_MAX - 1;
+    } else if (value.length() > 0) {
+      first = last = value.toInt();
+    }
+    for (int mode = first; mode <= last && mode < SCREEN_MAX; mode++) {
+      String path = String("/screenshots/") + ScreenManager::screenName((ScreenMode)mode) + ".ppm";
+      screenManager->saveScreenshot((ScreenMode)mode, LittleFS, path.c_str());
+    }
+  }
+  else if (cmd == "screenstatsreset")
+  {
+    screenManager->resetScreenStats();
+  }
+  else if (cmd == "screenbench")
+  {
+    int iterations = value.length() > 0 ? value.toInt() : 20;
+    screenManager->benchmarkScreens(iterations > 0 ? iterations : 20);
+  }
+  else if (cmd == "looptimes")
+  {
+    loopProfiler.printToLog();
+  }
+  else if (cmd == "looptimesreset")
+  {
+    loopProfiler.reset();
+  }
+  else if (cmd == "printudp")
+  {
+    if (udpManager != nullptr) udpManager->printToLog();
+    else TLogPlus::Log.infoln("UDP is not enabled.");
+  }
   else if (cmd == "printwifi")
   {
     TLogPlus::Log.infoln("Printing WiFi information");
@@ -581,12 +736,14 @@ void WiFi_Connected(WiFiEvent_t wifi_event, WiFiEventInfo_t wifi_info)
 {
   TLogPlus::Log.debugln("Connected to WiFi");
   wifiFailureStartTime = 0;  // Reset failure timer when connected
+  if (screenManager != nullptr) screenManager->invalidate(SCREEN_EVENT_WIFI);
 }
 
 void WiFi_GotIPAddress(WiFiEvent_t wifi_event, WiFiEventInfo_t wifi_info)
 {
   TLogPlus::Log.printf("Got IP: %s\n", WiFi.localIP().toString());
   configureNetworkDependents(true);
+  if (screenManager != nullptr) screenManager->invalidate(SCREEN_EVENT_WIFI);
 }
 
 void configureNetworkDependents(bool connected)
@@ -680,17 +837,45 @@ void setupWebServer()
     }
   );
 
-  server.on("/api/gpsdata", HTTP_GET, [](AsyncWebServerRequest *request) {    
+  server.on("/api/gpsdata", HTTP_GET, [](AsyncWebServerRequest *request) {
+    // Serialized once per fix by onGPSFix, so this only copies the latest body
+    gpsJson.serve(request);
+  });
+
+  server.on("/api/v1/gps", HTTP_GET, [](AsyncWebServerRequest *request) {
+    // Numbers for other programs rather than text for people, as JSON or MessagePack
+    JsonDocument doc;
+    GPSManager::toJson(gpsManager->getSnapshot(), doc.to<JsonObject>());
+    String accept = request->hasHeader("Accept") ? request->header("Accept") : String();
+    AsyncResponseStream *response;
+    if (accept.indexOf("msgpack") >= 0) {
+      response = request->beginResponseStream("application/msgpack");
+      serializeMsgPack(doc, *response);
+    } else {
+      response = request->beginResponseStream("application/json");
+      serializeJson(doc, *response);
+    }
+    response->addHeader("Cache-Control", "no-store");
+    response->addHeader("Vary", "Accept");
+    request->send(response);
+  });
+
+  // Pushes each fix to subscribers, see data/web/gps.html
+  gpsStream.attach(server);
+
+  server.on("/api/looptimes", HTTP_GET, [](AsyncWebServerRequest *request) {
+    // Statistics only, so an occasional torn read against the main loop is acceptable
     JsonDocument doc;
-    doc["time"] = gpsManager->getTimeStr();
-    doc["date"] = gpsManager->getDateStr();
-    doc["fix"] = gpsManager->getFixStr();
-    doc["location"] = gpsManager->getLocationStr();
-    doc["speed"] = gpsManager->getSpeedStr();
-    doc["angle"] = gpsManager->getAngleStr();
-    doc["altitude"] = gpsManager->getAltitudeStr();
-    doc["satellites"] = gpsManager->getSatellitesStr();
-    doc["antenna"] = gpsManager->getAntennaStr();
+    loopProfiler.toJson(doc.to<JsonObject>());
+    String jsonResponse;
+    serializeJson(doc, jsonResponse);
+    request->send(200, "application/json", jsonResponse);
+  });
+
+  server.on("/api/screenstats", HTTP_GET, [](AsyncWebServerRequest *request) {
+    // Statistics only, so an occasional torn read against the main loop is acceptable
+    JsonDocument doc;
+    screenManager->screenStatsToJson(doc.to<JsonObject>());
     String jsonResponse;
     serializeJson(doc, jsonResponse);
     request->send(200, "application/json", jsonResponse);
@@ -703,8 +888,8 @@ void setupWebServer()
   server.on("/api/reboot", HTTP_GET, [](AsyncWebServerRequest *request) {
     // Placeholder for reboot confirmation page
     request->send(200, "text/plain", "Rebooting... Please wait.");
-    delay(5000);
-    ESP.restart();
+    restartRequestTime = millis();
+    restartRequested = true;
   });
 
   server.on("/upload", HTTP_POST, [](AsyncWebServerRequest *request) {
@@ -743,6 +928,10 @@ void setupWebServer()
       }
     }
   });  
+  server.serveStatic("/screenshots/", LittleFS, "/screenshots/");
+  // Gzipped pages from compress_web.py, with the originals in /web as the fallback
+  webAssets.begin(LittleFS);
+  server.addHandler(&webAssets);
   server.serveStatic("/", LittleFS, "/web/").setDefaultFile("index.html");
 
   ElegantOTA.begin(&server);
@@ -761,6 +950,7 @@ void WiFi_Disconnected(WiFiEvent_t wifi_event, WiFiEventInfo_t wifi_info)
     wifi_info.wifi_sta_disconnected.reason);
 
   configureNetworkDependents(false);
+  if (screenManager != nullptr) screenManager->invalidate(SCREEN_EVENT_WIFI);
 }
 
 void processSerialInput()
@@ -797,6 +987,8 @@ void onOTAProgress(size_t current, size_t final)
 
 void onOTAEnd(bool success) 
 {
+  // ElegantOTA restarts the device next, so don't leave settings waiting in RAM
+  settingsFlushRequested = true;
   if (success) {
     TLogPlus::Log.println("OTA update finished succesfully!");
     screenManager->setOTAStatus(100);
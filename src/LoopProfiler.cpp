@@ -0,0 +1,77 @@
+#include "LoopProfiler.h"
+#include <TLogPlus.h>
+
+static const char* const STAGE_NAMES[LOOP_STAGE_MAX] = {
+    "ota", "serial", "gps", "screen", "buttons", "log", "telnet", "web", "housekeeping", "total"
+};
+
+LoopProfiler::LoopProfiler()
+    : _cyclesPerMicro(1), _loopStart(0), _lastMark(0) {
+}
+
+void LoopProfiler::begin() {
+    // The CPU clock can be changed at runtime, so pick up the current rate each pass
+    _cyclesPerMicro = getCpuFrequencyMhz();
+    if (_cyclesPerMicro == 0) {
+        _cyclesPerMicro = 1;
+    }
+    _loopStart = ESP.getCycleCount();
+    _lastMark = _loopStart;
+}
+
+void LoopProfiler::mark(LoopStage stage) {
+    uint32_t now = ESP.getCycleCount();
+    _stages[stage].record(elapsedMicros(_lastMark, now));
+    _lastMark = now;
+}
+
+void LoopProfiler::end() {
+    uint32_t now = ESP.getCycleCount();
+    _stages[LOOP_STAGE_TOTAL].record(elapsedMicros(_loopStart, now));
+}
+
+void LoopProfiler::reset() {
+    for (uint8_t i = 0; i < LOOP_STAGE_MAX; i++) {
+        _stages[i].reset();
+    }
+}
+
+LoopStage LoopProfiler::getSlowestStage() const {
+    LoopStage slowest = LOOP_STAGE_OTA;
+    uint32_t slowestTime = 0;
+    for (uint8_t i = 0; i < LOOP_STAGE_TOTAL; i++) {
+        uint32_t time = _stages[i].getPercentile(99);
+        if (time > slowestTime) {
+            slowestTime = time;
+            slowest = (LoopStage)i;
+        }
+    }
+    return slowest;
+}
+
+const char* LoopProfiler::stageName(LoopStage stage) {
+    return stage < LOOP_STAGE_MAX ? STAGE_NAMES[stage] : "unknown";
+}
+
+void LoopProfiler::printToLog() {
+    TLogPlus::Log.printf("Loop timing (us) over %u passes\n", _stages[LOOP_STAGE_TOTAL].getCount());
+    TLogPlus::Log.printf("%-13s %8s %8s %8s %8s\n", "stage", "min", "p50", "p99", "max");
+    for (uint8_t i = 0; i < LOOP_STAGE_MAX; i++) {
+        const LatencyHistogram& stage = _stages[i];
+        TLogPlus::Log.printf("%-13s %8u %8u %8u %8u\n", STAGE_NAMES[i],
+                             stage.getMin(), stage.getPercentile(50), stage.getPercentile(99), stage.getMax());
+    }
+}
+
+void LoopProfiler::toJson(JsonObject root) const {
+    root["passes"] = _stages[LOOP_STAGE_TOTAL].getCount();
+    JsonObject stages = root["stages"].to<JsonObject>();
+    for (uint8_t i = 0; i < LOOP_STAGE_MAX; i++) {
+        const LatencyHistogram& stage = _stages[i];
+        JsonObject entry = stages[STAGE_NAMES[i]].to<JsonObject>();
+        entry["min"] = stage.getMin();
+        entry["p50"] = stage.getPercentile(50);
+        entry["p99"] = stage.getPercentile(99);
+        entry["max"] = stage.getMax();
+    }
+}
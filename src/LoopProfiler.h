@@ -0,0 +1,49 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "LatencyHistogram.h"
+
+enum LoopStage : uint8_t
+{
+    LOOP_STAGE_OTA = 0,
+    LOOP_STAGE_SERIAL,
+    LOOP_STAGE_GPS,
+    LOOP_STAGE_SCREEN,
+    LOOP_STAGE_BUTTONS,
+    LOOP_STAGE_LOG,
+    LOOP_STAGE_TELNET,
+    LOOP_STAGE_WEB,
+    LOOP_STAGE_HOUSEKEEPING,
+    LOOP_STAGE_TOTAL,
+
+    LOOP_STAGE_MAX
+};
+
+/// @brief Times each stage of the main loop with the CPU cycle counter. Call begin() at
+/// the top of loop() and mark() after each stage; the time since the previous mark is
+/// recorded in that stage's histogram in microseconds.
+class LoopProfiler {
+public:
+    LoopProfiler();
+
+    void begin();
+    void mark(LoopStage stage);
+    void end();
+    void reset();
+
+    const LatencyHistogram& getStage(LoopStage stage) const { return _stages[stage]; }
+    /// @brief Stage (other than the total) with the highest 99th percentile.
+    LoopStage getSlowestStage() const;
+    static const char* stageName(LoopStage stage);
+
+    void printToLog();
+    void toJson(JsonObject root) const;
+
+private:
+    uint32_t elapsedMicros(uint32_t from, uint32_t to) const { return (to - from) / _cyclesPerMicro; }
+
+    LatencyHistogram _stages[LOOP_STAGE_MAX];
+    uint32_t _cyclesPerMicro;
+    uint32_t _loopStart;
+    uint32_t _lastMark;
+};
@@ -0,0 +1,327 @@
+#include "NMEAParser.h"
+#include <string.h>
+
+// Combines a sentence type and term index into a single switch label
+#define TERM(type, index) (((type) << 5) | (index))
+
+NMEAParser::NMEAParser()
+    : _sentenceCount(0), _validCount(0), _checksumFailures(0), _overflowCount(0) {
+    reset();
+    _sentence = GPSFix();
+    _sentenceType = NMEA_UNKNOWN;
+    _sentencePart = _sentenceParts = 1;
+    _lastSentence[0] = '\0';
+    _lastSentenceLength = 0;
+}
+
+void NMEAParser::reset() {
+    _inSentence = false;
+    _length = 0;
+}
+
+void NMEAParser::beginSentence() {
+    _inSentence = true;
+    _inChecksum = false;
+    _length = 0;
+    _termLength = 0;
+    _termIndex = 0;
+    _checksum = 0;
+    _receivedChecksum = 0;
+    _checksumDigits = 0;
+    _type = NMEA_UNKNOWN;
+    _pendingPart = _pendingParts = 1;
+    _pending = GPSFix();
+}
+
+bool NMEAParser::encode(char c) {
+    if (c == '$') {
+        beginSentence();
+        _buffer[_length++] = c;
+        return false;
+    }
+
+    if (!_inSentence) {
+        return false;
+    }
+
+    if (_length >= NMEA_MAX_SENTENCE) {
+        // Too long to be a valid sentence, wait for the next '$'
+        _overflowCount++;
+        _inSentence = false;
+        return false;
+    }
+    _buffer[_length++] = c;
+
+    switch (c) {
+        case ',':
+            _checksum ^= c;
+            endTerm();
+            return false;
+        case '*':
+            endTerm();
+            _inChecksum = true;
+            return false;
+        case '\r':
+            return false;
+        case '\n':
+            _inSentence = false;
+            return endSentence();
+        default:
+            break;
+    }
+
+    if (_inChecksum) {
+        int8_t value = hexValue(c);
+        if (value < 0 || _checksumDigits >= 2) {
+            _checksumFailures++;
+            _inSentence = false;
+            return false;
+        }
+        _receivedChecksum = (_receivedChecksum << 4) | value;
+        _checksumDigits++;
+    } else {
+        _checksum ^= c;
+        if (_termLength < NMEA_MAX_TERM - 1) {
+            _term[_termLength++] = c;
+        }
+    }
+    return false;
+}
+
+bool NMEAParser::endSentence() {
+    if (!_inChecksum || _checksumDigits != 2 || _receivedChecksum != _checksum) {
+        _checksumFailures++;
+        return false;
+    }
+    _validCount++;
+
+    if (_type == NMEA_UNKNOWN) {
+        // Valid, but nothing we know how to decode (e.g. PMTK acknowledgements)
+        return false;
+    }
+
+    _pending.sentences = GPS_SENTENCE_BIT(_type);
+    _sentence = _pending;
+    _sentenceType = _type;
+    _sentencePart = _pendingPart;
+    _sentenceParts = _pendingParts;
+
+    memcpy(_lastSentence, _buffer, _length);
+    _lastSentence[_length] = '\0';
+    _lastSentenceLength = _length;
+    _sentenceCount++;
+    return true;
+}
+
+void NMEAParser::endTerm() {
+    _term[_termLength] = '\0';
+    parseTerm();
+    _termIndex++;
+    _termLength = 0;
+}
+
+void NMEAParser::parseTerm() {
+    if (_termIndex == 0) {
+        // Ignore the two character talker ID (GP, GN, GL, ...) so any constellation is accepted
+        if (strcmp(_term, "PGTOP") == 0) {
+            _type = NMEA_PGTOP;
+        } else if (_termLength == 5) {
+            const char* id = _term + 2;
+            if (strcmp(id, "RMC") == 0) _type = NMEA_RMC;
+            else if (strcmp(id, "GGA") == 0) _type = NMEA_GGA;
+            else if (strcmp(id, "GSA") == 0) _type = NMEA_GSA;
+            else if (strcmp(id, "GSV") == 0) _type = NMEA_GSV;
+            else if (strcmp(id, "VTG") == 0) _type = NMEA_VTG;
+            else if (strcmp(id, "GLL") == 0) _type = NMEA_GLL;
+        }
+        return;
+    }
+
+    if (_type == NMEA_UNKNOWN || _termLength == 0) {
+        return;
+    }
+
+    switch (TERM(_type, _termIndex)) {
+        // Time of fix
+        case TERM(NMEA_RMC, 1):
+        case TERM(NMEA_GGA, 1):
+        case TERM(NMEA_GLL, 5):
+            _pending.time = parseTime(_term);
+            _pending.fields |= GPS_FIELD_TIME;
+            break;
+
+        // Receiver status
+        case TERM(NMEA_RMC, 2):
+        case TERM(NMEA_GLL, 6):
+            _pending.active = (_term[0] == 'A');
+            _pending.fields |= GPS_FIELD_STATUS;
+            break;
+
+        // Latitude and longitude, with the hemisphere in the following term
+        case TERM(NMEA_RMC, 3):
+        case TERM(NMEA_GGA, 2):
+        case TERM(NMEA_GLL, 1):
+            _pending.latitude = parseCoordinate(_term);
+            _pending.fields |= GPS_FIELD_LOCATION;
+            break;
+        case TERM(NMEA_RMC, 4):
+        case TERM(NMEA_GGA, 3):
+        case TERM(NMEA_GLL, 2):
+            if (_term[0] == 'S') _pending.latitude = -_pending.latitude;
+            break;
+        case TERM(NMEA_RMC, 5):
+        case TERM(NMEA_GGA, 4):
+        case TERM(NMEA_GLL, 3):
+            _pending.longitude = parseCoordinate(_term);
+            break;
+        case TERM(NMEA_RMC, 6):
+        case TERM(NMEA_GGA, 5):
+        case TERM(NMEA_GLL, 4):
+            if (_term[0] == 'W') _pending.longitude = -_pending.longitude;
+            break;
+
+        // Speed over ground (knots) and course over ground
+        case TERM(NMEA_RMC, 7):
+        case TERM(NMEA_VTG, 5):
+            _pending.speed = parseDecimal(_term, 2);
+            _pending.fields |= GPS_FIELD_SPEED;
+            break;
+        case TERM(NMEA_RMC, 8):
+        case TERM(NMEA_VTG, 1):
+            _pending.course = parseDecimal(_term, 2);
+            _pending.fields |= GPS_FIELD_COURSE;
+            break;
+
+        case TERM(NMEA_RMC, 9):
+            _pending.date = parseDate(_term);
+            _pending.fields |= GPS_FIELD_DATE;
+            break;
+
+        case TERM(NMEA_GGA, 6):
+            _pending.quality = parseDecimal(_term, 0);
+            _pending.fields |= GPS_FIELD_QUALITY;
+            // A GGA sentence is the only status indicator in GGA_ONLY mode
+            _pending.active = (_pending.quality > 0);
+            _pending.fields |= GPS_FIELD_STATUS;
+            break;
+        case TERM(NMEA_GGA, 7):
+            _pending.satellites = parseDecimal(_term, 0);
+            _pending.fields |= GPS_FIELD_SATELLITES;
+            break;
+        case TERM(NMEA_GGA, 8):
+        case TERM(NMEA_GSA, 16):
+            _pending.hdop = parseDecimal(_term, 2);
+            _pending.fields |= GPS_FIELD_HDOP;
+            break;
+        case TERM(NMEA_GGA, 9):
+            _pending.altitude = parseDecimal(_term, 2);
+            _pending.fields |= GPS_FIELD_ALTITUDE;
+            break;
+
+        case TERM(NMEA_GSA, 2):
+            _pending.fixType = parseDecimal(_term, 0);
+            _pending.fields |= GPS_FIELD_FIX_TYPE;
+            break;
+
+        case TERM(NMEA_GSV, 1):
+            _pendingParts = parseDecimal(_term, 0);
+            break;
+        case TERM(NMEA_GSV, 2):
+            _pendingPart = parseDecimal(_term, 0);
+            break;
+        case TERM(NMEA_GSV, 3):
+            _pending.satellitesInView = parseDecimal(_term, 0);
+            _pending.fields |= GPS_FIELD_IN_VIEW;
+            break;
+
+        case TERM(NMEA_PGTOP, 2):
+            _pending.antenna = parseDecimal(_term, 0);
+            _pending.fields |= GPS_FIELD_ANTENNA;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/// @brief Parses a decimal number into a fixed point integer with scale fractional digits.
+/// Extra fractional digits are truncated.
+int32_t NMEAParser::parseDecimal(const char* term, uint8_t scale) {
+    bool negative = false;
+    if (*term == '-') {
+        negative = true;
+        term++;
+    }
+
+    int32_t value = 0;
+    while (*term >= '0' && *term <= '9') {
+        value = value * 10 + (*term++ - '0');
+    }
+
+    uint8_t digits = 0;
+    if (*term == '.') {
+        term++;
+        while (*term >= '0' && *term <= '9' && digits < scale) {
+            value = value * 10 + (*term++ - '0');
+            digits++;
+        }
+    }
+    for (; digits < scale; digits++) {
+        value *= 10;
+    }
+    return negative ? -value : value;
+}
+
+/// @brief Converts a ddmm.mmmm (or dddmm.mmmm) coordinate into microdegrees.
+int32_t NMEAParser::parseCoordinate(const char* term) {
+    uint32_t whole = 0;
+    while (*term >= '0' && *term <= '9') {
+        whole = whole * 10 + (*term++ - '0');
+    }
+
+    // Minutes in millionths of a minute
+    uint32_t minutes = (whole % 100) * 1000000UL;
+    if (*term == '.') {
+        term++;
+        uint32_t place = 100000UL;
+        while (*term >= '0' && *term <= '9' && place > 0) {
+            minutes += (*term++ - '0') * place;
+            place /= 10;
+        }
+    }
+    return (int32_t)((whole / 100) * 1000000UL + (minutes + 30) / 60);
+}
+
+/// @brief Converts hhmmss.sss into milliseconds since midnight.
+uint32_t NMEAParser::parseTime(const char* term) {
+    uint32_t hhmmss = 0;
+    while (*term >= '0' && *term <= '9') {
+        hhmmss = hhmmss * 10 + (*term++ - '0');
+    }
+    uint32_t ms = 0;
+    if (*term == '.') {
+        term++;
+        uint32_t place = 100;
+        while (*term >= '0' && *term <= '9' && place > 0) {
+            ms += (*term++ - '0') * place;
+            place /= 10;
+        }
+    }
+    return (hhmmss / 10000) * 3600000UL + ((hhmmss / 100) % 100) * 60000UL + (hhmmss % 100) * 1000UL + ms;
+}
+
+/// @brief Packs ddmmyy into the GPSFix::date format.
+uint16_t NMEAParser::parseDate(const char* term) {
+    uint32_t ddmmyy = parseDecimal(term, 0);
+    uint16_t day = ddmmyy / 10000;
+    uint16_t month = (ddmmyy / 100) % 100;
+    uint16_t year = ddmmyy % 100;
+    return (year << 9) | (month << 5) | day;
+}
+
+int8_t NMEAParser::hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
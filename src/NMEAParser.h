@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "GPSFix.h"
+
+#define NMEA_MAX_SENTENCE 120
+#define NMEA_MAX_TERM 16
+
+/// @brief Incremental NMEA 0183 parser. Bytes are fed one at a time as they arrive
+/// from the receiver, the checksum is accumulated on the fly and the fields of each
+/// sentence are decoded straight into a GPSFix without any heap allocation.
+class NMEAParser {
+public:
+    NMEAParser();
+
+    /// @brief Consumes one byte of the NMEA stream.
+    /// @return true when the byte completed a sentence with a valid checksum.
+    bool encode(char c);
+    void reset();
+
+    /// @brief Fields decoded from the last valid sentence, see GPSFix::fields.
+    const GPSFix& sentence() const { return _sentence; }
+    NMEASentenceType sentenceType() const { return _sentenceType; }
+    /// @brief Message number and count of the last sentence within its group. Only GSV
+    /// is split over several messages, everything else is 1 of 1.
+    uint8_t sentencePart() const { return _sentencePart; }
+    uint8_t sentenceParts() const { return _sentenceParts; }
+    /// @brief Raw text of the last valid sentence, including the trailing CR/LF.
+    const char* lastSentence() const { return _lastSentence; }
+    size_t lastSentenceLength() const { return _lastSentenceLength; }
+
+    uint32_t getSentenceCount() const { return _sentenceCount; }
+    /// @brief Sentences that passed the checksum, including types that aren't decoded.
+    uint32_t getValidCount() const { return _validCount; }
+    uint32_t getChecksumFailures() const { return _checksumFailures; }
+    uint32_t getOverflowCount() const { return _overflowCount; }
+
+private:
+    void beginSentence();
+    void endTerm();
+    bool endSentence();
+    void parseTerm();
+
+    static int32_t parseDecimal(const char* term, uint8_t scale);
+    static int32_t parseCoordinate(const char* term);
+    static uint32_t parseTime(const char* term);
+    static uint16_t parseDate(const char* term);
+    static int8_t hexValue(char c);
+
+    char _buffer[NMEA_MAX_SENTENCE + 1];
+    uint8_t _length;
+    char _lastSentence[NMEA_MAX_SENTENCE + 1];
+    uint8_t _lastSentenceLength;
+
+    char _term[NMEA_MAX_TERM];
+    uint8_t _termLength;
+    uint8_t _termIndex;
+
+    uint8_t _checksum;
+    uint8_t _receivedChecksum;
+    uint8_t _checksumDigits;
+    bool _inSentence;
+    bool _inChecksum;
+
+    NMEASentenceType _type;
+    NMEASentenceType _sentenceType;
+    uint8_t _pendingPart, _pendingParts;
+    uint8_t _sentencePart, _sentenceParts;
+    GPSFix _pending;
+    GPSFix _sentence;
+
+    uint32_t _sentenceCount;
+    uint32_t _validCount;
+    uint32_t _checksumFailures;
+    uint32_t _overflowCount;
+};
@@ -0,0 +1,139 @@
+#include "NMEAReplayStream.h"
+
+#define MILLIS_PER_DAY 86400000UL
+
+NMEAReplayStream::NMEAReplayStream()
+    : _speed(1), _isOpen(false), _finished(false), _lineLength(0), _linePosition(0),
+      _hasBaseTime(false), _baseTime(0), _startMillis(0), _releaseAt(0) {
+    _path[0] = '\0';
+}
+
+bool NMEAReplayStream::open(fs::FS& fs, const char* path, float speed) {
+    close();
+    _file = fs.open(path, "r");
+    if (!_file) {
+        return false;
+    }
+    // Never wait on a short read at the end of the file
+    _file.setTimeout(0);
+
+    strncpy(_path, path, sizeof(_path) - 1);
+    _path[sizeof(_path) - 1] = '\0';
+    _speed = speed < 0 ? 0 : speed;
+    _isOpen = true;
+    _finished = false;
+    _lineLength = _linePosition = 0;
+    _hasBaseTime = false;
+    _startMillis = _releaseAt = millis();
+    return true;
+}
+
+void NMEAReplayStream::close() {
+    if (_file) {
+        _file.close();
+    }
+    _isOpen = false;
+    _finished = false;
+    _lineLength = _linePosition = 0;
+}
+
+int NMEAReplayStream::available() {
+    if (!_isOpen) {
+        return 0;
+    }
+    if (_linePosition >= _lineLength && !loadLine()) {
+        return 0;
+    }
+    return isReleased() ? _lineLength - _linePosition : 0;
+}
+
+int NMEAReplayStream::read() {
+    if (available() <= 0) {
+        return -1;
+    }
+    return (uint8_t)_line[_linePosition++];
+}
+
+int NMEAReplayStream::peek() {
+    if (available() <= 0) {
+        return -1;
+    }
+    return (uint8_t)_line[_linePosition];
+}
+
+size_t NMEAReplayStream::write(uint8_t) {
+    // Commands meant for the receiver have nowhere to go during a replay
+    return 1;
+}
+
+bool NMEAReplayStream::isReleased() const {
+    return _speed == 0 || (int32_t)(millis() - _releaseAt) >= 0;
+}
+
+/// @brief Reads the next line of the capture and works out when it is due.
+bool NMEAReplayStream::loadLine() {
+    if (_finished) {
+        return false;
+    }
+
+    size_t length = 0;
+    while (length == 0) {
+        if (!_file.available()) {
+            _finished = true;
+            return false;
+        }
+        length = _file.readBytesUntil('\n', _line, NMEA_MAX_SENTENCE);
+    }
+    _line[length++] = '\n';
+    _line[length] = '\0';
+    _lineLength = length;
+    _linePosition = 0;
+
+    uint32_t time;
+    if (_speed > 0 && lineTime(_line, time)) {
+        if (!_hasBaseTime) {
+            _hasBaseTime = true;
+            _baseTime = time;
+            _startMillis = millis();
+        }
+        uint32_t elapsed = time >= _baseTime ? time - _baseTime : time + MILLIS_PER_DAY - _baseTime;
+        _releaseAt = _startMillis + (uint32_t)(elapsed / _speed);
+    }
+    return true;
+}
+
+/// @brief Extracts the UTC time from RMC, GGA and GLL sentences.
+bool NMEAReplayStream::lineTime(const char* line, uint32_t& time) {
+    if (line[0] != '$' || strlen(line) < 7) {
+        return false;
+    }
+
+    const char* type = line + 3;
+    uint8_t timeField;
+    if (strncmp(type, "RMC,", 4) == 0 || strncmp(type, "GGA,", 4) == 0) {
+        timeField = 1;
+    } else if (strncmp(type, "GLL,", 4) == 0) {
+        timeField = 5;
+    } else {
+        return false;
+    }
+
+    const char* field = line;
+    for (uint8_t i = 0; i < timeField; i++) {
+        field = strchr(field, ',');
+        if (field == nullptr) {
+            return false;
+        }
+        field++;
+    }
+    if (field[0] < '0' || field[0] > '9') {
+        return false;
+    }
+
+    uint32_t hhmmss = strtoul(field, nullptr, 10);
+    const char* end = strchr(field, ',');
+    const char* fraction = strchr(field, '.');
+    uint32_t ms = (fraction != nullptr && (end == nullptr || fraction < end)) ? (uint32_t)(atof(fraction) * 1000) : 0;
+    time = (hhmmss / 10000) * 3600000UL + ((hhmmss / 100) % 100) * 60000UL + (hhmmss % 100) * 1000UL + ms;
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include "NMEAParser.h"
+
+/// @brief Plays back a recorded NMEA capture as if it were arriving from the receiver.
+/// Sentences are released on the schedule of their UTC timestamps, scaled by the
+/// playback speed, or as fast as they can be read when the speed is 0.
+class NMEAReplayStream : public Stream {
+public:
+    NMEAReplayStream();
+
+    bool open(fs::FS& fs, const char* path, float speed);
+    void close();
+    bool isOpen() const { return _isOpen; }
+    bool isFinished() const { return _isOpen && _finished; }
+    float getSpeed() const { return _speed; }
+    const char* getPath() const { return _path; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t write(uint8_t c) override;
+    void flush() override {}
+
+private:
+    bool loadLine();
+    bool isReleased() const;
+    static bool lineTime(const char* line, uint32_t& time);
+
+    File _file;
+    char _path[64];
+    float _speed;
+    bool _isOpen;
+    bool _finished;
+
+    char _line[NMEA_MAX_SENTENCE + 2];
+    size_t _lineLength;
+    size_t _linePosition;
+
+    bool _hasBaseTime;
+    uint32_t _baseTime;       // UTC time of the first sentence, ms since midnight
+    uint32_t _startMillis;    // millis() when the first sentence was released
+    uint32_t _releaseAt;      // millis() when the current line becomes available
+};
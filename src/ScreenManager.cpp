@@ -4,6 +4,7 @@
 #include <TLogPlus.h>
 #include <LittleFS.h>
 #include "Constants.h"
+#include "FixedTrig.h"
 #include <algorithm>
 
 #include "fonts/futura_medium_bt10pt8b.h"
@@ -29,12 +30,15 @@
 #define TOP_PADDING 30
 #define ICON_PADDING 10
 #define ICON_SIZE 32
+#define COMPASS_LABEL_HEIGHT 34   // room above the rose for the north arrow and label
 
 
 ScreenManager::ScreenManager(AppSettings *settings) : 
     _settings(settings), _orientation(LANDSCAPE), _screenMode(SCREEN_BOOT)
 {
     _gpsManager = nullptr;
+    _loopProfiler = nullptr;
+    _compassSprite = nullptr;
     _bus = new Arduino_ESP32PAR8Q(
         SCREEN_DC_PIN, SCREEN_CS_PIN, SCREEN_WR_PIN, SCREEN_RD_PIN,
         SCREEN_D0_PIN, SCREEN_D1_PIN, SCREEN_D2_PIN, SCREEN_D3_PIN, SCREEN_D4_PIN, SCREEN_D5_PIN, SCREEN_D6_PIN, SCREEN_D7_PIN);
@@ -43,7 +47,9 @@ ScreenManager::ScreenManager(AppSettings *settings) :
                               SCREEN_COL_OFFSET, SCREEN_ROW_OFFSET /* 1 */,
                               SCREEN_COL_OFFSET, SCREEN_ROW_OFFSET /* 2 */);
 
-    _gfx = new Arduino_Canvas(SCREEN_WIDTH, SCREEN_HEIGHT, _display);
+    // Only the regions drawn since the last frame are sent to the panel
+    _canvas = new DamageCanvas(SCREEN_WIDTH, SCREEN_HEIGHT, _display, _bus);
+    _gfx = _canvas;
 
     _refreshGPSTime = _settings->getInt(SETTING_SCREEN_REFRESH_INTERVAL, SCREEN_REFRESH_INTERVAL_DEFAULT);
     _refreshOtherTime = _settings->getInt(SETTING_REFRESH_INTERVAL_OTHER, REFRESH_INTERVAL_OTHER_DEFAULT);
@@ -60,10 +66,15 @@ void ScreenManager::begin()
     // Configure PWN backlight control
     ledcSetup(BACKLIGHT_PWM_CHANNEL, BACKLIGHT_PWM_FREQ, BACKLIGHT_PWM_RESOLUTION);
     ledcAttachPin(GFX_BL, BACKLIGHT_PWM_CHANNEL);
-    setBacklight(_settings->getInt("backlight", 100));
+    setBacklight(_settings->getInt(SETTING_BACKLIGHT, BACKLIGHT_DEFAULT));
 
     _gfx->begin();
     _gfx->setTextWrap(false);
+    // Send frames from the other core so drawing the next one doesn't wait on the bus
+    _canvas->startFlushTask(SCREEN_FLUSH_CORE);
+
+    // Read every icon up front so a new icon state never stalls a frame
+    _icons.load(LittleFS);
     
     int rotation = _settings->getInt(SETTING_DISPLAY_ROTATION, DISPLAY_ROTATION_DEFAULT);
     setRotation(rotation, false);
@@ -73,6 +84,8 @@ void ScreenManager::begin()
 void ScreenManager::setRotation(uint8_t rotation, bool redraw)
 {
     _gfx->setRotation(rotation);
+    _icons.prepare(rotation);
+    _compassRose.rotated(rotation);
     if (rotation == 0 || rotation == 2) {
         _orientation = PORTRAIT;
     } else {
@@ -86,7 +99,67 @@ void ScreenManager::setRotation(uint8_t rotation, bool redraw)
 
 void ScreenManager::loop()
 {
-    refreshIfTimerElapsed(200);
+    ScreenSchedule schedule = scheduleFor(_screenMode);
+    uint32_t elapsed = millis() - _refreshTimer;
+    if (elapsed < schedule.minInterval)
+    {
+        return;
+    }
+
+    // Events for what isn't on this screen are dropped, a screen change redraws everything
+    uint8_t events = _pendingEvents.exchange(0);
+    uint32_t skipped = _skippedFrames.exchange(0);
+    if (_screenMode >= 0 && _screenMode < SCREEN_MAX)
+    {
+        _screenStats[_screenMode].skipped += skipped;
+    }
+    if (events & schedule.events)
+    {
+        _eventRedraws++;
+        refreshScreen();
+    }
+    else if (schedule.maxInterval > 0 && elapsed >= schedule.maxInterval)
+    {
+        _timedRedraws++;
+        refreshScreen();
+    }
+}
+
+void ScreenManager::invalidate(uint8_t events)
+{
+    uint8_t previous = _pendingEvents.fetch_or(events);
+    // The screen never showed the data behind the earlier event
+    if (previous & events & scheduleFor(_screenMode).events)
+    {
+        _skippedFrames.fetch_add(1);
+    }
+}
+
+/// @brief What each screen redraws for and how often. Screens with live GPS data follow
+/// the fix, the rest only change on their own events or the "other" refresh interval.
+ScreenManager::ScreenSchedule ScreenManager::scheduleFor(ScreenMode mode) const
+{
+    // The icon bar shows the WiFi and GPS fix status on most screens
+    const uint8_t iconBarEvents = SCREEN_EVENT_WIFI | SCREEN_EVENT_GPS_STATUS | SCREEN_EVENT_INPUT;
+    switch (mode)
+    {
+        case SCREEN_CORE:
+        case SCREEN_NAVIGATION:
+        case SCREEN_GPS:
+            return { (uint8_t)(iconBarEvents | SCREEN_EVENT_GPS), SCREEN_MIN_REDRAW_MS, _refreshGPSTime };
+        case SCREEN_WIFI:
+        case SCREEN_DEVICE_DEBUG:
+            return { iconBarEvents, SCREEN_MIN_REDRAW_MS, _refreshOtherTime };
+        case SCREEN_ABOUT:
+            return { SCREEN_EVENT_INPUT, SCREEN_MIN_REDRAW_MS, 0 };
+        case SCREEN_UPDATE_OTA:
+            return { SCREEN_EVENT_OTA, SCREEN_MIN_REDRAW_MS, 0 };
+        case SCREEN_NEEDS_CONFIG:
+            return { (uint8_t)(SCREEN_EVENT_WIFI | SCREEN_EVENT_INPUT), SCREEN_MIN_REDRAW_MS, _refreshOtherTime };
+        case SCREEN_BOOT:
+        default:
+            return { 0, SCREEN_MIN_REDRAW_MS, 0 };
+    }
 }
 
 void ScreenManager::setBacklight(uint8_t percent)
@@ -96,7 +169,7 @@ void ScreenManager::setBacklight(uint8_t percent)
     }
     uint32_t dutyCycle = (255 * percent) / 100;
     ledcWrite(BACKLIGHT_PWM_CHANNEL, dutyCycle);
-    _settings->setInt("backlight", percent);
+    _settings->setInt(SETTING_BACKLIGHT, percent);
 }
 
 void ScreenManager::setGPSManager(GPSManager *manager)
@@ -104,15 +177,9 @@ void ScreenManager::setGPSManager(GPSManager *manager)
     _gpsManager = manager;
 }
 
-bool ScreenManager::refreshIfTimerElapsed(uint32_t maxTime)
+void ScreenManager::setLoopProfiler(LoopProfiler *profiler)
 {
-    if (millis() - _refreshTimer > maxTime)
-    {
-        _refreshTimer = millis(); // reset the timer
-        refreshScreen();
-        return true;
-    }
-    return false;
+    _loopProfiler = profiler;
 }
 
 void ScreenManager::setScreenMode(ScreenMode mode)
@@ -142,17 +209,97 @@ ScreenMode ScreenManager::getScreenMode()
 
 void ScreenManager::refreshScreen(bool fullRefresh)
 {
+    _refreshTimer = millis();
+    uint32_t start = micros();
     _gfx->startWrite();
     
-    // Force a full redraw of the screen
-    _gfx->fillScreen(BG_COLOR);
+    if (fullRefresh)
+    {
+        // Force a full redraw of the screen
+        _gfx->fillScreen(BG_COLOR);
+    }
+    else
+    {
+        // Everything else on the canvas is already background
+        _canvas->clearPreviousDamage(BG_COLOR);
+    }
 
-    if (_screenMode != SCREEN_BOOT && _screenMode != SCREEN_ABOUT)
+    drawScreen(_screenMode);
+    _gfx->endWrite();
+    uint32_t drawn = micros();
+    _canvas->flushDamage();
+    recordFrame(drawn - start, micros() - drawn);
+}
+
+static uint32_t rollingAverage(uint32_t average, uint32_t sample, uint32_t count)
+{
+    if (count <= 1)
+    {
+        return sample;
+    }
+    return average + ((int32_t)sample - (int32_t)average) / SCREEN_STATS_SMOOTHING;
+}
+
+void ScreenManager::recordFrame(uint32_t drawTime, uint32_t flushTime)
+{
+    if (_screenMode < 0 || _screenMode >= SCREEN_MAX)
+    {
+        return;
+    }
+    ScreenStats& stats = _screenStats[_screenMode];
+    stats.frames++;
+    stats.bytesPushed += (uint64_t)_canvas->getLastFlushPixels() * sizeof(uint16_t);
+    stats.drawAverage = rollingAverage(stats.drawAverage, drawTime, stats.frames);
+    stats.drawMax = max(stats.drawMax, drawTime);
+    stats.flushAverage = rollingAverage(stats.flushAverage, flushTime, stats.frames);
+    stats.flushMax = max(stats.flushMax, flushTime);
+
+    uint32_t now = millis();
+    if (stats.frames > 1)
+    {
+        stats.intervalAverage = rollingAverage(stats.intervalAverage, now - stats.lastFrame, stats.frames - 1);
+    }
+    stats.lastFrame = now;
+}
+
+void ScreenManager::resetScreenStats()
+{
+    for (int mode = 0; mode < SCREEN_MAX; mode++)
+    {
+        _screenStats[mode] = {};
+    }
+    _skippedFrames = 0;
+}
+
+void ScreenManager::screenStatsToJson(JsonObject root) const
+{
+    root["current"] = screenName(_screenMode);
+    root["flushTask"] = _canvas->isFlushAsync();
+    JsonObject screens = root["screens"].to<JsonObject>();
+    for (int mode = 0; mode < SCREEN_MAX; mode++)
+    {
+        const ScreenStats& stats = _screenStats[mode];
+        JsonObject entry = screens[screenName((ScreenMode)mode)].to<JsonObject>();
+        entry["frames"] = stats.frames;
+        entry["skipped"] = stats.skipped;
+        entry["bytes"] = stats.bytesPushed;
+        entry["drawAvg"] = stats.drawAverage;
+        entry["drawMax"] = stats.drawMax;
+        entry["flushAvg"] = stats.flushAverage;
+        entry["flushMax"] = stats.flushMax;
+        entry["fps"] = stats.getFramesPerSecond();
+    }
+}
+
+/// @brief Draws everything on a screen onto the canvas, which must already be cleared.
+void ScreenManager::drawScreen(ScreenMode mode)
+{
+    if (mode != SCREEN_BOOT && mode != SCREEN_ABOUT)
     {
         drawIconBar();
     }
 
-    switch (_screenMode) {
+    switch (mode) {
         case SCREEN_BOOT:
             drawBootScreen();
             break;
@@ -187,31 +334,155 @@ void ScreenManager::refreshScreen(bool fullRefresh)
             _gfx->setTextSize(1);
             
             _gfx->println("This screen unintentionally left blank");
-            _gfx->printf("[%u]", _screenMode);
+            _gfx->printf("[%u]", mode);
             break;
     }
+}
+
+/// @brief Draws a screen into the canvas without sending it to the panel, which keeps
+/// showing the front buffer. Call refreshScreen(true) afterwards to put the canvas back.
+void ScreenManager::renderScreen(ScreenMode mode)
+{
+    _gfx->startWrite();
+    _gfx->fillScreen(BG_COLOR);
+    drawScreen(mode);
     _gfx->endWrite();
-    _gfx->flush();
 }
 
-static String imagePathForWiFiStatus() {
+/// @brief Renders a screen off the panel and writes it to the file system as a binary PPM,
+/// so layouts can be compared against a known good image.
+bool ScreenManager::saveScreenshot(ScreenMode mode, fs::FS& fs, const char* path)
+{
+    File file = fs.open(path, "w");
+    if (!file)
+    {
+        TLogPlus::Log.warningln("Screen: Unable to create %s", path);
+        return false;
+    }
+
+    uint32_t start = micros();
+    renderScreen(mode);
+    uint32_t drawTime = micros() - start;
+
+    int16_t width = _gfx->width();
+    int16_t height = _gfx->height();
+    file.printf("P6\n%d %d\n255\n", width, height);
+    uint8_t row[SCREEN_HEIGHT * 3];
+    bool ok = true;
+    for (int16_t y = 0; y < height && ok; y++)
+    {
+        uint8_t* out = row;
+        for (int16_t x = 0; x < width; x++)
+        {
+            uint16_t pixel = _canvas->getLogicalPixel(x, y);
+            uint8_t r = (pixel >> 11) & 0x1F, g = (pixel >> 5) & 0x3F, b = pixel & 0x1F;
+            *out++ = (r << 3) | (r >> 2);
+            *out++ = (g << 2) | (g >> 4);
+            *out++ = (b << 3) | (b >> 2);
+        }
+        ok = file.write(row, width * 3) == (size_t)width * 3;
+    }
+    file.close();
+    refreshScreen(true);
+
+    if (!ok)
+    {
+        TLogPlus::Log.warningln("Screen: Unable to write %s", path);
+        return false;
+    }
+    TLogPlus::Log.infoln("Screen: Saved %s screen (%dx%d, drawn in %u us) to %s",
+                         screenName(mode), width, height, drawTime, path);
+    return true;
+}
+
+/// @brief Times drawing each screen off the panel and logs the results, to measure
+/// rendering changes without a camera on the display.
+void ScreenManager::benchmarkScreens(uint16_t iterations)
+{
+    TLogPlus::Log.printf("Screen draw time (us) over %u frames, rotation %u:\n", iterations, _gfx->getRotation());
+    for (int mode = SCREEN_BOOT; mode < SCREEN_MAX; mode++)
+    {
+        LatencyHistogram drawTime;
+        for (uint16_t i = 0; i < iterations; i++)
+        {
+            uint32_t start = micros();
+            renderScreen((ScreenMode)mode);
+            drawTime.record(micros() - start);
+            // Benchmarking every screen can take a while, keep the watchdog fed
+            yield();
+        }
+        TLogPlus::Log.printf("  %-10s avg %u, p50 %u, p99 %u, max %u\n", screenName((ScreenMode)mode),
+                             drawTime.getAverage(), drawTime.getPercentile(50), drawTime.getPercentile(99),
+                             drawTime.getMax());
+    }
+    refreshScreen(true);
+}
+
+const char* ScreenManager::screenName(ScreenMode mode)
+{
+    switch (mode)
+    {
+        case SCREEN_BOOT: return "boot";
+        case SCREEN_CORE: return "core";
+        case SCREEN_NAVIGATION: return "navigation";
+        case SCREEN_WIFI: return "wifi";
+        case SCREEN_GPS: return "gps";
+        case SCREEN_ABOUT: return "about";
+        case SCREEN_UPDATE_OTA: return "ota";
+        case SCREEN_NEEDS_CONFIG: return "config";
+        case SCREEN_DEVICE_DEBUG: return "debug";
+        default: return "unknown";
+    }
+}
+
+void ScreenManager::printToLog()
+{
+    const LatencyHistogram& flushTime = _canvas->getFlushTime();
+    TLogPlus::Log.printf("Screen flush (us): min %u, p50 %u, p99 %u, max %u over %u frames\n",
+                         flushTime.getMin(), flushTime.getPercentile(50), flushTime.getPercentile(99),
+                         flushTime.getMax(), flushTime.getCount());
+    const LatencyHistogram& flushWait = _canvas->getFlushWait();
+    TLogPlus::Log.printf("Flush wait (us): p50 %u, p99 %u, max %u (%s)\n",
+                         flushWait.getPercentile(50), flushWait.getPercentile(99), flushWait.getMax(),
+                         _canvas->isFlushAsync() ? "flush task" : "synchronous");
+    TLogPlus::Log.printf("Last flush: %u of %u pixels\n", _canvas->getLastFlushPixels(), _canvas->getFullFramePixels());
+    TLogPlus::Log.printf("Redraws: %u for events, %u on the timer\n", _eventRedraws, _timedRedraws);
+    TLogPlus::Log.printf("Last image: %u bytes read, %u us to decode and draw\n", _lastImageBytes, _lastImageTime);
+    _canvas->getGlyphCache().printToLog();
+    TLogPlus::Log.printf("%-10s %7s %7s %9s %13s %13s %5s\n", "Screen", "Frames", "Skipped", "KB pushed",
+                         "Draw avg/max", "Flush avg/max", "FPS");
+    for (int mode = 0; mode < SCREEN_MAX; mode++)
+    {
+        const ScreenStats& stats = _screenStats[mode];
+        if (stats.frames == 0 && stats.skipped == 0)
+        {
+            continue;
+        }
+        TLogPlus::Log.printf("%-10s %7u %7u %9u %6u/%6u %6u/%6u %5.1f\n", screenName((ScreenMode)mode),
+                             stats.frames, stats.skipped, (uint32_t)(stats.bytesPushed / 1024),
+                             stats.drawAverage, stats.drawMax, stats.flushAverage, stats.flushMax,
+                             stats.getFramesPerSecond());
+    }
+}
+
+static IconId iconForWiFiStatus() {
     if (WiFi.status() == WL_CONNECTED) {
         int signal = WiFi.RSSI();
         if (signal <= -80) {
-            return "/images/wifi-32-low.rgb";
+            return ICON_WIFI_32_LOW;
         } else if (signal <= -67) {
-            return "/images/wifi-32-medium.rgb";
+            return ICON_WIFI_32_MEDIUM;
         } else {
-            return "/images/wifi-32-high.rgb";
+            return ICON_WIFI_32_HIGH;
         }
     } else {
-        return "/images/wifi-32-disconnected.rgb";
+        return ICON_WIFI_32_DISCONNECTED;
     }
 }
 
-static String imagePathForBatteryStatus() {
+static IconId iconForBatteryStatus() {
     // TODO: Implement battery support more broadly
-    return "/images/battery-32-none.rgb";
+    return ICON_BATTERY_32_NONE;
 }
 
 /// @brief Draws the status icon bar on the screen - either on the right side in landscape or at the bottom in portrait
@@ -238,44 +509,46 @@ void ScreenManager::drawIconBar()
     }
 
     // Draw the WiFi icon
-    drawIcon(pos_x, pos_y, iconDimension_x, iconDimension_y, imagePathForWiFiStatus());
+    drawIcon(pos_x, pos_y, iconForWiFiStatus());
     incrementPosition();
 
     // Draw the GPS icon
-    String gpsImagePath = _gpsManager->hasFix() ? "/images/gps-32-connected.rgb" : "/images/gps-32-disconnected.rgb";
-    drawIcon(pos_x, pos_y, iconDimension_x, iconDimension_y, gpsImagePath);
+    drawIcon(pos_x, pos_y, _gpsManager->hasFix() ? ICON_GPS_32_CONNECTED : ICON_GPS_32_DISCONNECTED);
     incrementPosition();
 
     // Draw the battery icon
-    drawIcon(pos_x, pos_y, iconDimension_x, iconDimension_y, imagePathForBatteryStatus());
+    drawIcon(pos_x, pos_y, iconForBatteryStatus());
     incrementPosition();
 }
 
-void ScreenManager::drawIcon(int x, int y, int width, int height, String filename)
+void ScreenManager::drawIcon(int x, int y, IconId icon)
 {
-    CachedBitmap *cached = nullptr;
-
-    // Check if image is cached
-    auto it = _bitmapCache.find(filename);
-    if (it != _bitmapCache.end()) {
-        cached = &it->second;
-    } else {
-        // Allocate and load image from FS
-        uint8_t *imgBuf = (uint8_t*) malloc(width * height * 3);
-        if (!imgBuf) return; // Check malloc success
-
-        File file = LittleFS.open(filename, "r");
-        if (!file || file.read(imgBuf, width * height * 3) != width * height * 3) {
-            free(imgBuf);
-            return; // Read error
-        }
+    Image565 *image = _icons.get(icon);
+    if (image != nullptr) {
+        _canvas->drawImage(x, y, *image);
+    }
+}
 
-        // Cache it
-        _bitmapCache[filename] = { imgBuf, width, height };
-        cached = &_bitmapCache[filename];
+/// @brief Draws a large image by decoding it from the file system a row at a time,
+/// without ever holding the whole image in memory.
+void ScreenManager::drawImage(int x, int y, const String& filename)
+{
+    Image565Reader reader;
+    if (!reader.open(LittleFS, filename.c_str())) {
+        return;
     }
 
-    _gfx->draw24bitRGBBitmap(x, y, cached->data, cached->width, cached->height);
+    uint32_t start = micros();
+    uint16_t row[IMAGE_MAX_WIDTH];
+    for (int16_t j = 0; j < reader.height(); j++) {
+        if (!reader.readRow(row)) {
+            TLogPlus::Log.warningln("Image: %s ended early", filename.c_str());
+            break;
+        }
+        _canvas->drawRow(x, y + j, row, reader.width(), reader.hasTransparency(), reader.transparentColor());
+    }
+    _lastImageTime = micros() - start;
+    _lastImageBytes = reader.getBytesRead();
 }
 
 void ScreenManager::drawCoreScreen() 
@@ -286,12 +559,16 @@ void ScreenManager::drawCoreScreen()
     _gfx->setTextColor(WHITE, BG_COLOR);
     _gfx->setCursor(LEFT_PADDING, TOP_PADDING);
 
-    if (_gpsManager->getTimeStr().isEmpty() || _gpsManager->getDateStr().isEmpty()) {
+    const GPSFix& fix = _gpsManager->getFix();
+    if (!fix.has(GPS_FIELD_TIME | GPS_FIELD_DATE)) {
         _gfx->println("No date/time yet");
     } else {
-        _gfx->print(_gpsManager->getDateStr());
+        char buffer[GPS_FORMAT_BUFFER_SIZE];
+        GPSManager::formatDate(fix, buffer, sizeof(buffer));
+        _gfx->print(buffer);
         _gfx->print(" ");
-        _gfx->println(_gpsManager->getTimeStr());
+        GPSManager::formatTime(fix, buffer, sizeof(buffer));
+        _gfx->println(buffer);
     }
 
     // Fill the space with black where we're going to write the GPS data
@@ -326,14 +603,7 @@ void ScreenManager::drawCoreScreen()
 
 /// @brief Draws to the graphics device the direction, degrees, minutes, and seconds at the current cursor position.
 void ScreenManager::drawDMS(DMS value) {
-    _gfx->print(String(value.direction));
-    _gfx->print(" ");
-    _gfx->print(String(value.degrees));
-    _gfx->print("\xB0");
-    _gfx->print(String(value.minutes));
-    _gfx->print("\'");
-    _gfx->print(String(value.seconds, 2));
-    _gfx->print("\"");
+    _gfx->printf("%c %d\xB0%d'%.2f\"", value.direction, value.degrees, value.minutes, value.seconds);
 }
 
 void ScreenManager::drawNavigationScreen()
@@ -353,13 +623,13 @@ void ScreenManager::drawNavigationScreen()
     int16_t x1, y1;
     uint16_t w, h;
     String speed = String(_gpsManager->getSpeed(), 1);
-    _gfx->getTextBounds(speed, 0, 0, &x1, &y1, &w, &h);
+    _canvas->measureText(speed.c_str(), &x1, &y1, &w, &h);
     _gfx->setCursor(speed_x - (w/2), speed_y);
     _gfx->println(speed);
 
     setFontAndSize(&NORMAL_FONT, 1);
     String units = "knots";
-    _gfx->getTextBounds(units, 0, 0, &x1, &y1, &w, &h);
+    _canvas->measureText(units.c_str(), &x1, &y1, &w, &h);
     moveCursorX(speed_x - (w/2));
     _gfx->print(units);
 
@@ -367,11 +637,46 @@ void ScreenManager::drawNavigationScreen()
 }
 
 /// @brief Draws a compass rose with the upper left corner at pos_x, pos_y and of dimensions width, with an arrow pointing in direction.
+/// The rose itself is drawn once into a sprite, so each frame only copies it and adds the needle and heading.
 /// @param pos_x 
 /// @param pos_y 
 /// @param width 
 /// @param direction 
 void ScreenManager::drawCompass(int pos_x, int pos_y, int radius, int headingDegrees)
+{
+    uint16_t ARROW_COLOR = RED;
+
+    int centerX = pos_x + radius/2;
+    int centerY = pos_y + radius/2;
+
+    if (_compassRadius != radius)
+    {
+        buildCompassRose(radius);
+    }
+    if (_compassRose.isLoaded())
+    {
+        _canvas->drawImage(centerX - radius - 1, centerY - radius - COMPASS_LABEL_HEIGHT, _compassRose);
+    }
+
+    // Print the course direction
+    int16_t x1, y1;
+    uint16_t w, h;
+    String course = String(headingDegrees) + "\xB0";
+    setFontAndSize(&HEADING_FONT, 1);
+    _canvas->measureText(course.c_str(), &x1, &y1, &w, &h);
+    _gfx->setCursor(centerX - (w/2), centerY + radius + h + 10);
+    _gfx->print(course);
+
+    // Rotate by -90 so north is the right direction
+    int needleLength = radius - 10;
+    int xTip = centerX + fixedScale(needleLength, fixedCos(headingDegrees - 90));
+    int yTip = centerY + fixedScale(needleLength, fixedSin(headingDegrees - 90));
+    _gfx->drawLine(centerX, centerY, xTip, yTip, ARROW_COLOR);
+}
+
+/// @brief Renders the parts of the compass that never move (circle, axes, tick marks and the
+/// north arrow and label) into a PSRAM sprite that drawCompass copies onto the canvas.
+void ScreenManager::buildCompassRose(int radius)
 {
     uint16_t OUTER_COLOR = BLUE;
     uint16_t INNER_COLOR = DARKCYAN;
@@ -379,14 +684,30 @@ void ScreenManager::drawCompass(int pos_x, int pos_y, int radius, int headingDeg
     uint16_t TEXT_COLOR = WHITE;
     uint16_t ARROW_COLOR = RED;
 
-    int centerX = pos_x + radius/2;
-    int centerY = pos_y + radius/2;
+    _compassRose.release();
+    delete _compassSprite;
+    _compassRadius = radius;
+
+    int16_t width = radius * 2 + 3;
+    int16_t height = radius * 2 + COMPASS_LABEL_HEIGHT + 2;
+    _compassSprite = new Arduino_Canvas(width, height, nullptr);
+    if (!_compassSprite->begin(GFX_SKIP_OUTPUT_BEGIN))
+    {
+        TLogPlus::Log.warningln("Screen: Unable to allocate the compass sprite");
+        delete _compassSprite;
+        _compassSprite = nullptr;
+        return;
+    }
 
-    _gfx->drawCircle(centerX, centerY, radius, OUTER_COLOR);
-    _gfx->drawLine(centerX, centerY - radius, centerX, centerY + radius, INNER_COLOR); // N-S
-    _gfx->drawLine(centerX - radius, centerY, centerX + radius, centerY, INNER_COLOR); // W-E
+    int centerX = radius + 1;
+    int centerY = radius + COMPASS_LABEL_HEIGHT;
 
-    _gfx->fillTriangle(
+    _compassSprite->fillScreen(BG_COLOR);
+    _compassSprite->drawCircle(centerX, centerY, radius, OUTER_COLOR);
+    _compassSprite->drawLine(centerX, centerY - radius, centerX, centerY + radius, INNER_COLOR); // N-S
+    _compassSprite->drawLine(centerX - radius, centerY, centerX + radius, centerY, INNER_COLOR); // W-E
+
+    _compassSprite->fillTriangle(
         centerX, centerY - radius - 10,        // tip of the arrow
         centerX - 5, centerY - radius + 5,     // bottom left
         centerX + 5, centerY - radius + 5,     // bottom right
@@ -394,42 +715,35 @@ void ScreenManager::drawCompass(int pos_x, int pos_y, int radius, int headingDeg
     );
 
     for (int angle = 0; angle < 360; angle += 30) {
-        float rad = angle * DEG_TO_RAD;
-        int x1 = centerX + cos(rad) * (radius - 5);
-        int y1 = centerY + sin(rad) * (radius - 5);
-        int x2 = centerX + cos(rad) * radius;
-        int y2 = centerY + sin(rad) * radius;
-        _gfx->drawLine(x1, y1, x2, y2, TICK_MARK_COLOR);
+        int32_t cosAngle = fixedCos(angle);
+        int32_t sinAngle = fixedSin(angle);
+        int x1 = centerX + fixedScale(radius - 5, cosAngle);
+        int y1 = centerY + fixedScale(radius - 5, sinAngle);
+        int x2 = centerX + fixedScale(radius, cosAngle);
+        int y2 = centerY + fixedScale(radius, sinAngle);
+        _compassSprite->drawLine(x1, y1, x2, y2, TICK_MARK_COLOR);
     }
 
     // Print the N for north
-    
-    _gfx->setTextSize(1);
-    _gfx->setFont(&NORMAL_FONT);        // SMALL_TEXT_FONT?
-
-    String north = "N";
+    _compassSprite->setTextSize(1);
+    _compassSprite->setFont(&NORMAL_FONT);
+    _compassSprite->setTextColor(TEXT_COLOR);
 
     int16_t x1, y1;
     uint16_t w, h;
-    _gfx->getTextBounds(north, 0, 0, &x1, &y1, &w, &h);
-    _gfx->setCursor(centerX - (w/2) - 3, centerY - radius - 18);
-    _gfx->print("N");
-
-    // Print the course direction
-    String course = String(headingDegrees) + "\xB0";
-    setFontAndSize(&HEADING_FONT, 1);
-    _gfx->getTextBounds(course, 0, 0, &x1, &y1, &w, &h);
-    _gfx->setCursor(centerX - (w/2), centerY + radius + h + 10);
-    _gfx->print(course);
-
-    // Rotate by -90 so north is the right direction
-    float headingRad = (headingDegrees - 90) * DEG_TO_RAD;
-    int needleLength = radius - 10;
-    int xTip = centerX + cos(headingRad) * needleLength;
-    int yTip = centerY + sin(headingRad) * needleLength;
+    _compassSprite->getTextBounds("N", 0, 0, &x1, &y1, &w, &h);
+    _compassSprite->setCursor(centerX - (w/2) - 3, centerY - radius - 18);
+    _compassSprite->print("N");
 
-    _gfx->drawLine(centerX, centerY, xTip, yTip, ARROW_COLOR);
-    
+    // Everything around the rose is background, so it can be copied without a transparency key
+    Image565Header header = {};
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_VERSION;
+    header.format = IMAGE_FORMAT_RGB565;
+    header.width = width;
+    header.height = height;
+    _compassRose.attach(header, _compassSprite->getFramebuffer());
+    _compassRose.rotated(_gfx->getRotation());
 }
 
 void ScreenManager::drawAboutScreen() 
@@ -447,7 +761,7 @@ void ScreenManager::drawAboutScreen()
     moveCursorX(122);
     _gfx->println(AUTO_VERSION);
 
-    drawIcon(8, 45, 92, 101, "/images/nomaduino-92x101.rgb");
+    drawImage(8, 45, "/images/nomaduino-92x101.565");
 }
 
 void ScreenManager::drawWiFiScreen()
@@ -500,7 +814,7 @@ void ScreenManager::moveNextScreen(int8_t direction)
 void ScreenManager::drawBootScreen()
 {
     int pos_x = 17, pos_y = 22;
-    drawIcon(pos_x, pos_y, 122, 122, "/images/nomaduino-122.rgb");
+    drawImage(pos_x, pos_y, "/images/nomaduino-122.565");
 
     _gfx->setCursor(140, 54);
     _gfx->setTextColor(WHITE, BG_COLOR);
@@ -525,19 +839,25 @@ void ScreenManager::drawGPSScreen()
     _gfx->setFont(&NORMAL_FONT);
     _gfx->setTextSize(1);
     
+    const GPSFix& fix = _gpsManager->getFix();
+    char buffer[GPS_FORMAT_BUFFER_SIZE];
+
     // Fix
     _gfx->setTextColor(_gpsManager->hasFix() ? GREEN : RED, BG_COLOR);
     moveCursorX(LEFT_PADDING);
-    _gfx->println(_gpsManager->getFixStr());
+    GPSManager::formatFixQuality(fix, buffer, sizeof(buffer));
+    _gfx->println(buffer);
     
     // Satellites
     _gfx->setTextColor(WHITE, BG_COLOR);
     moveCursorX(LEFT_PADDING);
-    _gfx->println(_gpsManager->getSatellitesStr());
+    GPSManager::formatSatellites(fix, buffer, sizeof(buffer));
+    _gfx->println(buffer);
     
     // Antenna
     moveCursorX(LEFT_PADDING);
-    _gfx->println(_gpsManager->getAntennaStr());
+    GPSManager::formatAntenna(fix, buffer, sizeof(buffer));
+    _gfx->println(buffer);
 }
 
 const char* ScreenManager::currentWiFiStatus()
@@ -562,14 +882,15 @@ const char* ScreenManager::currentWiFiStatus()
 
 void ScreenManager::setOTAStatus(uint8_t percentComplete)
 {
+    // Progress is reported from the web server task, so leave drawing to loop()
     _otaStatusPercentComplete = percentComplete;
-    refreshScreen();
+    invalidate(SCREEN_EVENT_OTA);
 }
 
 void ScreenManager::setPortalSSID(String ssid)
 {
     _portalSSID = ssid;
-    refreshScreen();
+    invalidate(SCREEN_EVENT_WIFI);
 }
 
 void ScreenManager::drawUpdateScreen()
@@ -623,7 +944,7 @@ void ScreenManager::setFontAndSize(const GFXfont *f, int size)
 
 void ScreenManager::drawDebugScreen()
 {
-    auto humanReadableBytes = [](uint16_t bytes) -> String {
+    auto humanReadableBytes = [](uint32_t bytes) -> String {
         if (bytes < 1024) {
             return String(bytes) + " b";
         }
@@ -643,8 +964,46 @@ void ScreenManager::drawDebugScreen()
     _gfx->setCursor(LEFT_PADDING, 60);
     _gfx->setFont(&NORMAL_FONT);
     _gfx->setTextSize(1);
-    _gfx->printf("HEAP: %s / %s\n", humanReadableBytes(ESP.getFreeHeap()), humanReadableBytes(ESP.getHeapSize()));
+    _gfx->printf("HEAP: %s / %s\n", humanReadableBytes(ESP.getFreeHeap()).c_str(),
+                 humanReadableBytes(ESP.getHeapSize()).c_str());
+    moveCursorX(LEFT_PADDING);
+    _gfx->printf("PSRAM: %s / %s\n", humanReadableBytes(ESP.getFreePsram()).c_str(),
+                 humanReadableBytes(ESP.getPsramSize()).c_str());
+
+    if (_loopProfiler != nullptr)
+    {
+        const LatencyHistogram& total = _loopProfiler->getStage(LOOP_STAGE_TOTAL);
+        moveCursorX(LEFT_PADDING);
+        _gfx->printf("LOOP: %u / %u / %u us\n", total.getPercentile(50), total.getPercentile(99), total.getMax());
+
+        LoopStage slowest = _loopProfiler->getSlowestStage();
+        const LatencyHistogram& stage = _loopProfiler->getStage(slowest);
+        moveCursorX(LEFT_PADDING);
+        _gfx->printf("SLOW: %s %u / %u us\n", LoopProfiler::stageName(slowest), stage.getPercentile(99), stage.getMax());
+    }
+
+    const LatencyHistogram& flushTime = _canvas->getFlushTime();
+    moveCursorX(LEFT_PADDING);
+    _gfx->printf("FLUSH: %u us, %u px, wait %u us\n", flushTime.getPercentile(50), _canvas->getLastFlushPixels(),
+                 _canvas->getFlushWait().getPercentile(99));
+
+    // Whichever screen costs the most per frame, drawing plus handing the frame off
+    ScreenMode heaviest = SCREEN_BOOT;
+    for (int mode = 0; mode < SCREEN_MAX; mode++)
+    {
+        const ScreenStats& stats = _screenStats[mode];
+        const ScreenStats& best = _screenStats[heaviest];
+        if (stats.frames > 0 && stats.drawAverage + stats.flushAverage > best.drawAverage + best.flushAverage)
+        {
+            heaviest = (ScreenMode)mode;
+        }
+    }
+    const ScreenStats& heavy = _screenStats[heaviest];
+    moveCursorX(LEFT_PADDING);
+    _gfx->printf("FRAME: %s %u / %u us\n", screenName(heaviest), heavy.drawAverage + heavy.flushAverage,
+                 heavy.drawMax + heavy.flushMax);
+    const ScreenStats& current = _screenStats[SCREEN_DEVICE_DEBUG];
     moveCursorX(LEFT_PADDING);
-    _gfx->printf("PSRAM: %s / %s\n", humanReadableBytes(ESP.getFreePsram()), humanReadableBytes(ESP.getPsramSize()));
+    _gfx->printf("FPS: %.1f, skipped %u\n", current.getFramesPerSecond(), current.skipped);
 }
 
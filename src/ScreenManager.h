@@ -3,8 +3,12 @@
 #include "GPSManager.h"
 #include <Arduino_GFX_Library.h>
 #include "AppSettings.h"
+#include "LoopProfiler.h"
+#include <ArduinoJson.h>
+#include "DamageCanvas.h"
+#include "IconAtlas.h"
 #include <LittleFS.h>
-#include <map>
+#include <atomic>
 
 enum ScreenMode {
   SCREEN_NONE = -1,
@@ -29,6 +33,32 @@ enum ScreenOrientation {
 #define BRIGHTNESS_HIGH 255
 #define BRIGHTNESS_OFF  0
 
+// Reasons the screen may need to be redrawn, see ScreenManager::invalidate
+#define SCREEN_EVENT_GPS         (1 << 0)   // a new fix was published
+#define SCREEN_EVENT_GPS_STATUS  (1 << 1)   // the receiver gained or lost its fix
+#define SCREEN_EVENT_WIFI        (1 << 2)   // WiFi connected, disconnected or changed address
+#define SCREEN_EVENT_INPUT       (1 << 3)   // a button was pressed
+#define SCREEN_EVENT_OTA         (1 << 4)   // firmware update progress
+
+#define SCREEN_MIN_REDRAW_MS 100   // fastest any screen redraws, however many events arrive
+#define SCREEN_STATS_SMOOTHING 8   // weight of the history in the rolling averages
+
+/// @brief Frame telemetry for one ScreenMode. Times are in microseconds and the
+/// averages are exponential, so they follow the last few dozen frames.
+struct ScreenStats {
+    uint32_t frames;           // frames drawn and flushed
+    uint32_t skipped;          // events that arrived again before the last one was drawn
+    uint64_t bytesPushed;      // sent to the panel
+    uint32_t drawAverage;
+    uint32_t drawMax;
+    uint32_t flushAverage;     // time the loop spent in flushDamage()
+    uint32_t flushMax;
+    uint32_t intervalAverage;  // ms between frames
+    uint32_t lastFrame;        // millis() at the last frame
+
+    float getFramesPerSecond() const { return intervalAverage ? 1000.0f / intervalAverage : 0; }
+};
+
 class ScreenManager 
 {
 
@@ -39,6 +69,9 @@ public:
     void loop();
 
     void refreshScreen(bool fullRefresh = false);
+    /// @brief Flags that something on screen may have changed. Safe to call from any task;
+    /// the redraw happens in loop() if the current screen shows what changed.
+    void invalidate(uint8_t events);
     void setScreenMode(ScreenMode mode);
     void showDefaultScreen();
     ScreenMode getScreenMode();
@@ -46,36 +79,61 @@ public:
     void setScreenOrientation(ScreenOrientation orientation);
     void setBacklight(uint8_t percent);
     void setGPSManager(GPSManager* gpsManager);
+    void setLoopProfiler(LoopProfiler* loopProfiler);
     void setOTAStatus(uint8_t percentComplete);
     void setPortalSSID(String ssid);
     void setRotation(uint8_t rotation, bool redraw = true);
     void moveNextScreen(int8_t direction);
+    void printToLog();
+    const ScreenStats& getScreenStats(ScreenMode mode) const { return _screenStats[mode]; }
+    void resetScreenStats();
+    void screenStatsToJson(JsonObject root) const;
+
+    /// @brief Draws a screen into the canvas without sending it to the panel.
+    void renderScreen(ScreenMode mode);
+    bool saveScreenshot(ScreenMode mode, fs::FS& fs, const char* path);
+    void benchmarkScreens(uint16_t iterations);
+    static const char* screenName(ScreenMode mode);
 
 private:
     GPSManager* _gpsManager;
+    LoopProfiler* _loopProfiler;
     AppSettings* _settings;
     Arduino_DataBus* _bus;
     Arduino_GFX* _gfx;
-    Arduino_GFX* _display;
+    DamageCanvas* _canvas;
+    Arduino_TFT* _display;
     ScreenMode _screenMode;
     ScreenOrientation _orientation;
     uint32_t _refreshTimer;
+    std::atomic<uint8_t> _pendingEvents{0};
+    uint32_t _eventRedraws = 0;
+    uint32_t _timedRedraws = 0;
+    std::atomic<uint32_t> _skippedFrames{0};
+    ScreenStats _screenStats[SCREEN_MAX] = {};
     uint32_t _refreshGPSTime;
     uint32_t _refreshOtherTime;
     uint8_t _otaStatusPercentComplete;
     String _portalSSID;
     ScreenMode _screenLoop[6] = { SCREEN_CORE, SCREEN_NAVIGATION, SCREEN_WIFI, SCREEN_GPS, SCREEN_ABOUT, SCREEN_DEVICE_DEBUG };
     
-    struct CachedBitmap {
-        uint8_t* data;
-        int width;
-        int height;
-    };
+    IconAtlas _icons;
+    // Compass rose without the needle, rendered once and copied each frame
+    Arduino_Canvas* _compassSprite;
+    Image565 _compassRose;
+    int _compassRadius = 0;
+    // Cost of the last image streamed from the file system
+    uint32_t _lastImageBytes = 0;
+    uint32_t _lastImageTime = 0;
 
-    std::map<String, CachedBitmap> _bitmapCache;
-
-    bool refreshIfTimerElapsed(uint32_t maxTime);
+    struct ScreenSchedule {
+        uint8_t events;         // SCREEN_EVENT_* bits that change what is shown
+        uint32_t minInterval;   // ms between redraws at the most
+        uint32_t maxInterval;   // ms before redrawing without an event, 0 for never
+    };
+    ScreenSchedule scheduleFor(ScreenMode mode) const;
     const char* currentWiFiStatus();
+    void buildCompassRose(int radius);
     void drawAboutScreen();
     void drawBootScreen();
     void drawCompass(int pos_x, int pos_y, int radius, int headingDegrees);
@@ -83,9 +141,12 @@ private:
     void drawDebugScreen();
     void drawDMS(DMS value);
     void drawGPSScreen();
-    void drawIcon(int x, int y, int width, int height, String filename);
+    void drawIcon(int x, int y, IconId icon);
+    void drawImage(int x, int y, const String& filename);
     void drawIconBar();
     void drawNavigationScreen();
+    void drawScreen(ScreenMode mode);
+    void recordFrame(uint32_t drawTime, uint32_t flushTime);
     void drawUpdateScreen();
     void drawWiFiPortalScreen();
     void drawWiFiScreen();
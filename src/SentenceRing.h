@@ -0,0 +1,74 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/// @brief Lock-free single producer / single consumer queue of text lines. Each slot is
+/// preallocated, so pushing and popping only copy bytes and never touch the heap.
+/// Exactly one task may call push() and exactly one task may call pop().
+template <size_t SLOTS, size_t SLOT_SIZE>
+class SentenceRing {
+    static_assert((SLOTS & (SLOTS - 1)) == 0, "SentenceRing slot count must be a power of two");
+
+public:
+    /// @brief Copies a line into the queue. Drops the line and returns false when full.
+    bool push(const char* line, size_t length) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        uint32_t tail = _tail.load(std::memory_order_acquire);
+        if (head - tail >= SLOTS) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Slot& slot = _slots[head & (SLOTS - 1)];
+        if (length > SLOT_SIZE) {
+            length = SLOT_SIZE;
+        }
+        memcpy(slot.data, line, length);
+        slot.length = length;
+        _head.store(head + 1, std::memory_order_release);
+
+        uint32_t used = head + 1 - tail;
+        if (used > _highWater.load(std::memory_order_relaxed)) {
+            _highWater.store(used, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /// @brief Copies the oldest line into buffer (NUL terminated).
+    /// @return the line length, or 0 when the queue is empty.
+    size_t pop(char* buffer, size_t bufferSize) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return 0;
+        }
+
+        const Slot& slot = _slots[tail & (SLOTS - 1)];
+        size_t length = slot.length < bufferSize - 1 ? slot.length : bufferSize - 1;
+        memcpy(buffer, slot.data, length);
+        buffer[length] = '\0';
+        _tail.store(tail + 1, std::memory_order_release);
+        return length;
+    }
+
+    /// @brief Discards everything queued. Consumer side only.
+    void clear() { _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release); }
+    size_t size() const { return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire); }
+    size_t capacity() const { return SLOTS; }
+    bool full() const { return size() >= SLOTS; }
+    uint32_t getDroppedCount() const { return _dropped.load(std::memory_order_relaxed); }
+    uint32_t getHighWaterMark() const { return _highWater.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        size_t length;
+        char data[SLOT_SIZE];
+    };
+
+    Slot _slots[SLOTS];
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+    std::atomic<uint32_t> _dropped{0};
+    std::atomic<uint32_t> _highWater{0};
+};
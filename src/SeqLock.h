@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#ifdef ESP_PLATFORM
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+
+/// @brief Single writer sequence lock. The writer never blocks; readers on any task or
+/// core copy the value and retry if a write overlapped the copy, so every read returns
+/// a value exactly as it was published. T must be trivially copyable.
+///
+/// The value is held as relaxed atomic words, so a reader overlapping a write is a
+/// retry rather than a data race (and ThreadSanitizer agrees). On the ESP32 these
+/// compile to plain 32-bit loads and stores.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock values are copied bytewise");
+
+public:
+    /// @brief Starts out holding a value with every byte zero.
+    SeqLock() : _sequence(0) {
+        for (std::atomic<uint32_t>& word : _words) {
+            word.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    /// @brief Publishes a new value. Only one task may write.
+    void write(const T& value) {
+        uint32_t sequence = _sequence.load(std::memory_order_relaxed);
+        _sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        store(value);
+        _sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /// @brief Returns a consistent copy of the last published value.
+    T read() const {
+        T copy;
+        for (uint32_t attempt = 0;; attempt++) {
+            uint32_t before = _sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                load(copy);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_sequence.load(std::memory_order_relaxed) == before) {
+                    return copy;
+                }
+            }
+            if (attempt >= SPIN_ATTEMPTS) {
+                // The writer may be a lower priority task preempted on this core, let it finish
+                yield();
+            }
+        }
+    }
+
+    /// @brief Number of writes so far.
+    uint32_t version() const { return _sequence.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr uint32_t SPIN_ATTEMPTS = 8;
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    static constexpr size_t TAIL = sizeof(T) - (WORDS - 1) * sizeof(uint32_t);
+
+    void store(const T& value) {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+        uint32_t word;
+        for (size_t i = 0; i < WORDS - 1; i++) {
+            memcpy(&word, bytes + i * sizeof(uint32_t), sizeof(uint32_t));
+            _words[i].store(word, std::memory_order_relaxed);
+        }
+        word = 0;
+        memcpy(&word, bytes + (WORDS - 1) * sizeof(uint32_t), TAIL);
+        _words[WORDS - 1].store(word, std::memory_order_relaxed);
+    }
+
+    void load(T& value) const {
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(&value);
+        uint32_t word;
+        for (size_t i = 0; i < WORDS - 1; i++) {
+            word = _words[i].load(std::memory_order_relaxed);
+            memcpy(bytes + i * sizeof(uint32_t), &word, sizeof(uint32_t));
+        }
+        word = _words[WORDS - 1].load(std::memory_order_relaxed);
+        memcpy(bytes + (WORDS - 1) * sizeof(uint32_t), &word, TAIL);
+    }
+
+    static void yield() {
+#ifdef ESP_PLATFORM
+        vTaskDelay(1);
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    std::atomic<uint32_t> _sequence;
+    std::atomic<uint32_t> _words[WORDS];
+};
@@ -2,10 +2,16 @@
 #include <TLogPlus.h>
 
 UDPManager::UDPManager(const char* destHost, uint16_t destPort)
-    : _destPort(destPort), _hasBegun(false) {
+    : _destGeneration(0), _hasDestIP(false), _nextResolveTime(0), _destPort(destPort), _hasBegun(false),
+      _overflowPolicy(UDP_DROP_OLDEST), _taskHandle(nullptr),
+      _batching(false), _batchMaxBytes(UDP_MAX_DATAGRAM), _batchMaxDelay(1000), _batchLength(0), _batchStartTime(0),
+      _packetsSent(0), _bytesSent(0), _sendFailures(0), _droppedOldest(0), _droppedNewest(0) {
     strncpy(_destHost, destHost, sizeof(_destHost) - 1);
     _destHost[sizeof(_destHost) - 1] = '\0';
     _listenPort = random(49152, 65535);
+    _queue = xQueueCreateStatic(UDP_QUEUE_LENGTH, sizeof(Message), _queueStorage, &_queueState);
+    _socketMutex = xSemaphoreCreateMutexStatic(&_socketMutexState);
+    _queueMutex = xSemaphoreCreateMutexStatic(&_queueMutexState);
 }
 
 void UDPManager::begin() {
@@ -14,39 +20,282 @@ void UDPManager::begin() {
     }
 
     TLogPlus::Log.infoln("UDP: Initializing UDP on port %u", _listenPort);
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
     if (_udp.begin(_listenPort)) {
         _hasBegun = true;
+        // The host is looked up by the first send, off the caller's task
+        _hasDestIP = false;
+        _nextResolveTime = millis();
         TLogPlus::Log.infoln("UDP: Initalized.");
     } else {
         TLogPlus::Log.errorln("UDP: Failed to initalize.");
         _hasBegun = false;
     }
+    xSemaphoreGive(_socketMutex);
 }
 
 void UDPManager::stop() {
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
     _udp.stop();
     _hasBegun = false;
+    _hasDestIP = false;
+    xSemaphoreGive(_socketMutex);
 }
 
+/// @brief Starts the task that owns all socket sends, so a stalled Wi-Fi link
+/// never holds up the caller of send().
+bool UDPManager::startNetworkTask(int core) {
+    if (_taskHandle != nullptr) {
+        return true;
+    }
+    BaseType_t result = xTaskCreatePinnedToCore(networkTask, "udp_send", UDP_TASK_STACK_SIZE,
+                                                this, UDP_TASK_PRIORITY, &_taskHandle, core);
+    if (result != pdPASS) {
+        TLogPlus::Log.errorln("UDP: Failed to start network task.");
+        _taskHandle = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void UDPManager::networkTask(void* param) {
+    UDPManager* manager = static_cast<UDPManager*>(param);
+    Message message;
+    for (;;) {
+        // Wake up in time to honor the batch delay even if nothing else arrives
+        TickType_t wait = portMAX_DELAY;
+        if (manager->_batchLength > 0) {
+            uint32_t age = millis() - manager->_batchStartTime;
+            wait = age >= manager->_batchMaxDelay ? 0 : pdMS_TO_TICKS(manager->_batchMaxDelay - age);
+        }
+
+        if (manager->receive(message, wait)) {
+            manager->process(message);
+        } else if (uxQueueMessagesWaiting(manager->_queue) == 0) {
+            manager->flushBatch();
+        }
+    }
+}
+
+/// @brief Takes the next message off the queue for the network task, waiting up to wait
+/// for one. Returns false if none arrived, or send() dropped it first.
+bool UDPManager::receive(Message& message, TickType_t wait) {
+    // Wait without the mutex, so send() is never held up by an idle network task
+    if (xQueuePeek(_queue, &message, wait) != pdTRUE) {
+        return false;
+    }
+    xSemaphoreTake(_queueMutex, portMAX_DELAY);
+    bool received = xQueueReceive(_queue, &message, 0) == pdTRUE;
+    xSemaphoreGive(_queueMutex);
+    return received;
+}
+
+/// @brief Sets the batching mode. Call before startNetworkTask().
+void UDPManager::setBatching(bool enabled, size_t maxBytes, uint32_t maxDelayMs) {
+    _batching = enabled;
+    _batchMaxBytes = (maxBytes == 0 || maxBytes > UDP_MAX_DATAGRAM) ? UDP_MAX_DATAGRAM : maxBytes;
+    _batchMaxDelay = maxDelayMs;
+}
+
+/// @brief Queues a sentence for the network task. Never blocks.
 void UDPManager::send(const char* message) {
     if (!_hasBegun) {
         TLogPlus::Log.debugln("UDP tried to send data when not begun. May indicate a connection issue.");
         return;
     }
 
-    _udp.beginPacket(_destHost, _destPort);
-    _udp.write((const uint8_t*)message, strlen(message));
-    int result = _udp.endPacket();
+    Message queued;
+    size_t length = strlen(message);
+    queued.length = length < sizeof(queued.data) ? length : sizeof(queued.data);
+    memcpy(queued.data, message, queued.length);
+    enqueue(queued);
+}
+
+/// @brief Marks the end of a GPS epoch so a batch can go out as one datagram.
+void UDPManager::flush() {
+    if (!_hasBegun || !_batching) {
+        return;
+    }
+    Message marker;
+    marker.length = 0;
+    enqueue(marker);
+}
+
+void UDPManager::enqueue(const Message& message) {
+    if (_taskHandle == nullptr) {
+        // No network task, send from the caller
+        process(message);
+        return;
+    }
+
+    if (xQueueSend(_queue, &message, 0) == pdTRUE) {
+        return;
+    }
+
+    // An epoch marker always gets in, otherwise two epochs would go out in one datagram
+    if (_overflowPolicy == UDP_DROP_NEWEST && message.length > 0) {
+        _droppedNewest++;
+        return;
+    }
+
+    dropOldestSentence();
+    if (xQueueSend(_queue, &message, 0) != pdTRUE) {
+        _droppedNewest++;
+    }
+}
+
+/// @brief Makes room in the queue by discarding the oldest sentence. Epoch markers ahead
+/// of it stay at the head of the queue, in order, so epochs never share a datagram.
+bool UDPManager::dropOldestSentence() {
+    xSemaphoreTake(_queueMutex, portMAX_DELAY);
+    // Markers with no sentences between them end the same batch, so one stands for them all
+    bool marker = false;
+    Message oldest;
+    bool dropped = false;
+    while (xQueueReceive(_queue, &oldest, 0) == pdTRUE) {
+        if (oldest.length > 0) {
+            _droppedOldest++;
+            dropped = true;
+            break;
+        }
+        marker = true;
+    }
+    if (marker) {
+        Message end;
+        end.length = 0;
+        xQueueSendToFront(_queue, &end, 0);
+    }
+    xSemaphoreGive(_queueMutex);
+    return dropped;
+}
+
+void UDPManager::process(const Message& message) {
+    if (message.length == 0) {
+        flushBatch();
+        return;
+    }
+
+    if (!_batching) {
+        sendDatagram((const uint8_t*)message.data, message.length);
+        return;
+    }
+
+    if (_batchLength + message.length > _batchMaxBytes) {
+        flushBatch();
+    }
+    if (message.length > _batchMaxBytes) {
+        // Never split a sentence across datagrams
+        sendDatagram((const uint8_t*)message.data, message.length);
+        return;
+    }
+
+    if (_batchLength == 0) {
+        _batchStartTime = millis();
+    }
+    memcpy(_batch + _batchLength, message.data, message.length);
+    _batchLength += message.length;
+}
+
+void UDPManager::flushBatch() {
+    if (_batchLength == 0) {
+        return;
+    }
+    sendDatagram(_batch, _batchLength);
+    _batchLength = 0;
+}
+
+/// @brief Resolves the destination host once, instead of on every packet. The lookup
+/// runs without _socketMutex held and a host that doesn't resolve is only tried again
+/// after UDP_RESOLVE_RETRY_MS, so a missing DNS server can't stall every datagram.
+/// @return true when the destination address is known.
+bool UDPManager::resolveDestination() {
+    char host[sizeof(_destHost)];
+    uint32_t generation = 0;
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
+    bool resolved = _hasDestIP;
+    bool due = !resolved && (int32_t)(millis() - _nextResolveTime) >= 0;
+    if (due) {
+        memcpy(host, _destHost, sizeof(host));
+        generation = _destGeneration;
+        _nextResolveTime = millis() + UDP_RESOLVE_RETRY_MS;
+    }
+    xSemaphoreGive(_socketMutex);
+    if (!due || host[0] == '\0') {
+        return resolved;
+    }
+
+    IPAddress address;
+    if (!address.fromString(host) && WiFi.hostByName(host, address) != 1) {
+        TLogPlus::Log.warningln("UDP: Unable to resolve %s, retrying in %u ms", host, UDP_RESOLVE_RETRY_MS);
+        return false;
+    }
+
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
+    // The host may have been changed while it was being looked up
+    resolved = generation == _destGeneration;
+    if (resolved) {
+        _destIP = address;
+        _hasDestIP = true;
+    }
+    xSemaphoreGive(_socketMutex);
+    if (resolved) {
+        TLogPlus::Log.infoln("UDP: Sending to %s:%u", address.toString().c_str(), _destPort);
+    }
+    return resolved;
+}
+
+void UDPManager::sendDatagram(const uint8_t* data, size_t length) {
+    if (!_hasBegun || (!_hasDestIP && !resolveDestination())) {
+        _sendFailures++;
+        return;
+    }
+
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
+    if (!_hasBegun || !_hasDestIP) {
+        // Stopped or given a new host since the check above
+        xSemaphoreGive(_socketMutex);
+        _sendFailures++;
+        return;
+    }
+
+    int result = 0;
+    if (_udp.beginPacket(_destIP, _destPort)) {
+        _udp.write(data, length);
+        result = _udp.endPacket();
+    }
+    xSemaphoreGive(_socketMutex);
+
     if (result == 0) {
+        _sendFailures++;
         TLogPlus::Log.debugln("UDP failed to send.");
+        return;
     }
+    _packetsSent++;
+    _bytesSent += length;
 }
 
 void UDPManager::setDestHost(const char* host) {
+    xSemaphoreTake(_socketMutex, portMAX_DELAY);
     strncpy(_destHost, host, sizeof(_destHost) - 1);
     _destHost[sizeof(_destHost) - 1] = '\0';
+    // Looked up by the next send, not here on the caller's task
+    _destGeneration++;
+    _hasDestIP = false;
+    _nextResolveTime = millis();
+    xSemaphoreGive(_socketMutex);
 }
 
 void UDPManager::setDestPort(uint16_t port) {
     _destPort = port;
 }
+
+void UDPManager::printToLog() {
+    TLogPlus::Log.printf("UDP: %s:%u (%s), batching %s (%u bytes / %u ms)\n",
+                         _destHost, _destPort, _hasDestIP ? _destIP.toString().c_str() : "unresolved",
+                         _batching ? "on" : "off", (unsigned)_batchMaxBytes, _batchMaxDelay);
+    TLogPlus::Log.printf("UDP: %u packets, %u bytes, %u failures\n", _packetsSent, _bytesSent, _sendFailures);
+    TLogPlus::Log.printf("UDP: queue %u/%u, %s, dropped %u oldest / %u newest\n",
+                         uxQueueMessagesWaiting(_queue), UDP_QUEUE_LENGTH,
+                         _overflowPolicy == UDP_DROP_OLDEST ? "drop oldest" : "drop newest",
+                         _droppedOldest, _droppedNewest);
+}
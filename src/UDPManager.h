@@ -2,20 +2,97 @@
 
 #include <WiFi.h>
 #include <WiFiUdp.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+// Keep datagrams below a typical Wi-Fi MTU so they are never fragmented
+#define UDP_MAX_DATAGRAM 1400
+#define UDP_MAX_MESSAGE 128
+#define UDP_QUEUE_LENGTH 32
+#define UDP_TASK_STACK_SIZE 4096
+#define UDP_TASK_PRIORITY 3
+#define UDP_RESOLVE_RETRY_MS 5000  // least time between lookups of a host that didn't resolve
+
+// What send() does when the queue to the network task is full
+enum UDPOverflowPolicy
+{
+    UDP_DROP_OLDEST = 0,
+    UDP_DROP_NEWEST = 1
+};
 
 class UDPManager {
 public:
     UDPManager(const char* destHost, uint16_t destPort);
     void begin();
+    bool startNetworkTask(int core);
     void send(const char* message);
+    void flush();
+    void setBatching(bool enabled, size_t maxBytes = UDP_MAX_DATAGRAM, uint32_t maxDelayMs = 1000);
+    void setOverflowPolicy(UDPOverflowPolicy policy) { _overflowPolicy = policy; }
     void setDestHost(const char* host);
     void setDestPort(uint16_t port);
     void stop();
+    void printToLog();
+
+    uint32_t getPacketsSent() const { return _packetsSent; }
+    uint32_t getBytesSent() const { return _bytesSent; }
+    uint32_t getSendFailures() const { return _sendFailures; }
+    uint32_t getDroppedOldest() const { return _droppedOldest; }
+    uint32_t getDroppedNewest() const { return _droppedNewest; }
 
 private:
+    // One queued sentence; a zero length message marks the end of a GPS epoch
+    struct Message {
+        uint16_t length;
+        char data[UDP_MAX_MESSAGE];
+    };
+
+    static void networkTask(void* param);
+    void enqueue(const Message& message);
+    bool receive(Message& message, TickType_t wait);
+    bool dropOldestSentence();
+    void process(const Message& message);
+    void flushBatch();
+    bool resolveDestination();
+    void sendDatagram(const uint8_t* data, size_t length);
+
     char _destHost[64];
+    uint32_t _destGeneration;       // bumped when _destHost changes
+    IPAddress _destIP;
+    volatile bool _hasDestIP;
+    uint32_t _nextResolveTime;      // millis() before which the host isn't looked up again
     uint16_t _listenPort;
     uint16_t _destPort;
     WiFiUDP _udp;
-    bool _hasBegun;
+    volatile bool _hasBegun;
+
+    // Preallocated queue between send() and the network task
+    QueueHandle_t _queue;
+    StaticQueue_t _queueState;
+    uint8_t _queueStorage[UDP_QUEUE_LENGTH * sizeof(Message)];
+    UDPOverflowPolicy _overflowPolicy;
+    TaskHandle_t _taskHandle;
+    // Held around every removal from _queue, so send() can take sentences off the head to
+    // make room without the network task receiving in between
+    SemaphoreHandle_t _queueMutex;
+    StaticSemaphore_t _queueMutexState;
+    // Guards the socket and destination, which the main loop changes as the network comes and
+    // goes. Never held across a DNS lookup.
+    SemaphoreHandle_t _socketMutex;
+    StaticSemaphore_t _socketMutexState;
+
+    // Sentences waiting to go out together in one datagram (network task only)
+    bool _batching;
+    size_t _batchMaxBytes;
+    uint32_t _batchMaxDelay;
+    uint8_t _batch[UDP_MAX_DATAGRAM];
+    size_t _batchLength;
+    uint32_t _batchStartTime;
+
+    volatile uint32_t _packetsSent;
+    volatile uint32_t _bytesSent;
+    volatile uint32_t _sendFailures;
+    volatile uint32_t _droppedOldest;
+    volatile uint32_t _droppedNewest;
 };
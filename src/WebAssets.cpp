@@ -0,0 +1,90 @@
+#include "WebAssets.h"
+#include <ArduinoJson.h>
+#include <TLogPlus.h>
+
+bool WebAssetHandler::begin(fs::FS& fs) {
+    _fs = &fs;
+    _assets.clear();
+
+    File file = fs.open(WEB_ASSETS_MANIFEST, "r");
+    if (!file) {
+        TLogPlus::Log.warningln("Web: No %s, serving uncompressed pages", WEB_ASSETS_MANIFEST);
+        return false;
+    }
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    if (error) {
+        TLogPlus::Log.warningln("Web: Unable to read %s: %s", WEB_ASSETS_MANIFEST, error.c_str());
+        return false;
+    }
+
+    for (JsonObject entry : doc["assets"].as<JsonArray>()) {
+        Asset asset;
+        asset.url = entry["url"].as<String>();
+        asset.file = entry["file"].as<String>();
+        asset.source = entry["source"].as<String>();
+        asset.type = entry["type"].as<String>();
+        asset.etag = entry["etag"].as<String>();
+        asset.immutable = entry["immutable"] | false;
+        _assets.push_back(asset);
+    }
+    TLogPlus::Log.infoln("Web: %u compressed assets", (unsigned)_assets.size());
+    return true;
+}
+
+const WebAssetHandler::Asset* WebAssetHandler::find(const String& url) const {
+    const String& path = url == "/" ? String("/index.html") : url;
+    for (const Asset& asset : _assets) {
+        if (asset.url == path) {
+            return &asset;
+        }
+    }
+    return nullptr;
+}
+
+bool WebAssetHandler::canHandle(AsyncWebServerRequest* request) const {
+    if (request->method() != HTTP_GET) {
+        return false;
+    }
+    return find(request->url()) != nullptr;
+}
+
+void WebAssetHandler::handleRequest(AsyncWebServerRequest* request) {
+    const Asset* asset = find(request->url());
+    if (asset == nullptr) {
+        request->send(404);
+        return;
+    }
+    _served++;
+    const char* cacheControl = asset->immutable ? WEB_ASSETS_IMMUTABLE_CACHE : WEB_ASSETS_PAGE_CACHE;
+
+    bool acceptsGzip = request->hasHeader("Accept-Encoding") &&
+                       request->header("Accept-Encoding").indexOf("gzip") >= 0;
+    if (!acceptsGzip) {
+        _uncompressed++;
+        AsyncWebServerResponse* response = request->beginResponse(*_fs, asset->source, asset->type);
+        response->addHeader("Cache-Control", cacheControl);
+        response->addHeader("Vary", "Accept-Encoding");
+        request->send(response);
+        return;
+    }
+
+    AsyncWebServerResponse* response;
+    if (request->hasHeader("If-None-Match") && request->header("If-None-Match") == asset->etag) {
+        _notModified++;
+        response = request->beginResponse(304);
+    } else {
+        // With only the .gz on the file system the response sends it with Content-Encoding: gzip
+        response = request->beginResponse(*_fs, asset->file, asset->type);
+    }
+    response->addHeader("ETag", asset->etag);
+    response->addHeader("Cache-Control", cacheControl);
+    response->addHeader("Vary", "Accept-Encoding");
+    request->send(response);
+}
+
+void WebAssetHandler::printToLog() const {
+    TLogPlus::Log.printf("Web assets: %u files, %u served, %u not modified, %u uncompressed\n",
+                         (unsigned)_assets.size(), _served, _notModified, _uncompressed);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include <FS.h>
+#include <ESPAsyncWebServer.h>
+#include <vector>
+
+#define WEB_ASSETS_MANIFEST "/www/manifest.json"
+#define WEB_ASSETS_IMMUTABLE_CACHE "public, max-age=31536000, immutable"
+#define WEB_ASSETS_PAGE_CACHE "no-cache"
+
+/// @brief Serves the gzipped, fingerprinted copies of the web pages that compress_web.py
+/// writes to /www. Each response carries a strong ETag, and a request that already has
+/// it gets a 304. Fingerprinted assets never change under the same name, so browsers may
+/// keep them for a year; pages are revalidated on every load. Clients that don't accept
+/// gzip get the original file from /web.
+class WebAssetHandler : public AsyncWebHandler {
+public:
+    /// @brief Reads the manifest. Without one no requests are handled here, and the
+    /// pages are served from /web as before.
+    bool begin(fs::FS& fs);
+
+    bool canHandle(AsyncWebServerRequest* request) const override;
+    void handleRequest(AsyncWebServerRequest* request) override;
+    bool isRequestHandlerTrivial() const override { return true; }
+
+    void printToLog() const;
+
+private:
+    struct Asset {
+        String url;
+        String file;     // gzipped copy, without the .gz the file response adds
+        String source;   // uncompressed original
+        String type;
+        String etag;
+        bool immutable;
+    };
+
+    const Asset* find(const String& url) const;
+
+    fs::FS* _fs = nullptr;
+    std::vector<Asset> _assets;
+    uint32_t _served = 0;
+    uint32_t _notModified = 0;
+    uint32_t _uncompressed = 0;
+};
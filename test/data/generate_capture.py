@@ -0,0 +1,98 @@
+"""Writes capture.nmea, a synthetic ALL_DATA recording used by the native tests.
+
+The receiver output is modelled on the MTK3339 in the Adafruit Ultimate GPS at 5 Hz:
+GGA, GSA, RMC, VTG and GLL every fix and a three sentence GSV group every fifth fix,
+plus the odd PGTOP, PMTK acknowledgement and corrupted line. Run it from the project
+directory to regenerate the file; the output is deterministic.
+"""
+import math
+import os
+import random
+
+RATE_HZ = 5
+SECONDS = 30
+START = (16, 20, 0)                # UTC hh, mm, ss
+DATE = "160426"
+ORIGIN = (47.606200, -122.332100)  # degrees
+KNOTS_TO_MPS = 0.514444
+
+OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "capture.nmea")
+
+
+def sentence(body):
+    checksum = 0
+    for c in body:
+        checksum ^= ord(c)
+    return "$%s*%02X\r\n" % (body, checksum)
+
+
+def coordinate(value, is_latitude):
+    hemisphere = ("N" if value >= 0 else "S") if is_latitude else ("E" if value >= 0 else "W")
+    value = abs(value)
+    degrees = int(value)
+    minutes = (value - degrees) * 60
+    return ("%02d%07.4f" if is_latitude else "%03d%07.4f") % (degrees, minutes), hemisphere
+
+
+def timestamp(ms):
+    seconds = START[0] * 3600 + START[1] * 60 + START[2] + ms // 1000
+    return "%02d%02d%02d.%03d" % (seconds // 3600, (seconds // 60) % 60, seconds % 60, ms % 1000)
+
+
+def satellites(rng):
+    return [(prn, rng.randint(5, 85), rng.randint(0, 359), rng.randint(18, 45))
+            for prn in (1, 3, 6, 9, 12, 14, 17, 19, 22, 24, 28)]
+
+
+def main():
+    rng = random.Random(1)
+    lat, lon = ORIGIN
+    course = 42.0
+    altitude = 12.3
+    sats = satellites(rng)
+    lines = [sentence("PMTK001,314,3"), sentence("PMTK001,220,3"), sentence("PGTOP,11,3")]
+
+    for fix in range(RATE_HZ * SECONDS):
+        ms = fix * 1000 // RATE_HZ
+        time = timestamp(ms)
+        speed = 5.2 + 1.5 * math.sin(fix / 40.0)
+        course = (course + rng.uniform(-1.5, 1.5)) % 360
+        distance = speed * KNOTS_TO_MPS / RATE_HZ
+        lat += distance * math.cos(math.radians(course)) / 111320.0
+        lon += distance * math.sin(math.radians(course)) / (111320.0 * math.cos(math.radians(lat)))
+        altitude += rng.uniform(-0.1, 0.1)
+        lat_text, ns = coordinate(lat, True)
+        lon_text, ew = coordinate(lon, False)
+        hdop = 0.9 + rng.randint(0, 3) / 10.0
+        used = 8 + rng.randint(0, 2)
+
+        lines.append(sentence("GPGGA,%s,%s,%s,%s,%s,1,%02d,%.2f,%.1f,M,-17.3,M,," %
+                              (time, lat_text, ns, lon_text, ew, used, hdop, altitude)))
+        lines.append(sentence("GPGSA,A,3,01,03,06,09,12,14,17,19,22,,,,%.2f,%.2f,%.2f" %
+                              (hdop + 0.6, hdop, 1.1)))
+        if fix % 5 == 0:
+            sats = [(prn, max(5, min(85, elevation + rng.randint(-1, 1))), azimuth,
+                     max(10, min(50, snr + rng.randint(-2, 2)))) for prn, elevation, azimuth, snr in sats]
+            groups = [sats[i:i + 4] for i in range(0, len(sats), 4)]
+            for number, group in enumerate(groups, 1):
+                fields = ",".join("%02d,%02d,%03d,%02d" % sat for sat in group)
+                lines.append(sentence("GPGSV,%d,%d,%02d,%s" % (len(groups), number, len(sats), fields)))
+        lines.append(sentence("GPRMC,%s,A,%s,%s,%s,%s,%.2f,%.2f,%s,,,A" %
+                              (time, lat_text, ns, lon_text, ew, speed, course, DATE)))
+        lines.append(sentence("GPVTG,%.2f,T,,M,%.2f,N,%.2f,K,A" % (course, speed, speed * 1.852)))
+        lines.append(sentence("GPGLL,%s,%s,%s,%s,%s,A,A" % (lat_text, ns, lon_text, ew, time)))
+
+        if fix % 50 == 25:
+            lines.append(sentence("PGTOP,11,3"))
+        if fix % 60 == 30:
+            # Line noise: a flipped bit and a sentence cut short by a dropped byte run
+            corrupt = lines[-3]
+            lines[-3] = corrupt[:20] + chr(ord(corrupt[20]) ^ 0x04) + corrupt[21:]
+            lines[-1] = lines[-1][:30] + "\r\n"
+
+    with open(OUTPUT, "w", newline="") as capture:
+        capture.writelines(lines)
+
+
+if __name__ == "__main__":
+    main()
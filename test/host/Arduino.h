@@ -0,0 +1,304 @@
+#pragma once
+// Host stand-in for the parts of the ESP32 Arduino core the firmware uses, so the
+// portable sources can be built and tested natively (pio test -e native).
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+#define PROGMEM
+#define F(string_literal) (string_literal)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t*)(addr))
+#define pgm_read_pointer(addr) (*(void* const*)(addr))
+#define pgm_read_ptr(addr) pgm_read_pointer(addr)
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
+
+namespace host {
+inline std::chrono::steady_clock::time_point startTime() {
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+}
+
+inline unsigned long micros() {
+    return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - host::startTime()).count();
+}
+
+inline unsigned long millis() {
+    return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - host::startTime()).count();
+}
+
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+inline long random(long howbig) { return howbig > 0 ? rand() % howbig : 0; }
+inline long random(long howsmall, long howbig) { return howsmall < howbig ? howsmall + random(howbig - howsmall) : howsmall; }
+
+namespace host {
+/// @brief Whether psramFound() reports PSRAM, as on the board. Tests clear it to run the
+/// paths taken without.
+inline bool psram = true;
+}
+
+inline bool psramFound() { return host::psram; }
+inline void* ps_malloc(size_t size) { return host::psram ? malloc(size) : nullptr; }
+
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t value) {}
+inline int digitalRead(uint8_t pin) { return HIGH; }
+
+inline uint32_t ledcSetup(uint8_t channel, uint32_t freq, uint8_t resolution) { return freq; }
+inline void ledcAttachPin(uint8_t pin, uint8_t channel) {}
+inline void ledcWrite(uint8_t channel, uint32_t duty) {}
+
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+inline char* dtostrf(double value, signed char width, unsigned char precision, char* buffer) {
+    sprintf(buffer, "%*.*f", width, precision, value);
+    return buffer;
+}
+
+/// @brief Arduino String on top of std::string.
+class String {
+public:
+    String(const char* text = "") : _value(text != nullptr ? text : "") {}
+    String(const std::string& text) : _value(text) {}
+    explicit String(char c) : _value(1, c) {}
+    explicit String(int value, unsigned char base = DEC) : _value(integer((long)value, base)) {}
+    explicit String(unsigned int value, unsigned char base = DEC) : _value(integer((unsigned long)value, base)) {}
+    explicit String(long value, unsigned char base = DEC) : _value(integer(value, base)) {}
+    explicit String(unsigned long value, unsigned char base = DEC) : _value(integer(value, base)) {}
+    explicit String(float value, unsigned int decimals = 2) : _value(decimal(value, decimals)) {}
+    explicit String(double value, unsigned int decimals = 2) : _value(decimal(value, decimals)) {}
+
+    const char* c_str() const { return _value.c_str(); }
+    unsigned int length() const { return _value.length(); }
+    bool isEmpty() const { return _value.empty(); }
+    void reserve(unsigned int size) { _value.reserve(size); }
+    char charAt(unsigned int index) const { return index < _value.length() ? _value[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    char& operator[](unsigned int index) { return _value[index]; }
+
+    String& operator+=(const String& other) { _value += other._value; return *this; }
+    String& operator+=(const char* other) { _value += other; return *this; }
+    String& operator+=(char c) { _value += c; return *this; }
+    String& operator+=(int value) { _value += integer((long)value, DEC); return *this; }
+    String& operator+=(unsigned int value) { _value += integer((unsigned long)value, DEC); return *this; }
+    String& operator+=(long value) { _value += integer(value, DEC); return *this; }
+    String& operator+=(unsigned long value) { _value += integer(value, DEC); return *this; }
+    String& operator+=(float value) { _value += decimal(value, 2); return *this; }
+    String& operator+=(double value) { _value += decimal(value, 2); return *this; }
+    template <typename T> bool concat(T value) { *this += value; return true; }
+
+    template <typename T> friend String operator+(const String& left, T right) {
+        String result(left);
+        result += right;
+        return result;
+    }
+    friend String operator+(const char* left, const String& right) { return String(left) += right; }
+
+    bool equals(const String& other) const { return _value == other._value; }
+    bool equalsIgnoreCase(const String& other) const {
+        return _value.size() == other._value.size() &&
+               std::equal(_value.begin(), _value.end(), other._value.begin(),
+                          [](char a, char b) { return tolower(a) == tolower(b); });
+    }
+    bool operator==(const String& other) const { return _value == other._value; }
+    bool operator==(const char* other) const { return _value == other; }
+    bool operator!=(const String& other) const { return _value != other._value; }
+    bool operator!=(const char* other) const { return _value != other; }
+    bool operator<(const String& other) const { return _value < other._value; }
+    bool startsWith(const String& prefix) const { return _value.compare(0, prefix.length(), prefix._value) == 0; }
+    bool endsWith(const String& suffix) const {
+        return suffix.length() <= length() && _value.compare(length() - suffix.length(), suffix.length(), suffix._value) == 0;
+    }
+
+    int indexOf(char c, unsigned int from = 0) const { return position(_value.find(c, from)); }
+    int indexOf(const String& text, unsigned int from = 0) const { return position(_value.find(text._value, from)); }
+    int lastIndexOf(char c) const { return position(_value.rfind(c)); }
+    int lastIndexOf(const String& text) const { return position(_value.rfind(text._value)); }
+    String substring(unsigned int from) const { return from < length() ? String(_value.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        return from < length() ? String(_value.substr(from, to - from)) : String();
+    }
+
+    void toLowerCase() { for (char& c : _value) c = tolower(c); }
+    void toUpperCase() { for (char& c : _value) c = toupper(c); }
+    void trim() {
+        size_t start = _value.find_first_not_of(" \t\r\n");
+        size_t end = _value.find_last_not_of(" \t\r\n");
+        _value = start == std::string::npos ? std::string() : _value.substr(start, end - start + 1);
+    }
+    void replace(const String& find, const String& with) {
+        if (find.isEmpty()) return;
+        for (size_t at = _value.find(find._value); at != std::string::npos;
+             at = _value.find(find._value, at + with.length())) {
+            _value.replace(at, find.length(), with._value);
+        }
+    }
+    void remove(unsigned int index, unsigned int count = (unsigned int)-1) {
+        if (index < length()) _value.erase(index, count);
+    }
+    long toInt() const { return atol(_value.c_str()); }
+    float toFloat() const { return atof(_value.c_str()); }
+    double toDouble() const { return atof(_value.c_str()); }
+
+private:
+    static int position(size_t at) { return at == std::string::npos ? -1 : (int)at; }
+    static std::string integer(long value, unsigned char base) {
+        if (value < 0 && base == DEC) return "-" + integer((unsigned long)-value, base);
+        return integer((unsigned long)value, base);
+    }
+    static std::string integer(unsigned long value, unsigned char base) {
+        std::string digits;
+        do {
+            digits.insert(digits.begin(), "0123456789abcdef"[value % base]);
+            value /= base;
+        } while (value > 0);
+        return digits;
+    }
+    static std::string decimal(double value, unsigned int decimals) {
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+        return buffer;
+    }
+
+    std::string _value;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t written = 0;
+        while (size-- > 0 && write(*buffer++)) written++;
+        return written;
+    }
+    size_t write(const char* text) { return text != nullptr ? write((const uint8_t*)text, strlen(text)) : 0; }
+    size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3))) {
+        char buffer[256];
+        va_list args;
+        va_start(args, format);
+        int length = vsnprintf(buffer, sizeof(buffer), format, args);
+        va_end(args);
+        if (length < 0) return 0;
+        if ((size_t)length < sizeof(buffer)) return write(buffer, length);
+        std::string text(length + 1, '\0');
+        va_start(args, format);
+        vsnprintf(&text[0], text.size(), format, args);
+        va_end(args);
+        return write(text.c_str(), length);
+    }
+
+    size_t print(const char* text) { return write(text); }
+    size_t print(const String& text) { return write(text.c_str(), text.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(int value, int base = DEC) { return print((long)value, base); }
+    size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+    size_t print(long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(unsigned long value, int base = DEC) { return print(String(value, (unsigned char)base)); }
+    size_t print(double value, int digits = 2) { return print(String(value, (unsigned int)digits)); }
+
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(T value) { return print(value) + println(); }
+    template <typename T> size_t println(T value, int format) { return print(value, format) + println(); }
+
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout() const { return _timeout; }
+
+    size_t readBytes(char* buffer, size_t length) {
+        size_t count = 0;
+        int c;
+        while (count < length && (c = timedRead()) >= 0) buffer[count++] = (char)c;
+        return count;
+    }
+    size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+    size_t readBytesUntil(char terminator, char* buffer, size_t length) {
+        size_t count = 0;
+        int c;
+        while (count < length && (c = timedRead()) >= 0 && c != terminator) buffer[count++] = (char)c;
+        return count;
+    }
+    String readStringUntil(char terminator) {
+        String text;
+        int c;
+        while ((c = timedRead()) >= 0 && c != terminator) text += (char)c;
+        return text;
+    }
+    String readString() {
+        String text;
+        int c;
+        while ((c = timedRead()) >= 0) text += (char)c;
+        return text;
+    }
+
+protected:
+    int timedRead() {
+        unsigned long start = millis();
+        do {
+            int c = read();
+            if (c >= 0) return c;
+        } while (millis() - start < _timeout);
+        return -1;
+    }
+
+    unsigned long _timeout = 1000;
+};
+
+#include "Esp.h"
+#include "HardwareSerial.h"
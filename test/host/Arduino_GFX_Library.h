@@ -0,0 +1,539 @@
+#pragma once
+// Host stand-in for the parts of Arduino_GFX the firmware draws with: GFXfont text,
+// lines, circles, triangles and fills on an Arduino_Canvas, with the same rotation
+// and framebuffer layout, and an ST7789 "panel" that keeps what the bus sent it so
+// tests can read back what the display would show.
+#include "Arduino.h"
+#include <vector>
+
+#define GFX_NOT_DEFINED -1
+#define GFX_SKIP_OUTPUT_BEGIN -2
+
+#define BLACK 0x0000
+#define NAVY 0x000F
+#define DARKGREEN 0x03E0
+#define DARKCYAN 0x03EF
+#define MAROON 0x7800
+#define PURPLE 0x780F
+#define OLIVE 0x7BE0
+#define LIGHTGREY 0xC618
+#define DARKGREY 0x7BEF
+#define BLUE 0x001F
+#define GREEN 0x07E0
+#define CYAN 0x07FF
+#define RED 0xF800
+#define MAGENTA 0xF81F
+#define YELLOW 0xFFE0
+#define WHITE 0xFFFF
+#define ORANGE 0xFD20
+#define GREENYELLOW 0xAFE5
+#define PINK 0xF81F
+
+typedef struct {
+    uint16_t bitmapOffset;
+    uint8_t width;
+    uint8_t height;
+    uint8_t xAdvance;
+    int8_t xOffset;
+    int8_t yOffset;
+} GFXglyph;
+
+typedef struct {
+    uint8_t* bitmap;
+    GFXglyph* glyph;
+    uint16_t first;
+    uint16_t last;
+    uint8_t yAdvance;
+} GFXfont;
+
+/// @brief Bus to the panel. Pixels go into whatever window the panel last set, and are
+/// counted so tests can see how much each frame sent.
+class Arduino_DataBus {
+public:
+    virtual ~Arduino_DataBus() {}
+    virtual bool begin(int32_t speed = GFX_NOT_DEFINED, int8_t dataMode = GFX_NOT_DEFINED) { return true; }
+    virtual void beginWrite() {}
+    virtual void endWrite() {}
+
+    virtual void writePixels(uint16_t* data, uint32_t len) {
+        _pixelsWritten += len;
+        if (_target == nullptr || _windowW <= 0 || _windowH <= 0) return;
+        while (len-- > 0) {
+            int32_t row = _position / _windowW, col = _position % _windowW;
+            _target[(int32_t)(_windowY + row) * _stride + _windowX + col] = *data++;
+            _position = (_position + 1) % ((int32_t)_windowW * _windowH);
+        }
+    }
+
+    void setWindow(uint16_t* target, int16_t stride, int16_t x, int16_t y, int16_t w, int16_t h) {
+        _target = target;
+        _stride = stride;
+        _windowX = x;
+        _windowY = y;
+        _windowW = w;
+        _windowH = h;
+        _position = 0;
+    }
+    uint64_t getPixelsWritten() const { return _pixelsWritten; }
+
+private:
+    uint16_t* _target = nullptr;
+    int16_t _stride = 0;
+    int16_t _windowX = 0, _windowY = 0, _windowW = 0, _windowH = 0;
+    int32_t _position = 0;
+    uint64_t _pixelsWritten = 0;
+};
+
+class Arduino_ESP32PAR8Q : public Arduino_DataBus {
+public:
+    Arduino_ESP32PAR8Q(int8_t dc, int8_t cs, int8_t wr, int8_t rd, int8_t d0, int8_t d1, int8_t d2, int8_t d3,
+                       int8_t d4, int8_t d5, int8_t d6, int8_t d7) {}
+};
+
+class Arduino_G {
+public:
+    Arduino_G(int16_t w, int16_t h) : WIDTH(w), HEIGHT(h) {}
+    virtual ~Arduino_G() {}
+
+    virtual bool begin(int32_t speed = GFX_NOT_DEFINED) = 0;
+    virtual void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h) = 0;
+
+protected:
+    int16_t WIDTH, HEIGHT;
+};
+
+/// @brief The drawing and text API, with the Adafruit GFX algorithms Arduino_GFX shares.
+/// Only GFXfonts are drawn; the built-in 5x7 font isn't used by the firmware, so text in
+/// it only moves the cursor.
+class Arduino_GFX : public Print, public Arduino_G {
+public:
+    Arduino_GFX(int16_t w, int16_t h) : Arduino_G(w, h), _width(w), _height(h) {}
+
+    virtual void startWrite() {}
+    virtual void endWrite() {}
+    virtual void writePixelPreclipped(int16_t x, int16_t y, uint16_t color) = 0;
+
+    virtual void setRotation(uint8_t r) {
+        _rotation = r & 3;
+        _width = (_rotation & 1) ? HEIGHT : WIDTH;
+        _height = (_rotation & 1) ? WIDTH : HEIGHT;
+    }
+    uint8_t getRotation() const { return _rotation; }
+    int16_t width() const { return _width; }
+    int16_t height() const { return _height; }
+
+    void writePixel(int16_t x, int16_t y, uint16_t color) {
+        if (x >= 0 && y >= 0 && x < _width && y < _height) writePixelPreclipped(x, y, color);
+    }
+    void drawPixel(int16_t x, int16_t y, uint16_t color) {
+        startWrite();
+        writePixel(x, y, color);
+        endWrite();
+    }
+
+    virtual void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { writeFillRect(x, y, 1, h, color); }
+    virtual void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { writeFillRect(x, y, w, 1, color); }
+    virtual void writeFillRectPreclipped(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        for (int16_t row = y; row < y + h; row++) {
+            for (int16_t col = x; col < x + w; col++) writePixelPreclipped(col, row, color);
+        }
+    }
+    void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        if (w < 0) { x += w + 1; w = -w; }
+        if (h < 0) { y += h + 1; h = -h; }
+        if (x < 0) { w += x; x = 0; }
+        if (y < 0) { h += y; y = 0; }
+        if (x + w > _width) w = _width - x;
+        if (y + h > _height) h = _height - y;
+        if (w > 0 && h > 0) writeFillRectPreclipped(x, y, w, h, color);
+    }
+
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+        startWrite();
+        writeFastVLine(x, y, h, color);
+        endWrite();
+    }
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+        startWrite();
+        writeFastHLine(x, y, w, color);
+        endWrite();
+    }
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        startWrite();
+        writeFillRect(x, y, w, h, color);
+        endWrite();
+    }
+    virtual void fillScreen(uint16_t color) { fillRect(0, 0, _width, _height, color); }
+
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+        if (x0 == x1) {
+            if (y0 > y1) std::swap(y0, y1);
+            drawFastVLine(x0, y0, y1 - y0 + 1, color);
+        } else if (y0 == y1) {
+            if (x0 > x1) std::swap(x0, x1);
+            drawFastHLine(x0, y0, x1 - x0 + 1, color);
+        } else {
+            startWrite();
+            writeLine(x0, y0, x1, y1, color);
+            endWrite();
+        }
+    }
+
+    void writeLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+        bool steep = abs(y1 - y0) > abs(x1 - x0);
+        if (steep) {
+            std::swap(x0, y0);
+            std::swap(x1, y1);
+        }
+        if (x0 > x1) {
+            std::swap(x0, x1);
+            std::swap(y0, y1);
+        }
+        int16_t dx = x1 - x0, dy = abs(y1 - y0);
+        int16_t err = dx / 2;
+        int16_t ystep = y0 < y1 ? 1 : -1;
+        for (; x0 <= x1; x0++) {
+            if (steep) writePixel(y0, x0, color);
+            else writePixel(x0, y0, color);
+            err -= dy;
+            if (err < 0) {
+                y0 += ystep;
+                err += dx;
+            }
+        }
+    }
+
+    void drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+        int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+        startWrite();
+        writePixel(x0, y0 + r, color);
+        writePixel(x0, y0 - r, color);
+        writePixel(x0 + r, y0, color);
+        writePixel(x0 - r, y0, color);
+        while (x < y) {
+            if (f >= 0) {
+                y--;
+                ddF_y += 2;
+                f += ddF_y;
+            }
+            x++;
+            ddF_x += 2;
+            f += ddF_x;
+            writePixel(x0 + x, y0 + y, color);
+            writePixel(x0 - x, y0 + y, color);
+            writePixel(x0 + x, y0 - y, color);
+            writePixel(x0 - x, y0 - y, color);
+            writePixel(x0 + y, y0 + x, color);
+            writePixel(x0 - y, y0 + x, color);
+            writePixel(x0 + y, y0 - x, color);
+            writePixel(x0 - y, y0 - x, color);
+        }
+        endWrite();
+    }
+
+    void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, uint16_t color) {
+        // Sort by y, then fill the upper and lower halves a scanline at a time
+        if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+        if (y1 > y2) { std::swap(y2, y1); std::swap(x2, x1); }
+        if (y0 > y1) { std::swap(y0, y1); std::swap(x0, x1); }
+
+        startWrite();
+        if (y0 == y2) {
+            int16_t a = std::min({ x0, x1, x2 }), b = std::max({ x0, x1, x2 });
+            writeFastHLine(a, y0, b - a + 1, color);
+            endWrite();
+            return;
+        }
+
+        int16_t dx01 = x1 - x0, dy01 = y1 - y0, dx02 = x2 - x0, dy02 = y2 - y0, dx12 = x2 - x1, dy12 = y2 - y1;
+        int32_t sa = 0, sb = 0;
+        int16_t last = y1 == y2 ? y1 : y1 - 1;
+        int16_t y;
+        for (y = y0; y <= last; y++) {
+            int16_t a = x0 + sa / dy01, b = x0 + sb / dy02;
+            sa += dx01;
+            sb += dx02;
+            if (a > b) std::swap(a, b);
+            writeFastHLine(a, y, b - a + 1, color);
+        }
+        sa = (int32_t)dx12 * (y - y1);
+        sb = (int32_t)dx02 * (y - y0);
+        for (; y <= y2; y++) {
+            int16_t a = x1 + sa / dy12, b = x0 + sb / dy02;
+            sa += dx12;
+            sb += dx02;
+            if (a > b) std::swap(a, b);
+            writeFastHLine(a, y, b - a + 1, color);
+        }
+        endWrite();
+    }
+
+    void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h) override {
+        startWrite();
+        for (int16_t j = 0; j < h; j++) {
+            for (int16_t i = 0; i < w; i++) writePixel(x + i, y + j, bitmap[(int32_t)j * w + i]);
+        }
+        endWrite();
+    }
+    void draw16bitRGBBitmap(int16_t x, int16_t y, const uint16_t bitmap[], int16_t w, int16_t h) {
+        draw16bitRGBBitmap(x, y, (uint16_t*)bitmap, w, h);
+    }
+
+    void setCursor(int16_t x, int16_t y) {
+        cursor_x = x;
+        cursor_y = y;
+    }
+    int16_t getCursorX() const { return cursor_x; }
+    int16_t getCursorY() const { return cursor_y; }
+    void setTextColor(uint16_t c) { textcolor = textbgcolor = c; }
+    void setTextColor(uint16_t c, uint16_t bg) {
+        textcolor = c;
+        textbgcolor = bg;
+    }
+    void setTextSize(uint8_t s) { setTextSize(s, s); }
+    void setTextSize(uint8_t sx, uint8_t sy) {
+        textsize_x = sx > 0 ? sx : 1;
+        textsize_y = sy > 0 ? sy : 1;
+    }
+    void setTextWrap(bool w) { wrap = w; }
+
+    /// @brief As in Adafruit GFX, the cursor moves to keep the baseline when switching
+    /// between the built-in font and a GFXfont.
+    void setFont(const GFXfont* f) {
+        if (f != nullptr && gfxFont == nullptr) {
+            cursor_y += 6;
+        } else if (f == nullptr && gfxFont != nullptr) {
+            cursor_y -= 6;
+        }
+        gfxFont = (GFXfont*)f;
+    }
+
+    using Print::write;
+    size_t write(uint8_t c) override {
+        if (gfxFont == nullptr) {
+            if (c == '\n') {
+                cursor_x = 0;
+                cursor_y += textsize_y * 8;
+            } else if (c != '\r') {
+                cursor_x += textsize_x * 6;
+            }
+            return 1;
+        }
+
+        if (c == '\n') {
+            cursor_x = 0;
+            cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+        } else if (c != '\r' && c >= gfxFont->first && c <= gfxFont->last) {
+            const GFXglyph* glyph = &gfxFont->glyph[c - gfxFont->first];
+            if (glyph->width > 0 && glyph->height > 0) {
+                if (wrap && cursor_x + textsize_x * (glyph->xOffset + glyph->width) > _width) {
+                    cursor_x = 0;
+                    cursor_y += (int16_t)textsize_y * gfxFont->yAdvance;
+                }
+                drawChar(cursor_x, cursor_y, c, textcolor);
+            }
+            cursor_x += glyph->xAdvance * (int16_t)textsize_x;
+        }
+        return 1;
+    }
+
+    void drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color) {
+        const GFXglyph* glyph = &gfxFont->glyph[c - gfxFont->first];
+        const uint8_t* bitmap = gfxFont->bitmap;
+        uint16_t offset = glyph->bitmapOffset;
+        uint8_t bits = 0, bit = 0;
+        startWrite();
+        for (uint8_t yy = 0; yy < glyph->height; yy++) {
+            for (uint8_t xx = 0; xx < glyph->width; xx++) {
+                if (!(bit++ & 7)) bits = bitmap[offset++];
+                if (bits & 0x80) {
+                    if (textsize_x == 1 && textsize_y == 1) {
+                        writePixel(x + glyph->xOffset + xx, y + glyph->yOffset + yy, color);
+                    } else {
+                        writeFillRect(x + (glyph->xOffset + xx) * textsize_x, y + (glyph->yOffset + yy) * textsize_y,
+                                      textsize_x, textsize_y, color);
+                    }
+                }
+                bits <<= 1;
+            }
+        }
+        endWrite();
+    }
+
+    void getTextBounds(const char* str, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) {
+        int16_t minx = 0x7FFF, miny = 0x7FFF, maxx = -1, maxy = -1;
+        *x1 = x;
+        *y1 = y;
+        *w = *h = 0;
+        for (unsigned char c; (c = *str++) != 0;) {
+            charBounds(c, &x, &y, &minx, &miny, &maxx, &maxy);
+        }
+        if (maxx >= minx) {
+            *x1 = minx;
+            *w = maxx - minx + 1;
+        }
+        if (maxy >= miny) {
+            *y1 = miny;
+            *h = maxy - miny + 1;
+        }
+    }
+    void getTextBounds(const String& str, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* w, uint16_t* h) {
+        getTextBounds(str.c_str(), x, y, x1, y1, w, h);
+    }
+
+protected:
+    void charBounds(unsigned char c, int16_t* x, int16_t* y, int16_t* minx, int16_t* miny, int16_t* maxx,
+                    int16_t* maxy) {
+        if (gfxFont == nullptr) {
+            if (c == '\n') {
+                *x = 0;
+                *y += textsize_y * 8;
+            } else if (c != '\r') {
+                int16_t x2 = *x + textsize_x * 6 - 1, y2 = *y + textsize_y * 8 - 1;
+                *minx = std::min(*minx, *x);
+                *miny = std::min(*miny, *y);
+                *maxx = std::max(*maxx, x2);
+                *maxy = std::max(*maxy, y2);
+                *x += textsize_x * 6;
+            }
+            return;
+        }
+
+        if (c == '\n') {
+            *x = 0;
+            *y += textsize_y * gfxFont->yAdvance;
+        } else if (c != '\r' && c >= gfxFont->first && c <= gfxFont->last) {
+            const GFXglyph* glyph = &gfxFont->glyph[c - gfxFont->first];
+            if (wrap && *x + (glyph->xOffset + glyph->width) * textsize_x > _width) {
+                *x = 0;
+                *y += textsize_y * gfxFont->yAdvance;
+            }
+            int16_t gx1 = *x + glyph->xOffset * textsize_x, gy1 = *y + glyph->yOffset * textsize_y;
+            int16_t gx2 = gx1 + glyph->width * textsize_x - 1, gy2 = gy1 + glyph->height * textsize_y - 1;
+            *minx = std::min(*minx, gx1);
+            *miny = std::min(*miny, gy1);
+            *maxx = std::max(*maxx, gx2);
+            *maxy = std::max(*maxy, gy2);
+            *x += glyph->xAdvance * textsize_x;
+        }
+    }
+
+    int16_t _width, _height;
+    uint8_t _rotation = 0;
+    int16_t cursor_x = 0, cursor_y = 0;
+    uint16_t textcolor = WHITE, textbgcolor = WHITE;
+    uint8_t textsize_x = 1, textsize_y = 1;
+    bool wrap = true;
+    GFXfont* gfxFont = nullptr;
+};
+
+/// @brief Panel driver. The panel's memory is kept in unrotated coordinates, the way
+/// the firmware addresses it with the panel at rotation 0.
+class Arduino_TFT : public Arduino_GFX {
+public:
+    Arduino_TFT(Arduino_DataBus* bus, int8_t rst, uint8_t r, bool ips, int16_t w, int16_t h, uint8_t col_offset1,
+                uint8_t row_offset1, uint8_t col_offset2, uint8_t row_offset2)
+        : Arduino_GFX(w, h), _bus(bus), _panel((size_t)w * h, BLACK) {
+        setRotation(r);
+    }
+
+    bool begin(int32_t speed = GFX_NOT_DEFINED) override { return _bus->begin(speed); }
+    void startWrite() override { _bus->beginWrite(); }
+    void endWrite() override { _bus->endWrite(); }
+
+    virtual void writeAddrWindow(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+        _bus->setWindow(_panel.data(), WIDTH, x, y, w, h);
+    }
+    void writePixelPreclipped(int16_t x, int16_t y, uint16_t color) override {
+        writeAddrWindow(x, y, 1, 1);
+        _bus->writePixels(&color, 1);
+    }
+
+    /// @brief What the panel is showing, WIDTH x HEIGHT.
+    const uint16_t* getPanel() const { return _panel.data(); }
+
+protected:
+    Arduino_DataBus* _bus;
+    std::vector<uint16_t> _panel;
+};
+
+class Arduino_ST7789 : public Arduino_TFT {
+public:
+    Arduino_ST7789(Arduino_DataBus* bus, int8_t rst = GFX_NOT_DEFINED, uint8_t r = 0, bool ips = false,
+                   int16_t w = 240, int16_t h = 320, uint8_t col_offset1 = 0, uint8_t row_offset1 = 0,
+                   uint8_t col_offset2 = 0, uint8_t row_offset2 = 0)
+        : Arduino_TFT(bus, rst, r, ips, w, h, col_offset1, row_offset1, col_offset2, row_offset2) {}
+};
+
+/// @brief Framebuffer of WIDTH x HEIGHT pixels in the panel's own orientation; drawing
+/// at other rotations is turned to match, as Arduino_Canvas does.
+class Arduino_Canvas : public Arduino_GFX {
+public:
+    Arduino_Canvas(int16_t w, int16_t h, Arduino_G* output, int16_t output_x = 0, int16_t output_y = 0,
+                   uint8_t rotation = 0)
+        : Arduino_GFX(w, h), _output(output), _output_x(output_x), _output_y(output_y) {
+        setRotation(rotation);
+    }
+    ~Arduino_Canvas() override { free(_framebuffer); }
+
+    bool begin(int32_t speed = GFX_NOT_DEFINED) override {
+        if (speed != GFX_SKIP_OUTPUT_BEGIN && _output != nullptr && !_output->begin(speed)) {
+            return false;
+        }
+        if (_framebuffer == nullptr) {
+            _framebuffer = (uint16_t*)calloc((size_t)WIDTH * HEIGHT, sizeof(uint16_t));
+        }
+        return _framebuffer != nullptr;
+    }
+
+    void writePixelPreclipped(int16_t x, int16_t y, uint16_t color) override { _framebuffer[offset(x, y)] = color; }
+
+    void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override {
+        if (x < 0 || x >= _width) return;
+        if (y < 0) { h += y; y = 0; }
+        if (y + h > _height) h = _height - y;
+        for (int16_t row = y; row < y + h; row++) _framebuffer[offset(x, row)] = color;
+    }
+
+    void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override {
+        if (y < 0 || y >= _height) return;
+        if (x < 0) { w += x; x = 0; }
+        if (x + w > _width) w = _width - x;
+        for (int16_t col = x; col < x + w; col++) _framebuffer[offset(col, y)] = color;
+    }
+
+    void writeFillRectPreclipped(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        for (int16_t row = y; row < y + h; row++) {
+            for (int16_t col = x; col < x + w; col++) _framebuffer[offset(col, row)] = color;
+        }
+    }
+
+    void fillScreen(uint16_t color) override { std::fill(_framebuffer, _framebuffer + (size_t)WIDTH * HEIGHT, color); }
+
+    using Arduino_GFX::draw16bitRGBBitmap;
+    void draw16bitRGBBitmap(int16_t x, int16_t y, uint16_t* bitmap, int16_t w, int16_t h) override {
+        for (int16_t j = 0; j < h; j++) {
+            for (int16_t i = 0; i < w; i++) writePixel(x + i, y + j, bitmap[(int32_t)j * w + i]);
+        }
+    }
+
+    uint16_t* getFramebuffer() { return _framebuffer; }
+    void flush() {
+        if (_output != nullptr) _output->draw16bitRGBBitmap(_output_x, _output_y, _framebuffer, WIDTH, HEIGHT);
+    }
+
+protected:
+    /// @brief Where a pixel in rotated coordinates lives in the framebuffer.
+    int32_t offset(int16_t x, int16_t y) const {
+        switch (_rotation) {
+            case 1: return (int32_t)x * WIDTH + (WIDTH - 1 - y);
+            case 2: return (int32_t)(HEIGHT - 1 - y) * WIDTH + (WIDTH - 1 - x);
+            case 3: return (int32_t)(HEIGHT - 1 - x) * WIDTH + y;
+            default: return (int32_t)y * WIDTH + x;
+        }
+    }
+
+    uint16_t* _framebuffer = nullptr;
+    Arduino_G* _output;
+    int16_t _output_x, _output_y;
+};
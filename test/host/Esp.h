@@ -0,0 +1,20 @@
+#pragma once
+#include "Arduino.h"
+
+/// @brief Host ESP object. Memory sizes are those of the T-Display S3, fixed so anything
+/// drawn from them is repeatable; the cycle counter runs at getCpuFrequencyMhz().
+class EspClass {
+public:
+    uint32_t getHeapSize() const { return 327680; }
+    uint32_t getFreeHeap() const { return 262144; }
+    uint32_t getMinFreeHeap() const { return 229376; }
+    uint32_t getPsramSize() const { return 8388608; }
+    uint32_t getFreePsram() const { return 8126464; }
+
+    uint32_t getCycleCount() const {
+        return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - host::startTime()).count() * getCpuFrequencyMhz() / 1000);
+    }
+};
+
+inline EspClass ESP;
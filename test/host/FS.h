@@ -0,0 +1,86 @@
+#pragma once
+#include <memory>
+#include "Arduino.h"
+
+namespace fs {
+
+/// @brief Host file on stdio. Copies share the same FILE, like the handles on the device.
+class File : public Stream {
+public:
+    File() {}
+    explicit File(FILE* file) : _file(file, fclose) {}
+
+    operator bool() const { return _file != nullptr; }
+
+    int available() override {
+        if (!_file) return 0;
+        long position = ftell(_file.get());
+        fseek(_file.get(), 0, SEEK_END);
+        long end = ftell(_file.get());
+        fseek(_file.get(), position, SEEK_SET);
+        return (int)(end - position);
+    }
+    int read() override { return _file ? fgetc(_file.get()) : -1; }
+    int peek() override {
+        if (!_file) return -1;
+        int c = fgetc(_file.get());
+        if (c != EOF) ungetc(c, _file.get());
+        return c;
+    }
+    size_t read(uint8_t* buffer, size_t size) { return _file ? fread(buffer, 1, size, _file.get()) : 0; }
+
+    using Print::write;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        return _file ? fwrite(buffer, 1, size, _file.get()) : 0;
+    }
+    void flush() override {
+        if (_file) fflush(_file.get());
+    }
+
+    bool seek(uint32_t position) { return _file && fseek(_file.get(), position, SEEK_SET) == 0; }
+    size_t position() const { return _file ? ftell(_file.get()) : 0; }
+    size_t size() const {
+        if (!_file) return 0;
+        long position = ftell(_file.get());
+        fseek(_file.get(), 0, SEEK_END);
+        long end = ftell(_file.get());
+        fseek(_file.get(), position, SEEK_SET);
+        return end;
+    }
+    void close() { _file.reset(); }
+
+private:
+    std::shared_ptr<FILE> _file;
+};
+
+/// @brief Host file system rooted at a directory of the project, so "/x" opens root/x.
+class FS {
+public:
+    explicit FS(const char* root) : _root(root) {}
+
+    File open(const char* path, const char* mode = "r", bool create = false) {
+        std::string binary = std::string(mode) + "b";
+        return File(fopen(hostPath(path).c_str(), binary.c_str()));
+    }
+    File open(const String& path, const char* mode = "r", bool create = false) { return open(path.c_str(), mode, create); }
+    bool exists(const char* path) {
+        FILE* file = fopen(hostPath(path).c_str(), "rb");
+        if (file != nullptr) fclose(file);
+        return file != nullptr;
+    }
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path) { return ::remove(hostPath(path).c_str()) == 0; }
+    bool remove(const String& path) { return remove(path.c_str()); }
+
+private:
+    std::string hostPath(const char* path) const {
+        return _root + (path[0] == '/' ? "" : "/") + path;
+    }
+
+    std::string _root;
+};
+}
+
+using fs::File;
+using fs::FS;
@@ -0,0 +1,98 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include "Arduino.h"
+
+#define SERIAL_8N1 0x800001c
+
+/// @brief Host UART. Port 0 is the console and writes to stdout. The others receive
+/// whatever the Stream given to setSource() has ready, as if it were wired to RX, and
+/// count what is written to them.
+class HardwareSerial : public Stream {
+public:
+    explicit HardwareSerial(int uart) : _uart(uart) {}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1,
+               bool invert = false) {
+        _baud = baud;
+    }
+    void end() {}
+    void updateBaudRate(unsigned long baud) { _baud = baud; }
+    uint32_t baudRate() const { return _baud; }
+    size_t setRxBufferSize(size_t size) { return size; }
+    void onReceive(std::function<void()> callback) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _onReceive = callback;
+    }
+
+    /// @brief Connects the receive side to source, or disconnects it with nullptr.
+    void setSource(Stream* source) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _source = source;
+    }
+    /// @brief Calls the onReceive callback if the source has data, as the UART driver
+    /// does from its event task. Tests call this in place of the interrupt.
+    void pollReceive() {
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_source == nullptr || !_onReceive || _source->available() <= 0) return;
+            callback = _onReceive;
+        }
+        callback();
+    }
+
+    int available() override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _source != nullptr ? _source->available() : 0;
+    }
+    int peek() override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _source != nullptr ? _source->peek() : -1;
+    }
+    int read() override {
+        std::lock_guard<std::mutex> lock(_mutex);
+        int c = _source != nullptr ? _source->read() : -1;
+        if (c >= 0) _bytesRead++;
+        return c;
+    }
+    size_t read(uint8_t* buffer, size_t size) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        size_t count = 0;
+        int c;
+        while (_source != nullptr && count < size && (c = _source->read()) >= 0) {
+            buffer[count++] = (uint8_t)c;
+        }
+        _bytesRead += count;
+        return count;
+    }
+
+    using Print::write;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (_uart == 0) {
+            fwrite(buffer, 1, size, stdout);
+        }
+        _bytesWritten += size;
+        return size;
+    }
+    void flush() override {
+        if (_uart == 0) fflush(stdout);
+    }
+
+    size_t getBytesRead() const { return _bytesRead; }
+    size_t getBytesWritten() const { return _bytesWritten; }
+
+    operator bool() const { return true; }
+
+protected:
+    int _uart;
+    unsigned long _baud = 0;
+    std::mutex _mutex;
+    Stream* _source = nullptr;
+    std::function<void()> _onReceive;
+    std::atomic<size_t> _bytesRead{0};
+    size_t _bytesWritten = 0;
+};
+
+inline HardwareSerial Serial(0);
@@ -0,0 +1,33 @@
+#pragma once
+#include "Arduino.h"
+
+class IPAddress {
+public:
+    IPAddress() : _address{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address{a, b, c, d} {}
+
+    bool fromString(const char* text) {
+        unsigned int parts[4];
+        char extra;
+        if (sscanf(text, "%u.%u.%u.%u%c", &parts[0], &parts[1], &parts[2], &parts[3], &extra) != 4) {
+            return false;
+        }
+        for (int i = 0; i < 4; i++) {
+            if (parts[i] > 255) return false;
+            _address[i] = parts[i];
+        }
+        return true;
+    }
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+        return String(text);
+    }
+
+    uint8_t operator[](int index) const { return _address[index]; }
+    bool operator==(const IPAddress& other) const { return memcmp(_address, other._address, 4) == 0; }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+
+private:
+    uint8_t _address[4];
+};
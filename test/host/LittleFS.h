@@ -0,0 +1,14 @@
+#pragma once
+#include "FS.h"
+
+namespace fs {
+/// @brief The data/ directory, which is what the firmware's LittleFS image is built from.
+class LittleFSFS : public FS {
+public:
+    LittleFSFS() : FS("data") {}
+    bool begin(bool formatOnFail = false) { return true; }
+    void end() {}
+};
+}
+
+inline fs::LittleFSFS LittleFS;
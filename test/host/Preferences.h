@@ -0,0 +1,102 @@
+#pragma once
+#include "Arduino.h"
+#include <map>
+#include <vector>
+
+typedef enum {
+    PT_I8, PT_U8, PT_I16, PT_U16, PT_I32, PT_U32, PT_I64, PT_U64, PT_STR, PT_BLOB, PT_INVALID
+} PreferenceType;
+
+namespace host {
+struct PreferenceEntry {
+    PreferenceType type;
+    std::vector<uint8_t> value;
+};
+typedef std::map<std::string, PreferenceEntry> PreferenceNamespace;
+
+/// @brief The host's NVS, kept for the life of the program so a namespace opened again
+/// sees what was written to it before.
+inline std::map<std::string, PreferenceNamespace>& nvs() {
+    static std::map<std::string, PreferenceNamespace> storage;
+    return storage;
+}
+}
+
+/// @brief Host Preferences over an in-memory NVS. Values keep the type they were put
+/// with, and putFloat stores a blob as on the ESP32.
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false, const char* partition = nullptr) {
+        _namespace = &host::nvs()[name];
+        _readOnly = readOnly;
+        return true;
+    }
+    void end() { _namespace = nullptr; }
+
+    bool clear() {
+        if (!writable()) return false;
+        _namespace->clear();
+        return true;
+    }
+    bool remove(const char* key) { return writable() && _namespace->erase(key) > 0; }
+    bool isKey(const char* key) const { return find(key) != nullptr; }
+    PreferenceType getType(const char* key) const {
+        const host::PreferenceEntry* entry = find(key);
+        return entry != nullptr ? entry->type : PT_INVALID;
+    }
+    size_t getBytesLength(const char* key) const {
+        const host::PreferenceEntry* entry = find(key);
+        return entry != nullptr && entry->type == PT_BLOB ? entry->value.size() : 0;
+    }
+
+    size_t putBool(const char* key, bool value) { return put(key, PT_U8, (uint8_t)(value ? 1 : 0)); }
+    size_t putInt(const char* key, int32_t value) { return put(key, PT_I32, value); }
+    size_t putUInt(const char* key, uint32_t value) { return put(key, PT_U32, value); }
+    size_t putFloat(const char* key, float value) { return put(key, PT_BLOB, value); }
+    size_t putString(const char* key, const char* value) {
+        return store(key, PT_STR, value, strlen(value) + 1) ? strlen(value) : 0;
+    }
+    size_t putString(const char* key, const String& value) { return putString(key, value.c_str()); }
+
+    bool getBool(const char* key, bool defaultValue = false) { return get<uint8_t>(key, PT_U8, defaultValue) != 0; }
+    int32_t getInt(const char* key, int32_t defaultValue = 0) { return get(key, PT_I32, defaultValue); }
+    uint32_t getUInt(const char* key, uint32_t defaultValue = 0) { return get(key, PT_U32, defaultValue); }
+    float getFloat(const char* key, float defaultValue = NAN) { return get(key, PT_BLOB, defaultValue); }
+    String getString(const char* key, const String& defaultValue = String()) {
+        const host::PreferenceEntry* entry = find(key);
+        if (entry == nullptr || entry->type != PT_STR) return defaultValue;
+        return String((const char*)entry->value.data());
+    }
+
+private:
+    bool writable() const { return _namespace != nullptr && !_readOnly; }
+
+    const host::PreferenceEntry* find(const char* key) const {
+        if (_namespace == nullptr) return nullptr;
+        auto entry = _namespace->find(key);
+        return entry != _namespace->end() ? &entry->second : nullptr;
+    }
+
+    bool store(const char* key, PreferenceType type, const void* value, size_t size) {
+        if (!writable()) return false;
+        host::PreferenceEntry& entry = (*_namespace)[key];
+        entry.type = type;
+        entry.value.assign((const uint8_t*)value, (const uint8_t*)value + size);
+        return true;
+    }
+
+    template <typename T> size_t put(const char* key, PreferenceType type, T value) {
+        return store(key, type, &value, sizeof(value)) ? sizeof(value) : 0;
+    }
+
+    template <typename T> T get(const char* key, PreferenceType type, T defaultValue) const {
+        const host::PreferenceEntry* entry = find(key);
+        if (entry == nullptr || entry->type != type || entry->value.size() != sizeof(T)) return defaultValue;
+        T value;
+        memcpy(&value, entry->value.data(), sizeof(T));
+        return value;
+    }
+
+    host::PreferenceNamespace* _namespace = nullptr;
+    bool _readOnly = false;
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include "Arduino.h"
+
+namespace TLogPlus {
+
+/// @brief Host logger: every level goes to stdout. Set quiet to keep test output short.
+class HostLog : public Print {
+public:
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (!quiet) fwrite(buffer, 1, size, stdout);
+        return size;
+    }
+    using Print::write;
+
+#define TLOGPLUS_HOST_LEVEL(name)                                                       \
+    template <typename... Args> void name(const char* format, Args... args) {          \
+        printf(format, args...);                                                        \
+    }                                                                                   \
+    void name(const String& text) { print(text); }                                      \
+    template <typename... Args> void name##ln(const char* format, Args... args) {      \
+        printf(format, args...);                                                        \
+        println();                                                                      \
+    }                                                                                   \
+    void name##ln(const String& text) { println(text); }
+    TLOGPLUS_HOST_LEVEL(debug)
+    TLOGPLUS_HOST_LEVEL(info)
+    TLOGPLUS_HOST_LEVEL(warning)
+    TLOGPLUS_HOST_LEVEL(error)
+#undef TLOGPLUS_HOST_LEVEL
+
+    bool quiet = false;
+};
+
+inline HostLog Log;
+}
@@ -0,0 +1,35 @@
+#pragma once
+// Helpers shared by the native test suites.
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+#define TEST_CAPTURE_PATH "test/data/capture.nmea"
+
+/// @brief Reads a whole file relative to the project directory, which is where
+/// pio test runs the test programs. Returns an empty string if it can't be read.
+inline std::string loadTestFile(const char* path) {
+    std::string contents;
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr) {
+        return contents;
+    }
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        contents.append(buffer, count);
+    }
+    fclose(file);
+    return contents;
+}
+
+/// @brief Integer setting from the environment, so benchmarks can be run longer by hand.
+inline long testSetting(const char* name, long fallback) {
+    const char* value = getenv(name);
+    return value != nullptr && *value != '\0' ? strtol(value, nullptr, 10) : fallback;
+}
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiUdp.h"
+
+typedef enum {
+    WL_NO_SHIELD = 255,
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+/// @brief Host WiFi station, connected to a fixed network so anything drawn from it is
+/// repeatable. Tests can change the public fields.
+class WiFiClass {
+public:
+    wl_status_t status() const { return hostStatus; }
+    String SSID() const { return hostSSID; }
+    int8_t RSSI() const { return hostRSSI; }
+    IPAddress localIP() const { return hostLocalIP; }
+    IPAddress softAPIP() const { return hostSoftAPIP; }
+
+    /// @brief Only literal addresses and localhost resolve, so tests never wait on DNS.
+    int hostByName(const char* host, IPAddress& result) {
+        if (strcmp(host, "localhost") == 0) {
+            result = IPAddress(127, 0, 0, 1);
+            return 1;
+        }
+        return result.fromString(host) ? 1 : 0;
+    }
+
+    wl_status_t hostStatus = WL_CONNECTED;
+    String hostSSID = "nomaduino";
+    int8_t hostRSSI = -58;
+    IPAddress hostLocalIP = IPAddress(192, 168, 1, 42);
+    IPAddress hostSoftAPIP = IPAddress(192, 168, 4, 1);
+};
+
+inline WiFiClass WiFi;
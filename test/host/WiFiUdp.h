@@ -0,0 +1,36 @@
+#pragma once
+#include <vector>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+/// @brief Host UDP socket that keeps each sent datagram in packets instead of using the network.
+class WiFiUDP : public Print {
+public:
+    uint8_t begin(uint16_t port) {
+        _open = true;
+        return 1;
+    }
+    void stop() { _open = false; }
+
+    int beginPacket(IPAddress ip, uint16_t port) {
+        _packet.clear();
+        return _open ? 1 : 0;
+    }
+    using Print::write;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        _packet.append((const char*)buffer, size);
+        return size;
+    }
+    int endPacket() {
+        if (!_open) return 0;
+        packets.push_back(_packet);
+        return 1;
+    }
+
+    std::vector<std::string> packets;
+
+private:
+    bool _open = false;
+    std::string _packet;
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include "Arduino.h"
+
+/// @brief Host I2C bus with no devices on it, every transfer is NACKed.
+class TwoWire : public Stream {
+public:
+    explicit TwoWire(uint8_t bus) {}
+
+    bool begin() { return true; }
+    bool begin(int sda, int scl, uint32_t frequency = 0) { return true; }
+    void beginTransmission(uint16_t address) {}
+    uint8_t endTransmission(bool sendStop = true) { return 2; }
+    uint8_t requestFrom(uint8_t address, uint8_t size, uint8_t sendStop = true) { return 0; }
+
+    using Print::write;
+    size_t write(uint8_t c) override { return 1; }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+};
+
+inline TwoWire Wire(0);
@@ -0,0 +1,48 @@
+#pragma once
+#include "FreeRTOS.h"
+#include <new>
+
+struct HostSemaphore {
+    HostSemaphore(UBaseType_t count, UBaseType_t maximum) : count(count), maximum(maximum) {}
+    std::mutex mutex;
+    std::condition_variable available;
+    UBaseType_t count;
+    UBaseType_t maximum;
+};
+typedef HostSemaphore* SemaphoreHandle_t;
+
+struct StaticSemaphore_t {
+    alignas(HostSemaphore) unsigned char storage[sizeof(HostSemaphore)];
+};
+
+// Mutexes are counting semaphores here: there is no priority inheritance to model
+inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* state) {
+    return new (state->storage) HostSemaphore(1, 1);
+}
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore(1, 1); }
+inline SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* state) {
+    return new (state->storage) HostSemaphore(0, 1);
+}
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore(0, 1); }
+inline SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maximum, UBaseType_t initial) {
+    return new HostSemaphore(initial, maximum);
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(semaphore->mutex);
+    if (!host::waitFor(semaphore->available, lock, ticks, [semaphore]() { return semaphore->count > 0; })) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->mutex);
+    if (semaphore->count >= semaphore->maximum) {
+        return pdFALSE;
+    }
+    semaphore->count++;
+    semaphore->available.notify_one();
+    return pdTRUE;
+}
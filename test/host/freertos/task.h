@@ -0,0 +1,66 @@
+#pragma once
+#include "FreeRTOS.h"
+#include <thread>
+
+typedef void (*TaskFunction_t)(void*);
+
+struct HostTask {
+    std::mutex mutex;
+    std::condition_variable notified;
+    uint32_t notifications = 0;
+};
+typedef HostTask* TaskHandle_t;
+
+namespace host {
+inline thread_local TaskHandle_t currentTask = nullptr;
+
+/// @brief The calling thread's task, made on first use for threads not started as tasks.
+inline TaskHandle_t thisTask() {
+    if (currentTask == nullptr) {
+        currentTask = new HostTask();
+    }
+    return currentTask;
+}
+}
+
+/// @brief Starts the task on its own thread. Tasks run until the process exits.
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char* name, uint32_t stackDepth,
+                                          void* parameter, UBaseType_t priority, TaskHandle_t* created,
+                                          BaseType_t core) {
+    TaskHandle_t task = new HostTask();
+    if (created != nullptr) {
+        *created = task;
+    }
+    std::thread([function, parameter, task]() {
+        host::currentTask = task;
+        function(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+inline BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* parameter,
+                              UBaseType_t priority, TaskHandle_t* created) {
+    return xTaskCreatePinnedToCore(function, name, stackDepth, parameter, priority, created, 0);
+}
+
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return host::thisTask(); }
+
+inline void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->notifications++;
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    HostTask* task = host::thisTask();
+    std::unique_lock<std::mutex> lock(task->mutex);
+    host::waitFor(task->notified, lock, ticks, [task]() { return task->notifications > 0; });
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clearOnExit ? 0 : value - 1;
+    }
+    return value;
+}
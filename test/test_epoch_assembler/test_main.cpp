@@ -0,0 +1,206 @@
+#include <unity.h>
+#include <stdio.h>
+#include <string.h>
+#include "NMEAParser.h"
+#include "GPSEpochAssembler.h"
+
+#define EXPECT_RMC_GGA (GPS_SENTENCE_BIT(NMEA_RMC) | GPS_SENTENCE_BIT(NMEA_GGA))
+#define GSV_BIT GPS_SENTENCE_BIT(NMEA_GSV)
+
+static NMEAParser* parser;
+static GPSEpochAssembler* assembler;
+static int publishes;
+
+// Adds the checksum to body and runs it through the parser and the assembler.
+// Returns true when the assembler published.
+static bool feed(const char* body) {
+    uint8_t checksum = 0;
+    for (const char* c = body; *c != '\0'; c++) checksum ^= *c;
+    char line[NMEA_MAX_SENTENCE + 1];
+    snprintf(line, sizeof(line), "$%s*%02X\r\n", body, checksum);
+
+    bool published = false;
+    for (const char* c = line; *c != '\0'; c++) {
+        if (parser->encode(*c)) {
+            published = assembler->add(parser->sentence(), parser->sentencePart(), parser->sentenceParts());
+        }
+    }
+    if (published) publishes++;
+    return published;
+}
+
+static void rmc(const char* time) {
+    char body[96];
+    snprintf(body, sizeof(body), "GPRMC,%s,A,4736.3722,N,12219.9257,W,5.20,42.56,160426,,,A", time);
+    feed(body);
+}
+
+static void gga(const char* time) {
+    char body[96];
+    snprintf(body, sizeof(body), "GPGGA,%s,4736.3722,N,12219.9257,W,1,10,0.90,12.4,M,-17.3,M,,", time);
+    feed(body);
+}
+
+static void gsv(int part, int parts, int inView) {
+    char body[96];
+    snprintf(body, sizeof(body), "GPGSV,%d,%d,%02d,%02d,21,291,46", parts, part, inView, part);
+    feed(body);
+}
+
+void setUp() {
+    parser = new NMEAParser();
+    assembler = new GPSEpochAssembler();
+    assembler->setExpectedSentences(EXPECT_RMC_GGA);
+    publishes = 0;
+}
+
+void tearDown() {
+    delete assembler;
+    delete parser;
+}
+
+void test_parser_reports_gsv_message_numbers() {
+    gsv(2, 3, 11);
+    TEST_ASSERT_EQUAL(NMEA_GSV, parser->sentenceType());
+    TEST_ASSERT_EQUAL_UINT8(2, parser->sentencePart());
+    TEST_ASSERT_EQUAL_UINT8(3, parser->sentenceParts());
+    TEST_ASSERT_EQUAL_UINT8(11, parser->sentence().satellitesInView);
+    rmc("162000.000");
+    TEST_ASSERT_EQUAL_UINT8(1, parser->sentencePart());
+    TEST_ASSERT_EQUAL_UINT8(1, parser->sentenceParts());
+}
+
+void test_complete_epoch_is_published() {
+    rmc("162000.000");
+    TEST_ASSERT_EQUAL(0, publishes);
+    gga("162000.000");
+    TEST_ASSERT_EQUAL(1, publishes);
+    TEST_ASSERT_EQUAL_UINT16(EXPECT_RMC_GGA, assembler->published().sentences);
+    TEST_ASSERT_EQUAL_UINT32(0, assembler->getIncompleteCount());
+}
+
+void test_new_timestamp_publishes_incomplete_epoch() {
+    rmc("162000.000");
+    rmc("162000.200");
+    TEST_ASSERT_EQUAL(1, publishes);
+    TEST_ASSERT_EQUAL_UINT32(58800000, assembler->published().time);
+    TEST_ASSERT_EQUAL_UINT32(1, assembler->getIncompleteCount());
+}
+
+void test_gsv_within_epoch_is_merged() {
+    // MTK order: GGA, GSA, GSV..., RMC
+    gga("162000.000");
+    gsv(1, 2, 9);
+    gsv(2, 2, 9);
+    TEST_ASSERT_EQUAL(0, publishes);
+    rmc("162000.000");
+    TEST_ASSERT_EQUAL(1, publishes);
+    const GPSFix& fix = assembler->published();
+    TEST_ASSERT_EQUAL_UINT16(EXPECT_RMC_GGA | GSV_BIT, fix.sentences);
+    TEST_ASSERT_EQUAL_UINT8(9, fix.satellitesInView);
+}
+
+void test_trailing_gsv_holds_later_epochs() {
+    rmc("162000.000");
+    gga("162000.000");
+    TEST_ASSERT_EQUAL(1, publishes);
+
+    // The first trailing group is too late for its record, which isn't published again
+    gsv(1, 2, 9);
+    gsv(2, 2, 9);
+    TEST_ASSERT_EQUAL(1, publishes);
+    TEST_ASSERT_EQUAL_UINT32(1, assembler->getSequence());
+    TEST_ASSERT_FALSE(assembler->published().has(GPS_FIELD_IN_VIEW));
+
+    // From then on a complete epoch waits for its group
+    rmc("162000.200");
+    gga("162000.200");
+    TEST_ASSERT_EQUAL(1, publishes);
+    gsv(1, 2, 10);
+    TEST_ASSERT_EQUAL(1, publishes);
+    gsv(2, 2, 10);
+    TEST_ASSERT_EQUAL(2, publishes);
+    const GPSFix& held = assembler->published();
+    TEST_ASSERT_EQUAL_UINT32(58800200, held.time);
+    TEST_ASSERT_EQUAL_UINT16(EXPECT_RMC_GGA | GSV_BIT, held.sentences);
+    TEST_ASSERT_EQUAL_UINT8(10, held.satellitesInView);
+
+    // An epoch whose group doesn't come goes out with the next epoch's first sentence
+    rmc("162000.400");
+    gga("162000.400");
+    TEST_ASSERT_EQUAL(2, publishes);
+    rmc("162000.600");
+    TEST_ASSERT_EQUAL(3, publishes);
+    const GPSFix& next = assembler->published();
+    TEST_ASSERT_EQUAL_UINT32(58800400, next.time);
+    TEST_ASSERT_EQUAL_UINT16(EXPECT_RMC_GGA, next.sentences);
+    // The value carries over like any other field
+    TEST_ASSERT_EQUAL_UINT8(10, next.satellitesInView);
+    TEST_ASSERT_EQUAL_UINT32(0, assembler->getIncompleteCount());
+
+    // or on flush, when the receiver has gone quiet
+    gga("162000.600");
+    TEST_ASSERT_EQUAL(3, publishes);
+    TEST_ASSERT_TRUE(assembler->flush());
+    TEST_ASSERT_EQUAL_UINT32(58800600, assembler->published().time);
+    TEST_ASSERT_EQUAL_UINT32(4, assembler->getSequence());
+}
+
+void test_gsv_group_straddling_completion_holds_its_epoch() {
+    gga("162000.000");
+    gsv(1, 2, 7);
+    rmc("162000.000");
+    TEST_ASSERT_EQUAL(0, publishes);
+    gsv(2, 2, 7);
+    TEST_ASSERT_EQUAL(1, publishes);
+    TEST_ASSERT_EQUAL_UINT32(1, assembler->getSequence());
+    TEST_ASSERT_EQUAL_UINT32(58800000, assembler->published().time);
+    TEST_ASSERT_EQUAL_UINT16(EXPECT_RMC_GGA | GSV_BIT, assembler->published().sentences);
+    TEST_ASSERT_EQUAL_UINT8(7, assembler->published().satellitesInView);
+}
+
+void test_broken_group_releases_held_epoch() {
+    gga("162000.000");
+    gsv(1, 3, 11);
+    rmc("162000.000");
+    TEST_ASSERT_EQUAL(0, publishes);
+    gsv(3, 3, 11);
+    TEST_ASSERT_EQUAL(1, publishes);
+    TEST_ASSERT_EQUAL_UINT16(EXPECT_RMC_GGA, assembler->published().sentences);
+}
+
+void test_gsv_group_with_missing_message_is_dropped() {
+    gga("162000.000");
+    gsv(1, 3, 11);
+    gsv(3, 3, 11);
+    rmc("162000.000");
+    TEST_ASSERT_EQUAL(1, publishes);
+    TEST_ASSERT_EQUAL_UINT16(EXPECT_RMC_GGA, assembler->published().sentences);
+    TEST_ASSERT_FALSE(assembler->published().has(GPS_FIELD_IN_VIEW));
+}
+
+void test_gsv_only_publishes_each_group() {
+    assembler->setExpectedSentences(GSV_BIT);
+    gsv(1, 2, 9);
+    gsv(2, 2, 9);
+    TEST_ASSERT_EQUAL(1, publishes);
+    gsv(1, 2, 10);
+    gsv(2, 2, 10);
+    TEST_ASSERT_EQUAL(2, publishes);
+    TEST_ASSERT_EQUAL_UINT8(10, assembler->published().satellitesInView);
+    TEST_ASSERT_EQUAL_UINT32(0, assembler->getIncompleteCount());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parser_reports_gsv_message_numbers);
+    RUN_TEST(test_complete_epoch_is_published);
+    RUN_TEST(test_new_timestamp_publishes_incomplete_epoch);
+    RUN_TEST(test_gsv_within_epoch_is_merged);
+    RUN_TEST(test_trailing_gsv_holds_later_epochs);
+    RUN_TEST(test_gsv_group_straddling_completion_holds_its_epoch);
+    RUN_TEST(test_broken_group_releases_held_epoch);
+    RUN_TEST(test_gsv_group_with_missing_message_is_dropped);
+    RUN_TEST(test_gsv_only_publishes_each_group);
+    return UNITY_END();
+}
@@ -0,0 +1,112 @@
+// Bytes read and decode time of the RLE565 splash images against the same pixels
+// stored raw, both read a row at a time through Image565Reader as ScreenManager does.
+// Run with: pio test -e native -f test_image_benchmark -v
+// IMAGE_REPEAT sets how many times each image is decoded (default 500).
+#include <unity.h>
+#include <LittleFS.h>
+#include <filesystem>
+#include <vector>
+#include "Image565.h"
+#include "TestData.h"
+
+static const char* IMAGES[] = { "/images/nomaduino-122.565", "/images/nomaduino-92x101.565" };
+
+// Raw copies of the images are written here
+static fs::FS scratch(std::filesystem::temp_directory_path().c_str());
+static long repeat;
+
+struct DecodeResult {
+    size_t fileBytes;
+    uint32_t bytesRead;
+    double seconds;
+};
+
+static std::vector<uint16_t> decodeAll(fs::FS& fs, const char* path, Image565Header& header) {
+    std::vector<uint16_t> pixels;
+    Image565Reader reader;
+    TEST_ASSERT_TRUE(reader.open(fs, path));
+    header = {};
+    memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+    header.version = IMAGE_VERSION;
+    header.format = IMAGE_FORMAT_RGB565;
+    header.width = reader.width();
+    header.height = reader.height();
+    header.flags = reader.hasTransparency() ? IMAGE_FLAG_TRANSPARENT : 0;
+    header.transparentColor = reader.transparentColor();
+
+    pixels.resize((size_t)reader.width() * reader.height());
+    for (int16_t j = 0; j < reader.height(); j++) {
+        TEST_ASSERT_TRUE(reader.readRow(pixels.data() + (size_t)j * reader.width()));
+    }
+    return pixels;
+}
+
+/// @brief Writes the pixels of an image as an uncompressed .565 to the scratch directory.
+static void writeRaw(const char* path, const Image565Header& header, const std::vector<uint16_t>& pixels) {
+    File file = scratch.open(path, "w");
+    TEST_ASSERT_TRUE(file);
+    file.write((const uint8_t*)&header, sizeof(header));
+    file.write((const uint8_t*)pixels.data(), pixels.size() * sizeof(uint16_t));
+    file.close();
+}
+
+static DecodeResult timeDecode(fs::FS& fs, const char* path) {
+    DecodeResult result = { 0, 0, 0 };
+    File file = fs.open(path, "r");
+    TEST_ASSERT_TRUE(file);
+    result.fileBytes = file.size();
+    file.close();
+
+    uint16_t row[IMAGE_MAX_WIDTH];
+    auto start = std::chrono::steady_clock::now();
+    for (long pass = 0; pass < repeat; pass++) {
+        Image565Reader reader;
+        TEST_ASSERT_TRUE(reader.open(fs, path));
+        for (int16_t j = 0; j < reader.height(); j++) {
+            TEST_ASSERT_TRUE(reader.readRow(row));
+        }
+        result.bytesRead = reader.getBytesRead();
+    }
+    result.seconds = secondsSince(start);
+    return result;
+}
+
+static void report(const char* format, const DecodeResult& result) {
+    printf("  %-7s %6zu bytes on flash, %6u bytes read, %7.1f us per decode\n", format, result.fileBytes,
+           result.bytesRead, result.seconds * 1e6 / repeat);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_benchmark_rle_against_raw() {
+    for (const char* path : IMAGES) {
+        Image565Header header;
+        std::vector<uint16_t> pixels = decodeAll(LittleFS, path, header);
+        writeRaw("/image_benchmark.565", header, pixels);
+
+        // The raw copy must decode to the same pixels for the comparison to mean anything
+        Image565Header rawHeader;
+        std::vector<uint16_t> rawPixels = decodeAll(scratch, "/image_benchmark.565", rawHeader);
+        TEST_ASSERT_EQUAL_UINT32(pixels.size(), rawPixels.size());
+        TEST_ASSERT_TRUE(pixels == rawPixels);
+
+        DecodeResult rle = timeDecode(LittleFS, path);
+        DecodeResult raw = timeDecode(scratch, "/image_benchmark.565");
+        printf("%s (%ux%u):\n", path, header.width, header.height);
+        report("RLE565", rle);
+        report("RGB565", raw);
+        printf("  RLE565 reads %.0f%% of the bytes in %.0f%% of the time\n", 100.0 * rle.bytesRead / raw.bytesRead,
+               100.0 * rle.seconds / raw.seconds);
+
+        TEST_ASSERT_LESS_THAN(raw.bytesRead, rle.bytesRead);
+        scratch.remove("/image_benchmark.565");
+    }
+}
+
+int main(int argc, char** argv) {
+    repeat = testSetting("IMAGE_REPEAT", 500);
+    UNITY_BEGIN();
+    RUN_TEST(test_benchmark_rle_against_raw);
+    return UNITY_END();
+}
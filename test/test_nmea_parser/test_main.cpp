@@ -0,0 +1,177 @@
+#include <unity.h>
+#include <string.h>
+#include "NMEAParser.h"
+
+static NMEAParser* parser;
+
+// Feeds text to the parser and returns how many sentences it completed
+static int feed(const char* text) {
+    int completed = 0;
+    for (const char* c = text; *c != '\0'; c++) {
+        if (parser->encode(*c)) completed++;
+    }
+    return completed;
+}
+
+void setUp() {
+    parser = new NMEAParser();
+}
+
+void tearDown() {
+    delete parser;
+}
+
+// Checksum
+
+void test_valid_checksum_is_accepted() {
+    TEST_ASSERT_EQUAL(1, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n"));
+    TEST_ASSERT_EQUAL(NMEA_RMC, parser->sentenceType());
+    TEST_ASSERT_EQUAL_UINT32(1, parser->getValidCount());
+    TEST_ASSERT_EQUAL_UINT32(0, parser->getChecksumFailures());
+}
+
+void test_lowercase_checksum_is_accepted() {
+    TEST_ASSERT_EQUAL(1, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6a\r\n"));
+}
+
+void test_checksum_mismatch_is_rejected() {
+    TEST_ASSERT_EQUAL(0, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6B\r\n"));
+    // One corrupted character in the body
+    TEST_ASSERT_EQUAL(0, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.5,230394,003.1,W*6A\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(2, parser->getChecksumFailures());
+    TEST_ASSERT_EQUAL_UINT32(0, parser->getSentenceCount());
+}
+
+void test_missing_or_malformed_checksum_is_rejected() {
+    TEST_ASSERT_EQUAL(0, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W\r\n"));
+    TEST_ASSERT_EQUAL(0, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6\r\n"));
+    TEST_ASSERT_EQUAL(0, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A0\r\n"));
+    TEST_ASSERT_EQUAL(0, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6G\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(4, parser->getChecksumFailures());
+}
+
+void test_unknown_sentence_counts_as_valid_but_is_not_reported() {
+    TEST_ASSERT_EQUAL(0, feed("$GPZDA,201530.00,04,07,2002,00,00*60\r\n"));
+    TEST_ASSERT_EQUAL_UINT32(1, parser->getValidCount());
+    TEST_ASSERT_EQUAL_UINT32(0, parser->getSentenceCount());
+    TEST_ASSERT_EQUAL_UINT32(0, parser->getChecksumFailures());
+}
+
+// Field splitting
+
+void test_fields_are_split_on_commas() {
+    TEST_ASSERT_EQUAL(1, feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"));
+    const GPSFix& fix = parser->sentence();
+    TEST_ASSERT_EQUAL(NMEA_GGA, parser->sentenceType());
+    TEST_ASSERT_EQUAL_UINT32(45319000, fix.time);
+    TEST_ASSERT_EQUAL_UINT8(1, fix.quality);
+    TEST_ASSERT_EQUAL_UINT8(8, fix.satellites);
+    TEST_ASSERT_EQUAL_UINT16(90, fix.hdop);
+    TEST_ASSERT_EQUAL_INT32(54540, fix.altitude);
+    TEST_ASSERT_TRUE(fix.active);
+    TEST_ASSERT_EQUAL_UINT16(GPS_SENTENCE_BIT(NMEA_GGA), fix.sentences);
+}
+
+void test_rmc_fields() {
+    TEST_ASSERT_EQUAL(1, feed("$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n"));
+    const GPSFix& fix = parser->sentence();
+    TEST_ASSERT_TRUE(fix.active);
+    TEST_ASSERT_EQUAL_UINT32(2240, fix.speed);
+    TEST_ASSERT_EQUAL_UINT16(8440, fix.course);
+    TEST_ASSERT_EQUAL_UINT8(3, fix.month());
+    TEST_ASSERT_EQUAL_UINT8(23, fix.day());
+    TEST_ASSERT_TRUE(fix.has(GPS_FIELD_TIME | GPS_FIELD_DATE | GPS_FIELD_STATUS | GPS_FIELD_LOCATION |
+                             GPS_FIELD_SPEED | GPS_FIELD_COURSE));
+}
+
+void test_empty_fields_are_left_unset() {
+    TEST_ASSERT_EQUAL(1, feed("$GNRMC,000000.000,V,,,,,,,010180,,,N*5B\r\n"));
+    const GPSFix& fix = parser->sentence();
+    TEST_ASSERT_FALSE(fix.active);
+    TEST_ASSERT_TRUE(fix.has(GPS_FIELD_TIME | GPS_FIELD_STATUS | GPS_FIELD_DATE));
+    TEST_ASSERT_FALSE(fix.has(GPS_FIELD_LOCATION));
+    TEST_ASSERT_FALSE(fix.has(GPS_FIELD_SPEED));
+    TEST_ASSERT_FALSE(fix.has(GPS_FIELD_COURSE));
+}
+
+void test_fractional_time_and_date() {
+    TEST_ASSERT_EQUAL(1, feed("$GPRMC,162007.200,A,4736.3802,N,12219.9131,W,6.37,44.51,160426,,,A*41\r\n"));
+    const GPSFix& fix = parser->sentence();
+    TEST_ASSERT_EQUAL_UINT8(16, fix.hour());
+    TEST_ASSERT_EQUAL_UINT8(20, fix.minute());
+    TEST_ASSERT_EQUAL_UINT8(7, fix.second());
+    TEST_ASSERT_EQUAL_UINT16(200, fix.millisecond());
+    TEST_ASSERT_EQUAL_UINT16(2026, fix.year());
+    TEST_ASSERT_EQUAL_UINT8(4, fix.month());
+    TEST_ASSERT_EQUAL_UINT8(16, fix.day());
+}
+
+void test_dollar_restarts_a_sentence() {
+    // A sentence cut short by line noise is abandoned when the next one starts
+    TEST_ASSERT_EQUAL(1, feed("$GPGGA,123519,4807.0$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n"));
+    TEST_ASSERT_EQUAL(NMEA_RMC, parser->sentenceType());
+}
+
+void test_overlong_sentence_is_dropped() {
+    char line[NMEA_MAX_SENTENCE + 32] = "$GPGGA,";
+    memset(line + 7, '1', NMEA_MAX_SENTENCE);
+    line[7 + NMEA_MAX_SENTENCE] = '\0';
+    TEST_ASSERT_EQUAL(0, feed(line));
+    TEST_ASSERT_EQUAL_UINT32(1, parser->getOverflowCount());
+    // and the parser recovers on the next sentence
+    TEST_ASSERT_EQUAL(1, feed("\r\n$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n"));
+}
+
+void test_last_sentence_keeps_raw_text() {
+    const char* text = "$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48\r\n";
+    TEST_ASSERT_EQUAL(1, feed(text));
+    TEST_ASSERT_EQUAL_STRING(text, parser->lastSentence());
+    TEST_ASSERT_EQUAL(strlen(text), parser->lastSentenceLength());
+    TEST_ASSERT_EQUAL_UINT16(5470, parser->sentence().course);
+    TEST_ASSERT_EQUAL_UINT32(550, parser->sentence().speed);
+}
+
+// Coordinate conversion
+
+void test_coordinates_north_east() {
+    TEST_ASSERT_EQUAL(1, feed("$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"));
+    // 48 deg 07.038 min and 11 deg 31.000 min
+    TEST_ASSERT_EQUAL_INT32(48117300, parser->sentence().latitude);
+    TEST_ASSERT_EQUAL_INT32(11516667, parser->sentence().longitude);
+}
+
+void test_coordinates_south_east() {
+    TEST_ASSERT_EQUAL(1, feed("$GPGLL,3751.65,S,14507.36,E,225444,A*37\r\n"));
+    const GPSFix& fix = parser->sentence();
+    TEST_ASSERT_EQUAL_INT32(-37860833, fix.latitude);
+    TEST_ASSERT_EQUAL_INT32(145122667, fix.longitude);
+    TEST_ASSERT_EQUAL_UINT32(82484000, fix.time);
+    TEST_ASSERT_TRUE(fix.active);
+}
+
+void test_coordinates_north_west_with_four_decimals() {
+    TEST_ASSERT_EQUAL(1, feed("$GPRMC,162007.200,A,4736.3802,N,12219.9131,W,6.37,44.51,160426,,,A*41\r\n"));
+    // 36.3802 / 60 = 0.6063366 and 19.9131 / 60 = 0.3318850
+    TEST_ASSERT_EQUAL_INT32(47606337, parser->sentence().latitude);
+    TEST_ASSERT_EQUAL_INT32(-122331885, parser->sentence().longitude);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_valid_checksum_is_accepted);
+    RUN_TEST(test_lowercase_checksum_is_accepted);
+    RUN_TEST(test_checksum_mismatch_is_rejected);
+    RUN_TEST(test_missing_or_malformed_checksum_is_rejected);
+    RUN_TEST(test_unknown_sentence_counts_as_valid_but_is_not_reported);
+    RUN_TEST(test_fields_are_split_on_commas);
+    RUN_TEST(test_rmc_fields);
+    RUN_TEST(test_empty_fields_are_left_unset);
+    RUN_TEST(test_fractional_time_and_date);
+    RUN_TEST(test_dollar_restarts_a_sentence);
+    RUN_TEST(test_overlong_sentence_is_dropped);
+    RUN_TEST(test_last_sentence_keeps_raw_text);
+    RUN_TEST(test_coordinates_north_east);
+    RUN_TEST(test_coordinates_south_east);
+    RUN_TEST(test_coordinates_north_west_with_four_decimals);
+    return UNITY_END();
+}
@@ -0,0 +1,108 @@
+// Parse throughput of NMEAParser against Adafruit_GPS::parse on the same capture.
+// Run with: pio test -e native -f test_parser_benchmark -v
+// BENCH_REPEAT sets how many times the capture is parsed (default 200).
+#include <unity.h>
+#include <Adafruit_GPS.h>
+#include <vector>
+#include "NMEAParser.h"
+#include "TestData.h"
+
+static std::string capture;
+static std::vector<std::string> lines;
+static long repeat;
+
+struct Throughput {
+    uint32_t sentences;
+    double seconds;
+};
+
+static void report(const char* name, const Throughput& result) {
+    double bytes = (double)capture.size() * repeat;
+    printf("%-16s %8u sentences in %.3f s: %10.0f sentences/s, %6.2f MB/s\n", name, result.sentences,
+           result.seconds, result.sentences / result.seconds, bytes / result.seconds / 1e6);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_capture_loaded() {
+    TEST_ASSERT_GREATER_THAN(0, capture.size());
+    TEST_ASSERT_GREATER_THAN(0, lines.size());
+}
+
+void test_parsers_agree_on_the_capture() {
+    // Both parsers must see the same good sentences for the comparison to be fair
+    NMEAParser parser;
+    Adafruit_GPS gps;
+    uint32_t ours = 0, theirs = 0;
+    for (const std::string& line : lines) {
+        bool parsed = false;
+        for (char c : line) {
+            parsed |= parser.encode(c);
+        }
+        std::vector<char> copy(line.begin(), line.end());
+        copy.push_back('\0');
+        bool accepted = gps.parse(copy.data());
+        // Which other types Adafruit_GPS decodes depends on its build options, so compare on RMC and GGA
+        if (parsed && (parser.sentenceType() == NMEA_RMC || parser.sentenceType() == NMEA_GGA)) {
+            ours++;
+            if (accepted) theirs++;
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(0, ours);
+    TEST_ASSERT_EQUAL_UINT32(ours, theirs);
+}
+
+void test_benchmark_nmea_parser() {
+    NMEAParser parser;
+    Throughput result = { 0, 0 };
+    auto start = std::chrono::steady_clock::now();
+    for (long pass = 0; pass < repeat; pass++) {
+        for (char c : capture) {
+            if (parser.encode(c)) result.sentences++;
+        }
+    }
+    result.seconds = secondsSince(start);
+    report("NMEAParser", result);
+    TEST_ASSERT_GREATER_THAN(0, result.sentences);
+}
+
+void test_benchmark_adafruit_gps() {
+    // Adafruit_GPS works on whole lines, which its read() normally frames one character
+    // at a time. Framing is left out here so only the parse itself is timed.
+    std::vector<std::vector<char>> buffers;
+    for (const std::string& line : lines) {
+        buffers.emplace_back(line.begin(), line.end());
+        buffers.back().push_back('\0');
+    }
+
+    Adafruit_GPS gps;
+    Throughput result = { 0, 0 };
+    auto start = std::chrono::steady_clock::now();
+    for (long pass = 0; pass < repeat; pass++) {
+        for (std::vector<char>& buffer : buffers) {
+            if (gps.parse(buffer.data())) result.sentences++;
+        }
+    }
+    result.seconds = secondsSince(start);
+    report("Adafruit_GPS", result);
+    TEST_ASSERT_GREATER_THAN(0, result.sentences);
+}
+
+int main(int argc, char** argv) {
+    capture = loadTestFile(TEST_CAPTURE_PATH);
+    size_t from = 0, to;
+    while ((to = capture.find('\n', from)) != std::string::npos) {
+        lines.push_back(capture.substr(from, to + 1 - from));
+        from = to + 1;
+    }
+    repeat = testSetting("BENCH_REPEAT", 200);
+    printf("Capture: %zu bytes, %zu lines, parsed %ld times\n", capture.size(), lines.size(), repeat);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_capture_loaded);
+    RUN_TEST(test_parsers_agree_on_the_capture);
+    RUN_TEST(test_benchmark_nmea_parser);
+    RUN_TEST(test_benchmark_adafruit_gps);
+    return UNITY_END();
+}
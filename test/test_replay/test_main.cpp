@@ -0,0 +1,213 @@
+// Replays the NMEA capture through GPSManager, with a fake HardwareSerial standing in
+// for the receiver's UART, and reports parse throughput, loop latency and fix updates.
+// Run with: pio test -e native -f test_replay -v
+// REPLAY_SPEED sets the playback speed of the throughput runs: 0 (the default) as fast
+// as possible, 1 for real time or N for N times real time. REPLAY_PACED_SPEED sets the
+// speed the pacing check runs at (default 20).
+#include <unity.h>
+#include <FS.h>
+#include "GPSManager.h"
+#include "Constants.h"
+#include "TestData.h"
+
+#define REPLAY_CAPTURE "/capture.nmea"
+#define REPLAY_SLACK_MS 10000   // beyond the capture's own length before a run is abandoned
+
+static HardwareSerial receiver(1);
+static fs::FS testData("test/data");
+
+// Measured once from the capture with a bare parser
+static size_t captureBytes;
+static uint32_t captureSentences;
+static uint32_t captureEpochs;      // distinct timestamps, one per epoch
+static uint32_t captureMillis;      // from the first timestamp to the last
+static uint32_t fixCallbacks;
+
+struct ReplayResult {
+    size_t bytes;
+    uint32_t sentences;
+    uint32_t fixes;
+    double seconds;
+};
+
+static void onFix(const GPSFix& fix) {
+    fixCallbacks++;
+}
+
+static GPSManager* makeManager() {
+    GPSManager* gps = new GPSManager(&receiver, 0, 0, GPS_BAUD_AUTO, false, 5000, ALL_DATA, UPDATE_5_HERTZ,
+                                     UPDATE_5_HERTZ);
+    gps->addFixListener(onFix);
+    return gps;
+}
+
+/// @brief Plays the whole capture into the receiver UART and runs gps.loop() until it
+/// has all been read, as the main loop would.
+static ReplayResult replay(GPSManager& gps, float speed) {
+    NMEAReplayStream source;
+    TEST_ASSERT_TRUE(source.open(testData, REPLAY_CAPTURE, speed));
+    receiver.setSource(&source);
+
+    size_t bytesBefore = receiver.getBytesRead();
+    uint32_t sentencesBefore = gps.getParser().getSentenceCount();
+    uint32_t fixesBefore = gps.getFixSequence();
+    uint32_t limit = (speed > 0 ? captureMillis / speed : 0) + REPLAY_SLACK_MS;
+    uint32_t startMillis = millis();
+    auto start = std::chrono::steady_clock::now();
+    // Until every sentence has been parsed, not just read from the UART: the ingest task
+    // can be holding some back while its ring is full
+    while ((receiver.getBytesRead() - bytesBefore < captureBytes ||
+            gps.getParser().getSentenceCount() - sentencesBefore < captureSentences) &&
+           millis() - startMillis < limit) {
+        receiver.pollReceive();
+        gps.loop();
+    }
+    ReplayResult result;
+    result.seconds = secondsSince(start);
+
+    // Take the UART back from the ingest task, and anything it queued since
+    gps.pauseIngest();
+    gps.loop();
+    receiver.setSource(nullptr);
+
+    result.bytes = receiver.getBytesRead() - bytesBefore;
+    result.sentences = gps.getParser().getSentenceCount() - sentencesBefore;
+    result.fixes = gps.getFixSequence() - fixesBefore;
+    return result;
+}
+
+static void report(const char* name, float speed, const ReplayResult& result, const LatencyHistogram& latency) {
+    printf("%s at %s: %zu bytes, %u sentences, %u fixes in %.3f s\n", name,
+           speed == 0 ? "full speed" : (String(speed, 1) + "x").c_str(), result.bytes, result.sentences,
+           result.fixes, result.seconds);
+    printf("  %.0f bytes/s, %.0f sentences/s, %.1f fixes/s\n", result.bytes / result.seconds,
+           result.sentences / result.seconds, result.fixes / result.seconds);
+    printf("  GPS loop (us): min %u, p50 %u, p90 %u, p99 %u, max %u over %u passes\n", latency.getMin(),
+           latency.getPercentile(50), latency.getPercentile(90), latency.getPercentile(99), latency.getMax(),
+           latency.getCount());
+}
+
+void setUp() {
+    fixCallbacks = 0;
+}
+
+void tearDown() {}
+
+void test_begin_detects_the_receiver_and_sets_the_rate() {
+    GPSManager* gps = makeManager();
+    // In real time, like a receiver: flat out, the probe's flush of stale input would take it all
+    NMEAReplayStream source;
+    TEST_ASSERT_TRUE(source.open(testData, REPLAY_CAPTURE, 1));
+    receiver.setSource(&source);
+    gps->begin();
+    receiver.setSource(nullptr);
+
+    // The capture is heard at the power-on rate, then the link is raised for 5 Hz of everything
+    uint32_t expected = GPSManager::requiredBaud(ALL_DATA, UPDATE_5_HERTZ);
+    TEST_ASSERT_EQUAL_UINT32(expected, gps->getBaudRate());
+    TEST_ASSERT_EQUAL_UINT32(expected, receiver.baudRate());
+    TEST_ASSERT_GREATER_THAN(0, receiver.getBytesWritten());
+    delete gps;
+}
+
+void test_detect_gives_up_quickly_without_a_receiver() {
+    GPSManager* gps = makeManager();
+    receiver.setSource(nullptr);
+    uint32_t start = millis();
+    TEST_ASSERT_EQUAL_UINT32(0, gps->detectBaud());
+    // Silence at the first rate means the others aren't tried
+    TEST_ASSERT_LESS_THAN(GPS_BAUD_PROBE_MS + 200, millis() - start);
+    TEST_ASSERT_EQUAL_UINT32(9600, receiver.baudRate());
+    delete gps;
+}
+
+void test_replay_from_loop() {
+    float speed = testSetting("REPLAY_SPEED", 0);
+    GPSManager* gps = makeManager();
+    gps->setSerialBatchRead(true);
+    ReplayResult result = replay(*gps, speed);
+    report("Serial read in loop()", speed, result, gps->getLoopLatency());
+
+    TEST_ASSERT_EQUAL_UINT32(captureBytes, result.bytes);
+    TEST_ASSERT_EQUAL_UINT32(captureSentences, result.sentences);
+    // Exactly one record per epoch
+    TEST_ASSERT_EQUAL_UINT32(captureEpochs, result.fixes);
+    TEST_ASSERT_EQUAL_UINT32(result.fixes, fixCallbacks);
+    TEST_ASSERT_TRUE(gps->hasFix());
+    delete gps;
+}
+
+void test_replay_is_paced_by_timestamps() {
+    float speed = testSetting("REPLAY_PACED_SPEED", 20);
+    GPSManager* gps = makeManager();
+    gps->setSerialBatchRead(true);
+    ReplayResult result = replay(*gps, speed);
+    report("Paced", speed, result, gps->getLoopLatency());
+
+    double expected = captureMillis / 1000.0 / speed;
+    TEST_ASSERT_TRUE(result.seconds >= expected * 0.95);
+    TEST_ASSERT_TRUE(result.seconds <= expected + 1.0);
+    TEST_ASSERT_EQUAL_UINT32(captureSentences, result.sentences);
+    delete gps;
+}
+
+void test_replay_through_ingest_task() {
+    float speed = testSetting("REPLAY_SPEED", 0);
+    // The ingest task runs for the rest of the program, so the manager is never deleted
+    static GPSManager* gps = makeManager();
+    TEST_ASSERT_TRUE(gps->startIngestTask(GPS_INGEST_CORE));
+    ReplayResult result = replay(*gps, speed);
+    report("Ingest task", speed, result, gps->getLoopLatency());
+    gps->printToLog();
+
+    TEST_ASSERT_EQUAL_UINT32(captureBytes, result.bytes);
+    // Flat out the ring fills faster than loop() empties it, and the task holds back
+    // rather than dropping
+    TEST_ASSERT_EQUAL_UINT32(captureSentences, result.sentences);
+    TEST_ASSERT_EQUAL_UINT32(0, gps->getIngestDropped());
+    TEST_ASSERT_EQUAL_UINT32(captureEpochs, result.fixes);
+    TEST_ASSERT_EQUAL_UINT32(result.fixes, fixCallbacks);
+}
+
+/// @brief Measures the capture as the replay delivers it.
+static void measureCapture() {
+    NMEAReplayStream source;
+    if (!source.open(testData, REPLAY_CAPTURE, 0)) {
+        return;
+    }
+    NMEAParser parser;
+    bool hasTime = false;
+    uint32_t first = 0, last = 0;
+    int c;
+    while ((c = source.read()) >= 0) {
+        captureBytes++;
+        if (!parser.encode(c) || !parser.sentence().has(GPS_FIELD_TIME)) {
+            continue;
+        }
+        uint32_t time = parser.sentence().time;
+        if (!hasTime || time != last) {
+            captureEpochs++;
+        }
+        last = time;
+        if (!hasTime) {
+            first = last;
+            hasTime = true;
+        }
+    }
+    captureSentences = parser.getSentenceCount();
+    captureMillis = last - first;
+}
+
+int main(int argc, char** argv) {
+    measureCapture();
+    printf("Capture: %zu bytes, %u sentences, %u epochs over %u ms\n", captureBytes, captureSentences,
+           captureEpochs, captureMillis);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_begin_detects_the_receiver_and_sets_the_rate);
+    RUN_TEST(test_detect_gives_up_quickly_without_a_receiver);
+    RUN_TEST(test_replay_from_loop);
+    RUN_TEST(test_replay_is_paced_by_timestamps);
+    RUN_TEST(test_replay_through_ingest_task);
+    return UNITY_END();
+}
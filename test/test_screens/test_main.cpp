@@ -0,0 +1,160 @@
+// Renders every screen through ScreenManager onto the host canvas, compares each one
+// against the golden PPM in test/data/screens and times drawing them.
+// Run with: pio test -e native -f test_screens -v
+// Frames go out as on the board, through the PSRAM front buffer and the flush task, and
+// the refresh benchmark runs again without PSRAM for comparison.
+// UPDATE_GOLDEN=1 rewrites the golden images from this run, after a deliberate layout
+// change; look at them before committing. SCREEN_REPEAT sets how many frames of each
+// screen the benchmark draws (default 200).
+#include <unity.h>
+#include <FS.h>
+#include <TLogPlus.h>
+#include <filesystem>
+#include <vector>
+#include "ScreenManager.h"
+#include "Constants.h"
+#include "TestData.h"
+
+#define SCREEN_CAPTURE "/capture.nmea"
+#define SCREEN_GOLDEN_DIR "test/data/screens"
+
+static HardwareSerial receiver(1);
+static fs::FS testData("test/data");
+static fs::FS golden(SCREEN_GOLDEN_DIR);
+// Rendered screens are written here, and left behind when they don't match
+static fs::FS scratch(std::filesystem::temp_directory_path().c_str());
+static AppSettings settings;
+static GPSManager* gps;
+static ScreenManager* screens;
+// The same screens on a canvas begun without PSRAM, which flushes synchronously
+static ScreenManager* unbuffered;
+
+static std::vector<uint8_t> readFile(fs::FS& fs, const char* path) {
+    std::vector<uint8_t> contents;
+    File file = fs.open(path, "r");
+    if (file) {
+        contents.resize(file.size());
+        contents.resize(file.read(contents.data(), contents.size()));
+        file.close();
+    }
+    return contents;
+}
+
+void setUp() {}
+void tearDown() {}
+
+/// @brief Plays the whole capture through the GPS manager, so the screens show the
+/// last fix in it: the same position, time, speed and satellites on every run.
+void test_replay_capture() {
+    NMEAReplayStream source;
+    TEST_ASSERT_TRUE(source.open(testData, SCREEN_CAPTURE, 0));
+    receiver.setSource(&source);
+    while (receiver.available() > 0) {
+        receiver.pollReceive();
+        gps->loop();
+    }
+    receiver.setSource(nullptr);
+    TEST_ASSERT_TRUE(gps->hasFix());
+}
+
+void test_screens_match_golden() {
+    bool update = testSetting("UPDATE_GOLDEN", 0) != 0;
+    if (update) {
+        std::filesystem::create_directories(SCREEN_GOLDEN_DIR);
+    }
+    uint32_t mismatched = 0;
+    for (int mode = SCREEN_BOOT; mode < SCREEN_MAX; mode++) {
+        const char* name = ScreenManager::screenName((ScreenMode)mode);
+        String path = String("/") + name + ".ppm";
+        TEST_ASSERT_TRUE(screens->saveScreenshot((ScreenMode)mode, scratch, path.c_str()));
+        std::vector<uint8_t> rendered = readFile(scratch, path.c_str());
+        TEST_ASSERT_GREATER_THAN(0, rendered.size());
+
+        // The debug screen shows timings from this run, so it only has to draw
+        if (mode == SCREEN_DEVICE_DEBUG) {
+            scratch.remove(path.c_str());
+            continue;
+        }
+
+        if (update) {
+            File file = golden.open(path.c_str(), "w");
+            TEST_ASSERT_TRUE(file);
+            file.write(rendered.data(), rendered.size());
+            file.close();
+            printf("Updated %s%s\n", SCREEN_GOLDEN_DIR, path.c_str());
+        }
+
+        std::vector<uint8_t> expected = readFile(golden, path.c_str());
+        if (rendered == expected) {
+            scratch.remove(path.c_str());
+            continue;
+        }
+        size_t differing = 0;
+        for (size_t i = 0; i + 2 < std::min(rendered.size(), expected.size()); i += 3) {
+            if (memcmp(&rendered[i], &expected[i], 3) != 0) differing++;
+        }
+        printf("%s differs from %s%s in %zu pixels (%zu bytes against %zu), rendered to %s%s\n", name,
+               SCREEN_GOLDEN_DIR, path.c_str(), differing, rendered.size(), expected.size(),
+               std::filesystem::temp_directory_path().c_str(), path.c_str());
+        mismatched++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, mismatched);
+}
+
+static ScreenManager* makeScreens() {
+    ScreenManager* manager = new ScreenManager(&settings);
+    manager->setGPSManager(gps);
+    manager->setPortalSSID("Nomaduino-Setup");
+    manager->setOTAStatus(42);
+    manager->begin();
+    return manager;
+}
+
+/// @brief Whole frames as the loop draws them: clear last frame's damage, draw, flush.
+/// The flush time is what the loop spends in flushDamage(), not the panel transfer.
+static void benchmarkRefresh(ScreenManager* manager, const char* name, uint16_t repeat) {
+    printf("Screen refresh over %u frames, %s:\n", repeat, name);
+    printf("  %-10s %9s %9s %14s\n", "screen", "draw (us)", "flush (us)", "pixels/frame");
+    for (int mode = SCREEN_BOOT; mode < SCREEN_MAX; mode++) {
+        manager->setScreenMode((ScreenMode)mode);
+        manager->resetScreenStats();
+        for (uint16_t i = 0; i < repeat; i++) {
+            manager->refreshScreen();
+        }
+        const ScreenStats& stats = manager->getScreenStats((ScreenMode)mode);
+        TEST_ASSERT_EQUAL_UINT32(repeat, stats.frames);
+        uint32_t pixels = (uint32_t)(stats.bytesPushed / sizeof(uint16_t) / stats.frames);
+        printf("  %-10s %9u %9u %7u of %5u\n", ScreenManager::screenName((ScreenMode)mode), stats.drawAverage,
+               stats.flushAverage, pixels, SCREEN_WIDTH * SCREEN_HEIGHT);
+        TEST_ASSERT_LESS_OR_EQUAL_UINT32(SCREEN_WIDTH * SCREEN_HEIGHT, pixels);
+    }
+}
+
+void test_benchmark_screens() {
+    uint16_t repeat = testSetting("SCREEN_REPEAT", 200);
+    // Drawing alone, off the panel
+    TLogPlus::Log.quiet = false;
+    screens->benchmarkScreens(repeat);
+    TLogPlus::Log.quiet = true;
+
+    benchmarkRefresh(screens, "PSRAM front buffer and flush task", repeat);
+    benchmarkRefresh(unbuffered, "no PSRAM, flushed synchronously", repeat);
+}
+
+int main(int argc, char** argv) {
+    TLogPlus::Log.quiet = true;
+    settings.load();
+    gps = new GPSManager(&receiver, 0, 0, GPS_BAUD_AUTO, false, 5000, ALL_DATA, UPDATE_5_HERTZ, UPDATE_5_HERTZ);
+    gps->setSerialBatchRead(true);
+
+    screens = makeScreens();
+    host::psram = false;
+    unbuffered = makeScreens();
+    host::psram = true;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_replay_capture);
+    RUN_TEST(test_screens_match_golden);
+    RUN_TEST(test_benchmark_screens);
+    return UNITY_END();
+}
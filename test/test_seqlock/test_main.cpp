@@ -0,0 +1,103 @@
+// Torn read stress test for SeqLock: one writer thread publishes values whose fields
+// must always agree while reader threads check every copy they get back.
+// Also run under ThreadSanitizer by: pio test -e native_tsan
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "SeqLock.h"
+#include "TestData.h"
+
+#define SEQLOCK_FIELDS 37   // odd sized on purpose, so the last word is partly used
+#define SEQLOCK_READERS 3
+
+struct Sample {
+    uint32_t counter;
+    uint8_t fill[SEQLOCK_FIELDS];   // every byte is counter's low byte
+    uint32_t check;                 // ~counter
+};
+
+static bool consistent(const Sample& sample) {
+    for (uint8_t byte : sample.fill) {
+        if (byte != (uint8_t)sample.counter) return false;
+    }
+    return sample.check == ~sample.counter;
+}
+
+static Sample makeSample(uint32_t counter) {
+    Sample sample;
+    sample.counter = counter;
+    memset(sample.fill, (uint8_t)counter, sizeof(sample.fill));
+    sample.check = ~counter;
+    return sample;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_starts_zeroed() {
+    SeqLock<Sample> lock;
+    Sample sample = lock.read();
+    TEST_ASSERT_EQUAL_UINT32(0, sample.counter);
+    TEST_ASSERT_EQUAL_UINT32(0, sample.check);
+    TEST_ASSERT_EQUAL_UINT32(0, lock.version());
+}
+
+void test_read_returns_last_write() {
+    SeqLock<Sample> lock;
+    lock.write(makeSample(41));
+    lock.write(makeSample(42));
+    Sample sample = lock.read();
+    TEST_ASSERT_EQUAL_UINT32(42, sample.counter);
+    TEST_ASSERT_TRUE(consistent(sample));
+    TEST_ASSERT_EQUAL_UINT32(2, lock.version());
+}
+
+void test_concurrent_readers_never_see_torn_values() {
+    static SeqLock<Sample> lock;
+    const uint32_t writes = testSetting("SEQLOCK_WRITES", 200000);
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> torn(0), backwards(0), reads(0);
+    lock.write(makeSample(0));
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < SEQLOCK_READERS; i++) {
+        readers.emplace_back([&]() {
+            uint32_t last = 0, count = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                Sample sample = lock.read();
+                if (!consistent(sample)) torn++;
+                if (sample.counter < last) backwards++;
+                last = sample.counter;
+                count++;
+            }
+            reads += count;
+        });
+    }
+
+    std::thread writer([&]() {
+        for (uint32_t counter = 1; counter <= writes; counter++) {
+            lock.write(makeSample(counter));
+        }
+        done.store(true, std::memory_order_release);
+    });
+
+    writer.join();
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    printf("SeqLock: %u writes, %u reads by %d readers\n", writes, reads.load(), SEQLOCK_READERS);
+    TEST_ASSERT_EQUAL_UINT32(0, torn.load());
+    TEST_ASSERT_EQUAL_UINT32(0, backwards.load());
+    TEST_ASSERT_GREATER_THAN(0, reads.load());
+    TEST_ASSERT_EQUAL_UINT32(writes, lock.read().counter);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_starts_zeroed);
+    RUN_TEST(test_read_returns_last_write);
+    RUN_TEST(test_concurrent_readers_never_see_torn_values);
+    return UNITY_END();
+}
@@ -0,0 +1,106 @@
+// AppSettings against the host's in-memory NVS: changes stay in RAM until flushed,
+// come back through load() with their types, and read without the lock while another
+// thread changes and flushes them.
+// Run with: pio test -e native -f test_settings -v
+#include <unity.h>
+#include <TLogPlus.h>
+#include <atomic>
+#include <thread>
+#include "AppSettings.h"
+
+/// @brief What a fresh AppSettings finds in flash, as after a restart.
+static AppSettings* reloaded() {
+    AppSettings* settings = new AppSettings();
+    settings->load();
+    return settings;
+}
+
+void setUp() {
+    AppSettings settings;
+    settings.load();
+    settings.loadDefaults();
+}
+void tearDown() {}
+
+void test_defaults_are_stored() {
+    AppSettings* settings = reloaded();
+    TEST_ASSERT_TRUE(settings->getBool(SETTING_IS_CONFIGURED));
+    TEST_ASSERT_EQUAL_INT(BAUD_RATE_DEFAULT, settings->getInt(SETTING_BAUD_RATE));
+    TEST_ASSERT_EQUAL_STRING(UDP_HOST_DEFAULT, settings->get(SETTING_UDP_HOST).c_str());
+    delete settings;
+}
+
+void test_changes_wait_for_flush() {
+    AppSettings settings;
+    settings.load();
+    settings.setInt(SETTING_BACKLIGHT, 40);
+    settings.set(SETTING_WIFI_SSID, "boat");
+    settings.loop();
+    TEST_ASSERT_EQUAL_INT(40, settings.getInt(SETTING_BACKLIGHT));
+
+    // Too soon after the change for loop() to write it
+    AppSettings* before = reloaded();
+    TEST_ASSERT_EQUAL_INT(BACKLIGHT_DEFAULT, before->getInt(SETTING_BACKLIGHT, BACKLIGHT_DEFAULT));
+    TEST_ASSERT_EQUAL_STRING("", before->get(SETTING_WIFI_SSID).c_str());
+    delete before;
+
+    settings.flush();
+    AppSettings* after = reloaded();
+    TEST_ASSERT_EQUAL_INT(40, after->getInt(SETTING_BACKLIGHT));
+    TEST_ASSERT_EQUAL_STRING("boat", after->get(SETTING_WIFI_SSID).c_str());
+    delete after;
+}
+
+void test_settings_keep_their_type() {
+    AppSettings settings;
+    settings.load();
+    // Set or read as another type, a setting is left alone and reads as the default
+    settings.set(SETTING_BAUD_RATE, "fast");
+    settings.setBool(SETTING_UDP_HOST, true);
+    TEST_ASSERT_EQUAL_INT(BAUD_RATE_DEFAULT, settings.getInt(SETTING_BAUD_RATE));
+    TEST_ASSERT_EQUAL_STRING(UDP_HOST_DEFAULT, settings.get(SETTING_UDP_HOST).c_str());
+    TEST_ASSERT_FALSE(settings.getBool(SETTING_BAUD_RATE));
+    TEST_ASSERT_EQUAL_INT(-1, settings.getInt(SETTING_UDP_HOST, -1));
+
+    SettingId id;
+    TEST_ASSERT_TRUE(AppSettings::findKey("udpPort", id));
+    TEST_ASSERT_EQUAL(SETTING_UDP_PORT, id);
+    TEST_ASSERT_EQUAL_STRING("udpPort", AppSettings::keyName(id));
+    TEST_ASSERT_FALSE(AppSettings::findKey("udpport", id));
+}
+
+void test_reads_during_flush() {
+    AppSettings settings;
+    settings.load();
+    settings.setInt(SETTING_UDP_PORT, 1000);
+    std::atomic<bool> done(false);
+    std::atomic<uint32_t> torn(0);
+    std::thread reader([&] {
+        while (!done) {
+            int value = settings.getInt(SETTING_UDP_PORT);
+            if (value < 1000 || value > 2000) torn++;
+        }
+    });
+
+    for (int i = 1; i <= 1000; i++) {
+        settings.setInt(SETTING_UDP_PORT, 1000 + i);
+        if (i % 10 == 0) settings.flush();
+    }
+    done = true;
+    reader.join();
+    TEST_ASSERT_EQUAL_UINT32(0, torn);
+
+    AppSettings* after = reloaded();
+    TEST_ASSERT_EQUAL_INT(2000, after->getInt(SETTING_UDP_PORT));
+    delete after;
+}
+
+int main(int argc, char** argv) {
+    TLogPlus::Log.quiet = true;
+    UNITY_BEGIN();
+    RUN_TEST(test_defaults_are_stored);
+    RUN_TEST(test_changes_wait_for_flush);
+    RUN_TEST(test_settings_keep_their_type);
+    RUN_TEST(test_reads_during_flush);
+    return UNITY_END();
+}